@@ -0,0 +1,109 @@
+# minifies and gzips the web page from data/ into include/WebAssets.hpp
+# runs before every PlatformIO build (extra_scripts), or by hand:
+#   python embed_assets.py
+# the header is only rewritten if an asset changed, so it does not trigger rebuilds.
+
+import gzip
+import hashlib
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+DATA_DIR = os.path.join(PROJECT_DIR, "data")
+HEADER = os.path.join(PROJECT_DIR, "include", "WebAssets.hpp")
+
+# style.css is referenced with its hash, so it can be cached forever.
+# the page itself is revalidated with its ETag on every load.
+CACHE_IMMUTABLE = "public, max-age=31536000, immutable"
+CACHE_REVALIDATE = "no-cache"
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};:,])\s*", r"\1", text)
+    return text.replace(";}", "}").strip()
+
+
+def minify_html(text):
+    # keeps the line breaks - the script may rely on them
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line)
+
+
+def etag(data):
+    return '"' + hashlib.sha1(data).hexdigest()[:16] + '"'
+
+
+def compress(text):
+    # mtime 0 - the output depends on the content only
+    return gzip.compress(text.encode("utf-8"), compresslevel=9, mtime=0)
+
+
+def read(name):
+    with open(os.path.join(DATA_DIR, name), "r", newline="") as f:
+        return f.read()
+
+
+def c_array(name, data):
+    lines = []
+    for n in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[n:n + 16]) + ",")
+    return "static const uint8_t %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def build():
+    css = compress(minify_css(read("style.css")))
+    css_tag = etag(css)
+
+    html = minify_html(read("index.html"))
+    html = html.replace('href="style.css"', 'href="style.css?v=%s"' % css_tag.strip('"')[:8])
+    html = compress(html)
+
+    assets = [
+        ("/", "text/html", "index_html", html, CACHE_REVALIDATE),
+        ("/style.css", "text/css", "style_css", css, CACHE_IMMUTABLE),
+    ]
+
+    out = [
+        "// generated by embed_assets.py from data/ - do not edit",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "typedef struct WebAsset {",
+        "  const char *path;",
+        "  const char *type;",
+        "  const uint8_t *data;  // gzip",
+        "  size_t length;",
+        "  const char *etag;",
+        "  const char *cache;    // Cache-Control",
+        "} WebAsset_t;",
+        "",
+    ]
+    for path, mime, name, data, cache in assets:
+        out.append(c_array(name, data))
+    out.append("static const WebAsset_t web_assets[] = {")
+    for path, mime, name, data, cache in assets:
+        out.append('  {"%s", "%s", %s, sizeof(%s), "%s", "%s"},'
+                   % (path, mime, name, name, etag(data).replace('"', '\\"'), cache))
+    out.append("};")
+    text = "\n".join(out) + "\n"
+
+    if os.path.exists(HEADER):
+        with open(HEADER, "r") as f:
+            if f.read() == text:
+                return
+    with open(HEADER, "w") as f:
+        f.write(text)
+    print("embed_assets: %s updated" % os.path.relpath(HEADER, PROJECT_DIR))
+
+
+build()
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+// raw ADC access and calibration, so the acquisition can run against
+// the ESP32 ADC as well as against synthetic sources
+class ADCSource
+{
+public:
+  virtual ~ADCSource() {}
+  virtual int32_t readRaw(uint32_t channel) = 0;  // raw counts, negative on error
+  virtual float rawToMillivolts(float raw) = 0;  // calibration - raw may be fractional
+};
+
+
+// oversampled burst over all channels
+// channels are read round robin (0, 1, 2, 0, 1, 2, ..), so every channel
+// sees the same time-window and the averaged values form one time-aligned set.
+// calibration is applied once per channel and burst on the averaged raw value.
+template<uint32_t CHANNELS>
+class ADCBurst
+{
+public:
+  ADCBurst(ADCSource *source, const uint32_t (&channels)[CHANNELS]) :
+    source_(source)
+  {
+    for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      channels_[ch] = channels[ch];
+  }
+
+  // returns false if any conversion failed - millivolts are not touched then
+  bool acquire(uint32_t oversampling, float (&millivolts)[CHANNELS])
+  {
+    uint32_t sum[CHANNELS] = {0};
+
+    for (uint32_t n = 0; n < oversampling; n++)
+    {
+      for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      {
+        int32_t raw = source_->readRaw(channels_[ch]);
+        if (raw < 0)
+          return false;
+        sum[ch] += raw;
+      }
+    }
+
+    for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      millivolts[ch] = source_->rawToMillivolts((float)sum[ch] / oversampling);
+
+    return true;
+  }
+
+private:
+  ADCSource *source_;
+  uint32_t channels_[CHANNELS];
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+// parameters of the lumped thermal boiler model
+typedef struct BoilerModel {
+  float heater_power;  // W - heater at 100%
+  float heater_tau;    // s - heat-up/cool-down time constant of the heater element
+  float capacity;      // J/K - water + boiler
+  float loss;          // W/K - loss to ambient
+  float pump_flow;     // W/K - heat carried away by fresh water at 100% pump
+  float temp_ambient;  // deg-C
+  float temp_inlet;    // deg-C - fresh water from the tank
+  float probe_tau_top;   // s - lag of the top probe behind the water temperature
+  float probe_tau_side;  // s - lag of the side probe behind the water temperature
+} BoilerModel_t;
+
+// kalman filter on the boiler model
+// state: water temperature, heater element output (0..1), top probe, side probe
+// inputs: heater duty and pump duty (0..1)
+// measurements: top and side probe
+class BoilerObserver
+{
+public:
+  BoilerObserver(const BoilerModel_t &model, float dt_s);
+  void reset(float temp);
+  // heater/pump duty applied during the last period, probes as measured now
+  void update(float heater_duty, float pump_duty, float temp_top, float temp_side);
+  float getWaterTemp() {return x_[X_WATER];};
+  float getHeaterState() {return x_[X_HEATER];};
+
+private:
+  enum {
+    X_WATER = 0,
+    X_HEATER,
+    X_TOP,
+    X_SIDE,
+    N = 4
+  };
+
+  void predict(float heater_duty, float pump_duty);
+  void correct(float temp_top, float temp_side);
+
+  BoilerModel_t model_;
+  float dt_;
+  float x_[N];     // state estimate
+  float p_[N][N];  // estimate covariance
+  float q_[N];     // process noise (diagonal)
+  float r_;        // measurement noise of a probe
+};
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// time series compression as described in "Gorilla: A Fast, Scalable,
+// In-Memory Time Series Database" (Facebook, VLDB 2015):
+//   timestamps: delta-of-delta with variable length prefix codes
+//   values:     XOR with the previous value, only the meaningful bits are stored
+//
+// a record is one timestamp (ms) plus CHANNELS float values. encoder and
+// decoder work on a caller provided byte buffer and keep no other memory.
+
+
+class BitWriter
+{
+public:
+  BitWriter() : buffer_(nullptr), size_bits_(0), pos_(0) {}
+
+  void begin(uint8_t *buffer, uint32_t size_bytes)
+  {
+    buffer_ = buffer;
+    size_bits_ = size_bytes * 8;
+    pos_ = 0;
+  }
+
+  bool fits(uint32_t bits) { return pos_ + bits <= size_bits_; }
+
+  // caller checks fits() first
+  void write(uint32_t value, uint32_t bits)
+  {
+    while (bits > 0)
+    {
+      uint32_t byte = pos_ >> 3;
+      uint32_t free_bits = 8 - (pos_ & 7);
+      uint32_t n = bits < free_bits ? bits : free_bits;
+      uint32_t mask = (1u << n) - 1;
+      uint32_t chunk = (value >> (bits - n)) & mask;
+
+      // clear first - a rolled back append may have left bits behind
+      buffer_[byte] &= ~(mask << (free_bits - n));
+      buffer_[byte] |= chunk << (free_bits - n);
+
+      pos_ += n;
+      bits -= n;
+    }
+  }
+
+  uint32_t getPosition() { return pos_; }
+  void setPosition(uint32_t pos) { pos_ = pos; }
+
+private:
+  uint8_t *buffer_;
+  uint32_t size_bits_;
+  uint32_t pos_;
+};
+
+
+class BitReader
+{
+public:
+  BitReader() : buffer_(nullptr), pos_(0) {}
+
+  void begin(const uint8_t *buffer)
+  {
+    buffer_ = buffer;
+    pos_ = 0;
+  }
+
+  uint32_t read(uint32_t bits)
+  {
+    uint32_t value = 0;
+    while (bits > 0)
+    {
+      uint32_t avail_bits = 8 - (pos_ & 7);
+      uint32_t n = bits < avail_bits ? bits : avail_bits;
+      uint32_t chunk = (buffer_[pos_ >> 3] >> (avail_bits - n)) & ((1u << n) - 1);
+
+      value = (value << n) | chunk;
+      pos_ += n;
+      bits -= n;
+    }
+    return value;
+  }
+
+  uint32_t getPosition() { return pos_; }
+
+private:
+  const uint8_t *buffer_;
+  uint32_t pos_;
+};
+
+
+static inline uint32_t gorilla_float_bits(float v)
+{
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+static inline float gorilla_bits_float(uint32_t bits)
+{
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static inline uint32_t gorilla_clz(uint32_t v) { return v ? __builtin_clz(v) : 32; }
+static inline uint32_t gorilla_ctz(uint32_t v) { return v ? __builtin_ctz(v) : 32; }
+
+
+template<uint32_t CHANNELS>
+class GorillaEncoder
+{
+public:
+  GorillaEncoder() : count_(0) {}
+
+  void begin(uint8_t *buffer, uint32_t size_bytes)
+  {
+    writer_.begin(buffer, size_bytes);
+    count_ = 0;
+  }
+
+  // returns false and leaves the buffer untouched, if the record does not fit anymore
+  bool append(uint32_t time_ms, const float (&values)[CHANNELS])
+  {
+    State backup = state_;
+    uint32_t pos = writer_.getPosition();
+
+    if (!encode(time_ms, values))
+    {
+      state_ = backup;
+      writer_.setPosition(pos);
+      return false;
+    }
+    count_++;
+    return true;
+  }
+
+  uint32_t getCount() { return count_; }
+  uint32_t getBits() { return writer_.getPosition(); }
+
+private:
+  typedef struct State {
+    uint32_t time;
+    int32_t delta;
+    uint32_t value[CHANNELS];
+    uint8_t leading[CHANNELS];   // window of the last stored meaningful bits
+    uint8_t trailing[CHANNELS];
+  } State;
+
+  bool put(uint32_t value, uint32_t bits)
+  {
+    if (!writer_.fits(bits))
+      return false;
+    writer_.write(value, bits);
+    return true;
+  }
+
+  bool encode(uint32_t time_ms, const float (&values)[CHANNELS])
+  {
+    if (count_ == 0)
+    {
+      // first record is stored raw
+      if (!put(time_ms, 32))
+        return false;
+      for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      {
+        state_.value[ch] = gorilla_float_bits(values[ch]);
+        state_.leading[ch] = 0xFF;
+        state_.trailing[ch] = 0;
+        if (!put(state_.value[ch], 32))
+          return false;
+      }
+      state_.time = time_ms;
+      state_.delta = 0;
+      return true;
+    }
+
+    int32_t delta = (int32_t)(time_ms - state_.time);
+    int32_t dod = delta - state_.delta;
+    bool ok;
+
+    if (dod == 0)
+      ok = put(0, 1);
+    else if (dod >= -63 && dod <= 64)
+      ok = put(0x2, 2) && put((uint32_t)dod & 0x7F, 7);
+    else if (dod >= -255 && dod <= 256)
+      ok = put(0x6, 3) && put((uint32_t)dod & 0x1FF, 9);
+    else if (dod >= -2047 && dod <= 2048)
+      ok = put(0xE, 4) && put((uint32_t)dod & 0xFFF, 12);
+    else
+      ok = put(0xF, 4) && put((uint32_t)dod, 32);
+
+    if (!ok)
+      return false;
+
+    state_.time = time_ms;
+    state_.delta = delta;
+
+    for (uint32_t ch = 0; ch < CHANNELS; ch++)
+    {
+      uint32_t bits = gorilla_float_bits(values[ch]);
+      uint32_t x = bits ^ state_.value[ch];
+      state_.value[ch] = bits;
+
+      if (x == 0)
+      {
+        if (!put(0, 1))
+          return false;
+        continue;
+      }
+
+      uint32_t leading = gorilla_clz(x);
+      uint32_t trailing = gorilla_ctz(x);
+      if (leading > 31)
+        leading = 31;  // 5 bit field
+
+      if (state_.leading[ch] != 0xFF && leading >= state_.leading[ch] && trailing >= state_.trailing[ch])
+      {
+        // fits into the previous window
+        uint32_t meaningful = 32 - state_.leading[ch] - state_.trailing[ch];
+        if (!put(0x2, 2) || !put(x >> state_.trailing[ch], meaningful))
+          return false;
+      }
+      else
+      {
+        // new window: 5 bit leading zeros, 6 bit length, meaningful bits
+        uint32_t meaningful = 32 - leading - trailing;
+        if (!put(0x3, 2) || !put(leading, 5) || !put(meaningful - 1, 6) || !put(x >> trailing, meaningful))
+          return false;
+        state_.leading[ch] = leading;
+        state_.trailing[ch] = trailing;
+      }
+    }
+    return true;
+  }
+
+  BitWriter writer_;
+  State state_;
+  uint32_t count_;
+};
+
+
+template<uint32_t CHANNELS>
+class GorillaDecoder
+{
+public:
+  GorillaDecoder() : index_(0) {}
+
+  void begin(const uint8_t *buffer)
+  {
+    reader_.begin(buffer);
+    index_ = 0;
+  }
+
+  // caller makes sure that not more than the encoded number of records are read
+  void next(uint32_t &time_ms, float (&values)[CHANNELS])
+  {
+    if (index_ == 0)
+    {
+      time_ = reader_.read(32);
+      delta_ = 0;
+      for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      {
+        value_[ch] = reader_.read(32);
+        leading_[ch] = 0;
+        trailing_[ch] = 0;
+      }
+    }
+    else
+    {
+      int32_t dod;
+      if (reader_.read(1) == 0)
+        dod = 0;
+      else if (reader_.read(1) == 0)
+        dod = signExtend(reader_.read(7), 7);
+      else if (reader_.read(1) == 0)
+        dod = signExtend(reader_.read(9), 9);
+      else if (reader_.read(1) == 0)
+        dod = signExtend(reader_.read(12), 12);
+      else
+        dod = (int32_t)reader_.read(32);
+
+      delta_ += dod;
+      time_ += delta_;
+
+      for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      {
+        if (reader_.read(1) == 0)
+          continue;
+
+        if (reader_.read(1) == 1)
+        {
+          leading_[ch] = reader_.read(5);
+          uint32_t meaningful = reader_.read(6) + 1;
+          trailing_[ch] = 32 - leading_[ch] - meaningful;
+        }
+        uint32_t meaningful = 32 - leading_[ch] - trailing_[ch];
+        value_[ch] ^= reader_.read(meaningful) << trailing_[ch];
+      }
+    }
+
+    index_++;
+    time_ms = time_;
+    for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      values[ch] = gorilla_bits_float(value_[ch]);
+  }
+
+  uint32_t getIndex() { return index_; }
+
+private:
+  // values in range [-(2^(bits-1)-1), 2^(bits-1)] - the upper bound is stored as all-zero-but-sign pattern
+  static int32_t signExtend(uint32_t v, uint32_t bits)
+  {
+    if (v > (1u << (bits - 1)))
+      return (int32_t)v - (int32_t)(1u << bits);
+    return (int32_t)v;
+  }
+
+  BitReader reader_;
+  uint32_t index_;
+  uint32_t time_;
+  int32_t delta_;
+  uint32_t value_[CHANNELS];
+  uint8_t leading_[CHANNELS];
+  uint8_t trailing_[CHANNELS];
+};
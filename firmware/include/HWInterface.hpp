@@ -1,6 +1,7 @@
 #pragma once
 
-class WaterControl;
+#include "WaterControl.hpp"
+
 class Button;
 
 class HWInterface
@@ -14,6 +15,8 @@ public:
   bool isActive();
   void powerOff();
   void powerOn();
+  bool setRemoteMode(WATERCTRL_State_t mode);  // applied by service(), holds until a switch is moved
+  bool isRemote() {return remote_;};
 
 private:
   Button *btn_power;
@@ -23,5 +26,11 @@ private:
   WaterControl *water_control_;
   bool power_trigger_available_;
   uint32_t power_state_;  // 0 if off or ms since turn-on
+  volatile bool remote_;   // mode set over the api, switches ignored
+  uint32_t remote_switches_;  // switch positions when the remote mode was set
+  bool remote_pending_;  // remote_mode_ posted, guarded by hw_mux
+  WATERCTRL_State_t remote_mode_;
+  uint32_t readSwitches();
+  void applyRemoteMode(WATERCTRL_State_t mode);
 
 };
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Gorilla.hpp"
+
+// channels of every history record
+enum {
+  HISTORY_TEMP_TOP = 0,
+  HISTORY_TEMP_SIDE,
+  HISTORY_TEMP_BREWHEAD,
+  HISTORY_HEATER,
+  HISTORY_PUMP,
+  HISTORY_CHANNELS
+};
+
+// compressed in-RAM history of all sensor samples
+// two tiers of blocks, each block an independent gorilla stream:
+//   recent:  every sample at full rate, the last few minutes
+//   archive: one averaged record per ARCHIVE_PERIOD_MS, several hours
+// when all blocks of a tier are full, its oldest one gets overwritten.
+// a reader gets the archive up to the start of the recent tier, then full rate.
+class History
+{
+public:
+  History();
+  History(History const&) = delete;
+  void operator=(History const&)  = delete;
+  static History* getInstance();
+  static void record(uint32_t time_ms, const float (&values)[HISTORY_CHANNELS]);
+
+  static constexpr uint32_t RECENT_BLOCKS = 16;   // ~2 min at SENSORS_PERIOD_ACTIVE_MS, ~8 min idle
+  static constexpr uint32_t ARCHIVE_BLOCKS = 40;  // 3-8 h, depending on the sensor noise
+  static constexpr uint32_t ARCHIVE_PERIOD_MS = 1000;
+  static constexpr uint32_t BLOCK_SIZE = 1024;  // bytes
+  static constexpr float TEMP_RESOLUTION = 16.0f;  // 1/16 deg-C - keeps low mantissa bits zero
+  static constexpr size_t LINE_MAX = 64;  // longest CSV line
+
+  // position of a reader in the history - one per HTTP response
+  typedef struct Cursor {
+    uint32_t from_ms;
+    uint32_t to_ms;
+    uint32_t tier;        // tier currently read, the archive comes first
+    uint32_t recent_ms;   // archive records before, full rate records from here
+    uint32_t generation;  // block currently decoded, 0 = find first block
+    uint32_t record;      // records already decoded from this block
+    uint32_t count;       // records in the copy
+    bool header_sent;
+    bool done;
+    GorillaDecoder<HISTORY_CHANNELS> decoder;
+    uint8_t data[BLOCK_SIZE];  // copy of the block - decoded without holding the lock
+  } Cursor_t;
+
+  void beginCursor(Cursor_t &cursor, uint32_t from_ms, uint32_t to_ms);
+  // writes CSV lines to buffer (needs at least LINE_MAX bytes), returns 0 at the end
+  size_t read(Cursor_t &cursor, uint8_t *buffer, size_t max_len);
+
+  uint32_t getMemoryUsage();  // bytes reserved for the blocks
+  uint32_t getRecordCount();
+
+private:
+  enum {
+    TIER_ARCHIVE = 0,
+    TIER_RECENT,
+    TIERS
+  };
+
+  typedef struct Block {
+    uint32_t generation;  // increments every time a block gets (re-)started, 0 = unused
+    uint32_t first_ms;
+    uint32_t last_ms;
+    uint32_t count;
+    uint8_t data[BLOCK_SIZE];
+  } Block_t;
+
+  typedef struct Tier {
+    Block_t *blocks;
+    uint32_t size;        // blocks
+    uint32_t head;        // block currently written
+    uint32_t generation;
+    GorillaEncoder<HISTORY_CHANNELS> encoder;
+  } Tier_t;
+
+  void archive(uint32_t time_ms, const float (&values)[HISTORY_CHANNELS]);
+  void append(Tier_t &tier, uint32_t time_ms, const float (&values)[HISTORY_CHANNELS]);
+  void startBlock(Tier_t &tier, uint32_t idx);
+  Block_t *findBlock(Tier_t &tier, uint32_t min_generation, uint32_t from_ms);
+  Block_t *getBlock(Tier_t &tier, uint32_t generation);
+  bool loadBlock(Cursor_t &cursor);
+
+  Block_t *blocks_;
+  Tier_t tiers_[TIERS];
+  SemaphoreHandle_t mutex_;
+
+  // archive record being averaged - only touched by record()
+  float archive_sum_[HISTORY_CHANNELS];
+  uint32_t archive_invalid_;  // channels with a missing reading (999) in the period
+  uint32_t archive_count_;
+  uint32_t archive_start_ms_;
+};
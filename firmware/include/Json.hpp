@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ResponseWriter.hpp"
+
+// streams a JSON document into a ResponseWriter, never allocates.
+// separators are tracked per nesting level, keys are passed with each value
+// (nullptr inside arrays). NaN is written as null.
+// no Arduino dependencies - usable on the host.
+class JsonWriter
+{
+public:
+  static constexpr uint32_t DEPTH_MAX = 8;
+
+  JsonWriter(ResponseWriter &writer);
+  void beginObject(const char *key = nullptr);
+  void endObject();
+  void beginArray(const char *key = nullptr);
+  void endArray();
+  void addFloat(const char *key, float value, uint32_t decimals);
+  void addUInt(const char *key, uint32_t value);
+  void addInt(const char *key, int32_t value);
+  void addBool(const char *key, bool value);
+  void addString(const char *key, const char *value);
+
+private:
+  void next(const char *key);
+  void appendString(const char *text);
+
+  ResponseWriter &writer_;
+  uint32_t depth_;
+  bool first_[DEPTH_MAX + 1];  // no element yet on this level
+};
+
+// lookups in a flat JSON object like {"temp": 93.5, "mode": "steam"}.
+// nested values are skipped, false if the key is missing, of another type
+// or the document is malformed.
+bool json_get_float(const char *json, const char *key, float &value);
+bool json_get_uint(const char *json, const char *key, uint32_t &value);  // integer, no sign or fraction
+bool json_get_bool(const char *json, const char *key, bool &value);
+bool json_get_string(const char *json, const char *key, char *buffer, size_t size);  // unescaped
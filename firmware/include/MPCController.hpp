@@ -0,0 +1,196 @@
+#pragma once
+
+#include <stdint.h>
+
+// boiler model for the predictive controller, same plant as
+// simulation/python_pid/silvi_sim.py:
+//   dT/dt = power * h / C - r * (T^4 - T_amb^4) * T
+//   dh/dt = (u - h) / heater_lag      heater element output h
+// linearized around every table temperature. the element lag is modelled,
+// the remaining transport delay is a dead time.
+// the water drawn by the pump is known from the feed-forward, but not how
+// long it lasts - the prediction lets it fade with draw_fade.
+typedef struct MPCModel {
+  double heater_power;  // W - heater at 100%
+  double heater_lag;    // s - time constant of the heater element
+  double capacity;      // J/K
+  double loss_r;        // loss constant of the simulation
+  double temp_ambient;  // deg-C
+  double draw_fade;     // s - time constant of the known disturbance in the prediction
+  double ts;            // s - controller period
+  uint32_t dead_steps;  // dead time in controller periods
+  uint32_t horizon;     // coincidence point after the dead time, in controller periods
+  double cltr;          // s - desired closed loop response time
+} MPCModel_t;
+
+// series with range reduction - std::exp is not usable in constant expressions
+constexpr double mpc_exp(double x)
+{
+  uint32_t halvings = 0;
+  while (x > 0.5 || x < -0.5)
+  {
+    x /= 2;
+    halvings++;
+  }
+
+  double sum = 1.0;
+  double term = 1.0;
+  for (uint32_t i = 1; i < 16; i++)
+  {
+    term *= x / i;
+    sum += term;
+  }
+
+  for (uint32_t i = 0; i < halvings; i++)
+    sum *= sum;
+  return sum;
+}
+
+constexpr double mpc_pow(double x, uint32_t n)
+{
+  double r = 1.0;
+  for (uint32_t i = 0; i < n; i++)
+    r *= x;
+  return r;
+}
+
+
+// control law for every target temperature, generated at compile time.
+// covers 20 .. 140 deg-C in 10 deg-C steps, linear interpolation at runtime.
+class MPCTable
+{
+public:
+  static constexpr float TEMP_MIN = 20.0f;
+  static constexpr float TEMP_STEP = 10.0f;
+  static constexpr uint32_t SIZE = 13;
+  static constexpr uint32_t DEAD_STEPS_MAX = 32;
+
+  typedef struct Point {
+    float a;        // pole of the water temperature
+    float b;        // deg-C per % element output and period
+    float gain_y;   // % output per deg-C deviation
+    float gain_h;   // % output per % element output
+    float gain_d;   // % output per % disturbance
+    float gain_k;   // % output per % known disturbance, fading
+    float u_hold;   // % - output that holds the temperature
+  } Point_t;
+
+  constexpr MPCTable(const MPCModel_t &model) :
+    points_(),
+    element_(mpc_exp(-model.ts / model.heater_lag)),
+    fade_(mpc_exp(-model.ts / model.draw_fade)),
+    dead_steps_(model.dead_steps)
+  {
+    double ae = mpc_exp(-model.ts / model.heater_lag);
+    double ae_h = mpc_pow(ae, model.horizon);
+    double ak = mpc_exp(-model.ts / model.draw_fade);
+    double ak_h = mpc_pow(ak, model.horizon);
+    double lambda_h = mpc_exp(-3.0 * model.ts * model.horizon / model.cltr);
+
+    for (uint32_t i = 0; i < SIZE; i++)
+    {
+      double temp = TEMP_MIN + i * TEMP_STEP;
+      double t4 = mpc_pow(temp, 4);
+      double amb4 = mpc_pow(model.temp_ambient, 4);
+
+      // slope of the loss term, limited where the boiler barely loses heat
+      double slope = model.loss_r * (5 * t4 - amb4);
+      if (slope < 1e-5)
+        slope = 1e-5;
+      double loss = model.loss_r * (t4 - amb4) * temp;
+      if (loss < 0.0)
+        loss = 0.0;
+
+      double k = model.heater_power / 100.0 / model.capacity / slope;  // deg-C per %
+      double a = mpc_exp(-model.ts * slope);
+      double a_h = mpc_pow(a, model.horizon);
+      double b = k * (1.0 - a);
+
+      // deviation at the coincidence point from each part of the state
+      double from_d = k * (1.0 - a_h);                   // constant disturbance
+      double from_h = b * (a_h - ae_h) / (a - ae);       // element output decaying
+      double from_u = from_d - from_h;                   // constant output
+      double from_k = b * (a_h - ak_h) / (a - ak);       // known disturbance fading
+
+      // reach lambda^H of the predicted deviation at the coincidence point
+      points_[i].a = (float)a;
+      points_[i].b = (float)b;
+      points_[i].gain_y = (float)((lambda_h - a_h) / from_u);
+      points_[i].gain_h = (float)(-from_h / from_u);
+      points_[i].gain_d = (float)(-from_d / from_u);
+      points_[i].gain_k = (float)(-from_k / from_u);
+      points_[i].u_hold = (float)(loss * model.capacity / model.heater_power * 100.0);
+    }
+  }
+
+  Point_t lookup(float temp) const
+  {
+    if (!(temp > TEMP_MIN))
+      return points_[0];
+    float pos = (temp - TEMP_MIN) * (1.0f / TEMP_STEP);
+    uint32_t idx = (uint32_t)pos;
+    if (idx >= SIZE - 1)
+      return points_[SIZE - 1];
+    float frac = pos - idx;
+
+    Point_t p;
+    p.a = points_[idx].a + frac * (points_[idx + 1].a - points_[idx].a);
+    p.b = points_[idx].b + frac * (points_[idx + 1].b - points_[idx].b);
+    p.gain_y = points_[idx].gain_y + frac * (points_[idx + 1].gain_y - points_[idx].gain_y);
+    p.gain_h = points_[idx].gain_h + frac * (points_[idx + 1].gain_h - points_[idx].gain_h);
+    p.gain_d = points_[idx].gain_d + frac * (points_[idx + 1].gain_d - points_[idx].gain_d);
+    p.gain_k = points_[idx].gain_k + frac * (points_[idx + 1].gain_k - points_[idx].gain_k);
+    p.u_hold = points_[idx].u_hold + frac * (points_[idx + 1].u_hold - points_[idx].u_hold);
+    return p;
+  }
+
+  constexpr float getElementPole() const {return element_;}
+  constexpr float getFadePole() const {return fade_;}
+  constexpr uint32_t getDeadSteps() const {return dead_steps_;}
+
+private:
+  Point_t points_[SIZE];
+  float element_;  // pole of the heater element
+  float fade_;     // pole of the known disturbance
+  uint32_t dead_steps_;
+};
+
+
+// predictive functional control on the linearized model:
+//  - outputs still in the dead time are played through the model to predict
+//    the temperature and the element output at the end of the dead time
+//  - the element output is not measured, it follows the applied outputs through
+//    the model. heat still stored in the element after a long full-power phase
+//    (a shot) is part of the prediction.
+//  - the output is chosen so the prediction reaches a fixed fraction of the
+//    remaining error at the coincidence point
+//  - the pump draw is a known disturbance (the feed-forward in % heater),
+//    expected to fade within the horizon - heat for a draw that has ended
+//    arrives after the shot and overshoots.
+//  - an input disturbance (in % heater) is estimated from the one step
+//    prediction error; it covers model errors and the rest of the pump draw
+// one step costs a table interpolation and a loop over the dead time.
+class MPCController
+{
+public:
+  MPCController(const MPCTable *table, float disturbance_gain);
+  void reset();
+  // known: heat drawn by the pump in % heater. returns the output in %, not limited
+  float update(float target, float pv, float known);
+  void setApplied(float u);  // output actually applied after overrides/limits, incl. feed-forward
+
+  float getDisturbance() {return disturbance_;};
+  float getHoldOutput() {return point_.u_hold;};
+
+private:
+  const MPCTable *table_;
+  float disturbance_gain_;
+  MPCTable::Point_t point_;
+  float target_;
+  float disturbance_;  // % heater
+  float element_;      // % - element output, deviation from u_hold
+  float prediction_;   // deg-C deviation expected at the next step
+  bool prediction_valid_;
+  float outputs_[MPCTable::DEAD_STEPS_MAX];  // % deviation from u_hold, ring buffer
+  uint32_t idx_;  // oldest output
+};
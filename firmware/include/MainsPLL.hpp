@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+// software PLL on the edges of the mains zero-cross detector.
+// the edge interval is classified against the known cases (50/60 Hz, one edge
+// per half-cycle behind a bridge or one per full cycle). after LOCK_EDGES
+// intervals of the same case it locks and from then on tracks phase and
+// period with a PI loop:
+//   err = edge - predicted
+//   phase = predicted + err / 8
+//   period += err / 128
+// edges far from the prediction (noise, contact bounce) are ignored, missing
+// edges are bridged. without edges for LOST_PERIODS periods or with too many
+// outliers in a row it unlocks - the SSR timers then run free at nominal rate.
+// times are the lower 32bit of esp_timer in us, wrap-around is handled.
+// no Arduino dependencies - edge streams can be replayed on the host.
+
+typedef enum {
+  MAINS_UNLOCKED = 0,  // no usable edges, SSR timers run free
+  MAINS_LOCKED
+} MAINS_State_t;
+
+typedef struct MainsStats {
+  uint32_t edges;      // all edges seen
+  uint32_t outliers;   // edges ignored while locked
+  uint32_t missed;     // edges bridged while locked
+  uint32_t locks;
+  uint32_t losses;     // lock lost
+} MainsStats_t;
+
+class MainsPLL
+{
+public:
+  static constexpr uint32_t LOCK_EDGES = 8;     // consecutive plausible intervals to lock
+  static constexpr uint32_t LOST_PERIODS = 5;   // no edge for this long -> unlocked
+  static constexpr uint32_t MAX_OUTLIERS = 8;   // consecutive ignored edges -> unlocked
+
+  MainsPLL(uint32_t default_frequency);
+  void reset();
+  void edge(uint32_t time_us);  // from the GPIO ISR
+  void poll(uint32_t now_us);   // periodically, detects missing edges
+
+  MAINS_State_t getState() {return state_;};
+  bool isLocked() {return state_ == MAINS_LOCKED;};
+  uint32_t getFrequency() {return frequency_;};  // Hz - default until detected, then the last one locked to
+  uint32_t getHalfPeriodUs();  // mains half-cycle, nominal while unlocked
+  uint32_t getPhaseUs() {return phase_us_;};  // filtered time of the last zero-cross
+  void getStats(MainsStats_t &stats) {stats = stats_;};
+
+private:
+  typedef struct Nominal {
+    uint32_t interval_us;  // between two edges
+    uint32_t frequency;    // Hz
+    uint32_t edges_per_cycle;
+  } Nominal_t;
+
+  static constexpr uint32_t NOMINALS = 4;
+  static const Nominal_t nominals_[NOMINALS];
+
+  int32_t classify(uint32_t interval_us);
+  void lock(uint32_t time_us);
+  void unlock();
+
+  volatile MAINS_State_t state_;
+  volatile uint32_t frequency_;
+  uint32_t edges_per_cycle_;
+  int32_t candidate_;        // nominal of the acquisition, -1 = none
+  uint32_t candidate_count_;
+  uint32_t candidate_sum_us_;
+  uint32_t last_edge_us_;     // any edge
+  bool last_edge_valid_;
+  uint32_t last_good_us_;     // last edge used by the loop
+  volatile uint32_t phase_us_;
+  uint32_t phase_frac_;       // 1/256 us
+  uint32_t period_q8_;        // interval between edges in 1/256 us
+  uint32_t nominal_q8_;
+  uint32_t outliers_;         // consecutive
+  MainsStats_t stats_;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+// quadratic fit of a boiler probe:
+//   mV = c - a * (degC - offset) - b * (degC - offset)^2
+// inverted:
+//   degC = (a - sqrt(a^2 + 4 * b * (c - mV))) / (-2 * b) + offset
+typedef struct NTCCurve {
+  double a;
+  double b;
+  double c;
+  double offset;
+} NTCCurve_t;
+
+// newton iteration - std::sqrt is not usable in constant expressions
+constexpr double ntc_sqrt(double x)
+{
+  if (x <= 0.0)
+    return 0.0;
+
+  double r = x > 1.0 ? x : 1.0;
+  for (uint32_t i = 0; i < 64; i++)
+  {
+    double next = 0.5 * (r + x / r);
+    if (next >= r)
+      break;
+    r = next;
+  }
+  return r;
+}
+
+// reference conversion, same expression as used before the table existed
+constexpr double ntc_formula(const NTCCurve_t &curve, double mv)
+{
+  return (curve.a - ntc_sqrt(curve.a * curve.a + 4 * curve.b * (curve.c - mv))) / (2 * -curve.b) + curve.offset;
+}
+
+
+// mV -> deg-C table generated at compile time with linear interpolation at runtime
+// covers 512 .. 2560 mV (~150 .. ~10 deg-C for the boiler probes) in 64 mV steps
+class NTCTable
+{
+public:
+  static constexpr uint32_t MV_MIN = 512;
+  static constexpr uint32_t MV_STEP_SHIFT = 6;  // 64 mV
+  static constexpr uint32_t MV_STEP = 1u << MV_STEP_SHIFT;
+  static constexpr uint32_t SIZE = 33;
+  static constexpr uint32_t MV_MAX = MV_MIN + (SIZE - 1) * MV_STEP;
+
+  constexpr NTCTable(const NTCCurve_t &curve) :
+    degc_()
+  {
+    for (uint32_t i = 0; i < SIZE; i++)
+      degc_[i] = (float)ntc_formula(curve, MV_MIN + i * MV_STEP);
+  }
+
+  // returns 999 if mv is outside of the table
+  float convert(float mv) const
+  {
+    if (!(mv >= MV_MIN && mv < MV_MAX))
+      return 999.0f;
+
+    float pos = mv - MV_MIN;
+    uint32_t idx = (uint32_t)pos >> MV_STEP_SHIFT;
+    float frac = (pos - (float)(idx << MV_STEP_SHIFT)) * (1.0f / MV_STEP);
+
+    return degc_[idx] + frac * (degc_[idx + 1] - degc_[idx]);
+  }
+
+  // largest deviation from ntc_formula on every integer mV in the table range,
+  // evaluated by the compiler to check the bound with a static_assert
+  constexpr double maxError(const NTCCurve_t &curve) const
+  {
+    double max_err = 0.0;
+    for (uint32_t mv = MV_MIN; mv < MV_MAX; mv++)
+    {
+      uint32_t idx = (mv - MV_MIN) >> MV_STEP_SHIFT;
+      double frac = (double)((mv - MV_MIN) - (idx << MV_STEP_SHIFT)) / MV_STEP;
+      double err = degc_[idx] + frac * (degc_[idx + 1] - degc_[idx]) - ntc_formula(curve, mv);
+      if (err < 0)
+        err = -err;
+      if (err > max_err)
+        max_err = err;
+    }
+    return max_err;
+  }
+
+private:
+  float degc_[SIZE];
+};
@@ -2,9 +2,13 @@
 
 #include <Arduino.h>
 #include "coffee_config.hpp"
+#include "PIDKernel.hpp"
 
 class WaterControl;
 class SSRHeater;
+class BoilerObserver;
+class MPCController;
+class RelayAutotune;
 
 
 typedef enum {
@@ -12,10 +16,49 @@ typedef enum {
   PID_MODE_STEAM
 } PID_Mode_t;
 
+typedef enum {
+  PID_PV_PROBES,    // heuristic on top/side probe
+  PID_PV_OBSERVER   // water temperature estimated by BoilerObserver, steam keeps the maximum probe
+} PID_PVSource_t;
+
+typedef enum {
+  PID_ALGO_PID,  // incremental PID type C
+  PID_ALGO_MPC   // predictive controller on the FOPDT boiler model
+} PID_Algorithm_t;
+
+
+typedef enum {
+  PID_REGIME_WARMUP = 0,    // far below the target, e.g. after power on
+  PID_REGIME_IDLE,          // holding the brew temperature
+  PID_REGIME_SHOT,          // shot in progress
+  PID_REGIME_STEAM,         // steam mode
+  PID_REGIME_STEAM_RETURN,  // cooling down from steam to the brew temperature
+  PID_REGIME_COUNT
+} PID_Regime_t;
+
+typedef struct PIDGains {
+  float p_pos;    // if PV_old > PV
+  float p_neg;    // if PV_old < PV
+  float i;
+  float d;
+  float out_min;  // % - limits of the PID output, before feed-forward
+  float out_max;  // %
+} PIDGains_t;
+
+typedef struct PIDRegimeSwitch {
+  uint32_t time_ms;
+  PID_Regime_t from;
+  PID_Regime_t to;
+  float pv;  // deg-C
+  float u;   // % - output carried over
+} PIDRegimeSwitch_t;
+
 
 #define PID_MIN_TEMP   10.0f  // deg-C - minimum allowed temperature
 #define PID_MAX_TEMP  139.0f  // deg-C - maximum allowed temperature
 
+#define PID_SWITCH_LOG_SIZE  16  // regime switches kept for /pid/regimes
+
 
 class PIDHeater
 {
@@ -30,33 +73,70 @@ public:
   float getPShare() {return p_share_;};
   float getIShare() {return i_share_;};
   float getDShare() {return d_share_;};
+  float getFFShare() {return ff_share_;};
   float getUncorrectedOutput() {return u_;};
+  void setFFGain(float gain) {ff_gain_ = gain;};  // % heater per % pump
+  void setPVSource(PID_PVSource_t source) {pv_source_ = source;};
+  PID_PVSource_t getPVSource() {return pv_source_;};
+  float getWaterTempEstimate();
+  void setAlgorithm(PID_Algorithm_t algorithm);
+  PID_Algorithm_t getAlgorithm() {return algorithm_;};
+  bool startAutotune(float setpoint);
+  void stopAutotune();
+  RelayAutotune *getAutotune() {return autotune_;};
+  uint32_t getSampleAgeUs() {return sample_age_us_;};
+  uint32_t getSampleAgeMaxUs() {return sample_age_max_us_;};
+  uint32_t getSteps() {return steps_;};
+  PID_Regime_t getRegime() {return regime_;};
+  static const char *getRegimeName(PID_Regime_t regime);
+  bool setRegimeGains(PID_Regime_t regime, const PIDGains_t &gains);
+  void getRegimeGains(PID_Regime_t regime, PIDGains_t &gains);
+  uint32_t getSwitchLog(PIDRegimeSwitch_t *log, uint32_t size);
 
 private:
   WaterControl *water_control_;
   SSRHeater *heater_;
-  float kPpos_;  // positive contribution, if PV_old > PV
-  float kPneg_;  // negative contribution, if PV_old < PV
-  float kI_;
-  float kD_;
+  PIDGains_t gains_[PID_REGIME_COUNT];  // gain schedule
+  bool gains_changed_;  // table was loaded, apply at the next step
+  PID_Regime_t regime_;
+  PID_Mode_t kernel_mode_;  // mode the process values in the kernel belong to
+  PIDRegimeSwitch_t switch_log_[PID_SWITCH_LOG_SIZE];
+  uint32_t switch_count_;
   uint32_t ts_;  // ms - update interval
+  PIDKernel kernel_;  // fixed point PID, keeps the last output and process values
   float u_;  // uncorrected output value
   float p_share_, i_share_, d_share_;  // influences of the controller parts
-  float u1_;  // last output value
-  float pv1_;  // last process value (temperature)
-  float pv2_;  // second to last process value (temperature)
+  float ff_gain_;  // % heater per % pump
+  float ff_share_;  // feed-forward on top of the feedback output
   float target_;  // deg-C - target boiler temperature
   PID_Mode_t mode_;
+  PID_PVSource_t pv_source_;
+  BoilerObserver *observer_;
+  PID_Algorithm_t algorithm_;
+  MPCController *mpc_;
+  RelayAutotune *autotune_;  // only touched by the PID task
+  bool autotune_start_;  // requests from other tasks, under gains_mux
+  bool autotune_stop_;
+  float autotune_setpoint_;
   float u_override_;  // override next PID iteration with this value if positive
   int8_t u_override_cnt_;  // counter for how many PID cycles the override should be in place
   bool enabled_;
+  uint32_t next_step_us_;  // sample time the next control step is due
+  bool resync_;  // take the next sample as step, e.g. after start
+  uint32_t sample_age_us_;  // age of the sample the last step used, at heater update
+  uint32_t sample_age_max_us_;
+  uint32_t steps_;
 
-  SemaphoreHandle_t sem_update_;
-  TimerHandle_t timer_update_;
   TaskHandle_t task_handle_;
 
-  static void timer_cb_wrapper(TimerHandle_t arg);
-  void timer_cb();
+  bool isStepDue(uint32_t sample_us);
+  PID_Regime_t selectRegime(float pv);
+  void applyRegime(PID_Regime_t regime, float pv);
   static void task_wrapper(void *arg);
   void task();
+  float getPumpForecast();
+  float getFFGain();
+  void serviceAutotune();
+  void reportAutotune();
+  void publishSnapshot();
 };
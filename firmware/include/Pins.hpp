@@ -18,6 +18,8 @@ public:
   static constexpr uint32_t ssr_heater = 26;
   static constexpr uint32_t ssr_valve = 33;
 
+  static constexpr uint32_t mains_zerocross = 35;  // input only, needs an external pull
+
   static constexpr adc1_channel_t sensor_side = ADC1_CHANNEL_6;
   static constexpr adc1_channel_t sensor_top = ADC1_CHANNEL_0;
   static constexpr adc1_channel_t sensor_brewhead = ADC1_CHANNEL_3;
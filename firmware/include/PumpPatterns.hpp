@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+// on/off patterns of the pump SSR, one bit per full sine period.
+// every duty of 0..100 % gets a pattern of 100 periods, generated at compile
+// time: period n is on, if ceil((n + 1) * duty / 100) > ceil(n * duty / 100).
+// the on-periods are spread as evenly as possible (runs differ by at most one
+// period), the first period of each pattern is on and every pattern delivers
+// exactly its duty over the 100 periods.
+// 101 patterns * 4 words = 1616 bytes.
+// no Arduino dependencies - the table can be checked on the host.
+class PumpPatterns
+{
+public:
+  static constexpr uint32_t STEPS = 100;  // duty 0..STEPS, pattern length in periods
+  static constexpr uint32_t WORDS = (STEPS + 31) / 32;
+
+  constexpr PumpPatterns() :
+    bits_()
+  {
+    for (uint32_t duty = 0; duty <= STEPS; duty++)
+      for (uint32_t n = 0; n < STEPS; n++)
+        if (((n + 1) * duty + STEPS - 1) / STEPS > (n * duty + STEPS - 1) / STEPS)
+          bits_[duty][n / 32] |= 1u << (n % 32);
+  }
+
+  // duty <= STEPS, n < STEPS
+  __attribute__((always_inline)) inline bool isOn(uint32_t duty, uint32_t n) const
+  {
+    return (bits_[duty][n >> 5] >> (n & 31)) & 1u;
+  }
+
+private:
+  uint32_t bits_[STEPS + 1][WORDS];
+};
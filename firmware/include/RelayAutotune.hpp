@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+
+// relay feedback experiment after Astrom/Hagglund:
+// the heater is switched between two outputs around the setpoint, the boiler
+// settles into a limit cycle. its amplitude and period give the ultimate gain
+// Ku and period Pu. the time between a switch and the turn of the temperature
+// is reported as turn time: the apparent dead time, i.e. the pure dead time
+// plus the lag of the heater element - not a model dead time.
+// no Arduino dependencies - time and temperature are passed in, so the state
+// machine can be run against a simulated boiler on the host.
+
+typedef enum {
+  AUTOTUNE_IDLE = 0,
+  AUTOTUNE_HEATUP,   // relay high until the setpoint is crossed the first time
+  AUTOTUNE_RELAY,    // oscillating
+  AUTOTUNE_DONE,
+  AUTOTUNE_ABORTED
+} AUTOTUNE_State_t;
+
+typedef enum {
+  AUTOTUNE_ABORT_NONE = 0,
+  AUTOTUNE_ABORT_USER,
+  AUTOTUNE_ABORT_OVERTEMP,    // above setpoint + max_overshoot
+  AUTOTUNE_ABORT_SENSOR,      // invalid temperature
+  AUTOTUNE_ABORT_TIMEOUT,     // whole run too long
+  AUTOTUNE_ABORT_NO_SWITCH,   // half cycle too long or no usable amplitude
+  AUTOTUNE_ABORT_DISTURBANCE, // e.g. pump running
+} AUTOTUNE_Abort_t;
+
+typedef struct AutotuneConfig {
+  float setpoint;        // deg-C
+  float output_high;     // % - relay on
+  float output_low;      // % - relay off
+  float hysteresis;      // deg-C - against noise
+  uint32_t cycles;       // full cycles to average, after the first one is dropped
+  float max_overshoot;   // deg-C - abort above setpoint + max_overshoot
+  float min_temp;        // deg-C - abort below (sensor failure)
+  uint32_t timeout_ms;   // whole run
+  uint32_t half_cycle_ms;  // longest time between two switches
+} AutotuneConfig_t;
+
+// gains in the form used by PIDHeater
+typedef struct AutotuneGains {
+  float p;
+  float i;
+  float d;
+} AutotuneGains_t;
+
+typedef struct AutotuneResult {
+  float ku;            // % per deg-C
+  float pu;            // s
+  float turn_time;     // s - relay switch to the extreme of the temperature
+  float amplitude;     // deg-C - peak to peak / 2
+  AutotuneGains_t classic;     // Ziegler-Nichols PID
+  AutotuneGains_t no_overshoot;  // Ziegler-Nichols "no overshoot" PID
+  AutotuneGains_t pi;          // Ziegler-Nichols PI
+} AutotuneResult_t;
+
+
+class RelayAutotune
+{
+public:
+  RelayAutotune();
+  bool start(const AutotuneConfig_t &config, uint32_t time_ms);  // false for a non-finite config
+  void stop();
+  void abort(AUTOTUNE_Abort_t reason);
+  // call every controller period, returns the heater output in %
+  float update(uint32_t time_ms, float pv);
+
+  AUTOTUNE_State_t getState() {return state_;};
+  AUTOTUNE_Abort_t getAbortReason() {return abort_reason_;};
+  bool isRunning() {return state_ == AUTOTUNE_HEATUP || state_ == AUTOTUNE_RELAY;};
+  uint32_t getCycles() {return cycles_;};
+  const AutotuneResult_t &getResult() {return result_;};
+  const AutotuneConfig_t &getConfig() {return config_;};
+
+private:
+  void switchRelay(uint32_t time_ms, bool high);
+  void finish();
+
+  AutotuneConfig_t config_;
+  AutotuneResult_t result_;
+  AUTOTUNE_State_t state_;
+  AUTOTUNE_Abort_t abort_reason_;
+
+  bool relay_high_;
+  uint32_t start_ms_;
+  uint32_t switch_ms_;       // last relay switch
+  uint32_t rise_ms_;         // last switch to high - start of a cycle
+  bool rise_valid_;
+  uint32_t peak_ms_;         // time of the extreme value
+  float peak_;               // extreme value of the current half cycle
+  uint32_t cycles_;          // full cycles completed
+
+  // sums over the averaged cycles
+  float sum_period_;
+  float sum_max_;
+  float sum_min_;
+  float sum_turn_;
+  uint32_t count_max_;
+  uint32_t count_min_;
+  uint32_t count_turn_;
+};
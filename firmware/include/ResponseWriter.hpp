@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// formats text and numbers into a fixed buffer, never allocates.
+// output beyond the buffer is dropped and flagged, the buffer always stays
+// null-terminated.
+// no Arduino dependencies - usable on the host.
+class ResponseWriter
+{
+public:
+  ResponseWriter(char *buffer, size_t size);
+  void clear();
+  void append(const char *text);
+  void append(const char *text, size_t length);
+  void appendUInt(uint32_t value);
+  void appendInt(int32_t value);
+  void appendFloat(float value, uint32_t decimals);  // fixed point, decimals <= 6
+
+  const char *c_str() {return buffer_;};
+  size_t length() {return length_;};
+  bool overflow() {return overflow_;};
+
+private:
+  char *buffer_;
+  size_t size_;
+  size_t length_;
+  bool overflow_;
+};
+
+// fixed buffers for response bodies that are sent after the handler returned.
+// a buffer belongs to one response until it is released (when the request is
+// gone), with all of them taken the caller refuses the request - never allocates.
+// not thread safe - the web server runs all handlers and callbacks in one task.
+class ResponsePool
+{
+public:
+  static constexpr uint32_t COUNT_MAX = 32;
+
+  ResponsePool(char *buffers, size_t size, uint32_t count);  // count <= COUNT_MAX
+  char *acquire();  // nullptr if all are in use
+  void release(char *buffer);
+  size_t getSize() const {return size_;};
+  uint32_t getUsed() const;
+
+private:
+  char *buffers_;
+  size_t size_;
+  uint32_t count_;
+  uint32_t used_;  // one bit per buffer
+};
+
+// template with %NAME% placeholders. the text is split once into literal
+// runs and field references, rendering then only copies runs and calls the
+// filler per field - no lookups by name per request.
+// the template text must outlive the object.
+class ResponseTemplate
+{
+public:
+  typedef void (*Filler)(uint32_t field, ResponseWriter &writer, const void *arg);
+  static constexpr uint32_t PARTS_MAX = 32;
+
+  // fields: placeholder names, the index is passed to the filler
+  ResponseTemplate(const char *text, const char *const *fields, uint32_t field_count);
+  bool isValid() const {return valid_;};  // false on an unknown placeholder or too many parts
+  void render(ResponseWriter &writer, Filler filler, const void *arg) const;
+
+private:
+  typedef struct Part {
+    uint16_t offset;  // literal run in text_
+    uint16_t length;
+    int16_t field;    // -1 = literal
+  } Part_t;
+
+  const char *text_;
+  Part_t parts_[PARTS_MAX];
+  uint32_t part_count_;
+  bool valid_;
+};
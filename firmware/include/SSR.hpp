@@ -3,6 +3,8 @@
 #include <Arduino.h>
 #include <atomic>
 
+// the output is written by the SSRScheduler at the next half-cycle,
+// disable() switches off at once
 class SSR
 {
 public:
@@ -12,10 +14,13 @@ public:
   bool isEnabled();
   void on();
   void off();
+  bool isOn();
+  uint8_t getPin() {return ctrl_pin_;};
 
 protected:
   std::atomic<bool> enabled_;
 
 private:
   uint8_t ctrl_pin_;
+  volatile bool state_;  // requested level
 };
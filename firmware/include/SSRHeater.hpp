@@ -2,19 +2,22 @@
 
 #include <Arduino.h>
 #include "SSR.hpp"
+#include "SigmaDelta.hpp"
 
 class SSRHeater: public SSR
 {
 public:
-  SSRHeater(uint8_t ctrl_pin, int32_t timer_id, uint32_t timer_period_us);
+  SSRHeater(uint8_t ctrl_pin);
   SSRHeater(SSRHeater const&) = delete;
   void operator=(SSRHeater const&)  = delete;
   static SSRHeater* getInstance();
   void sync();
   void setPWM(uint8_t percent);
   uint8_t getPWM();
+  void setDuty(uint32_t permille);  // 0..1000 - sub-percent resolution
+  uint32_t getDuty();
+  bool nextHalfCycle();  // SSRScheduler: switch the coming half-cycle on?
 
 private:
-  hw_timer_t *timer_pwm_;
-  uint8_t pwm_percent_;
+  SigmaDelta modulator_;
 };
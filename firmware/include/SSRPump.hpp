@@ -20,17 +20,22 @@ typedef enum PWM_Percent {
 class SSRPump: public SSR
 {
 public:
-  SSRPump(uint8_t ctrl_pin, int32_t timer_id, uint32_t timer_period_us);
+  SSRPump(uint8_t ctrl_pin);
   SSRPump(SSRPump const&) = delete;
   void operator=(SSRPump const&)  = delete;
 
   static SSRPump* getInstance();
 
-  void setPWM(uint8_t percent);
-  PWM_Percent_t getPWM();
+  void setPWM(uint8_t percent);  // 1% steps, < 5% is off
+  uint8_t getPWM();
+  void setSoftStart(uint32_t ramp_ms);  // ms from 0 to 100%, 0 = off
+  bool nextPeriod(uint32_t period_us);  // SSRScheduler: switch the coming full sine period on?
 
 private:
-  hw_timer_t *timer_pwm_;
-  volatile PWM_Percent_t pwm_percent_;
-  uint32_t time_on_;
+  uint32_t nextDuty(uint32_t period_us);
+
+  volatile uint8_t pwm_percent_;
+  volatile uint32_t ramp_ms_;
+  uint32_t applied_;  // 1/1000 % - duty after the soft-start ramp
+  uint32_t pattern_pos_;  // elapsed periods of the pattern
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+
+class SSR;
+class SSRHeater;
+class SSRPump;
+
+typedef struct SchedulerStats {
+  uint32_t ticks;
+  uint32_t cycles_max;     // ISR run time
+  uint64_t cycles_sum;
+  uint32_t jitter_max_us;  // deviation of the tick interval from the half-cycle
+  uint32_t syncs;          // phase corrections from the zero-cross input
+} SchedulerStats_t;
+
+// one hardware timer at mains half-cycle rate drives all SSR outputs.
+// every tick evaluates the heater modulator (every half-cycle), the pump
+// pattern (every full sine period) and the valve level, then writes all
+// pins with one set and one clear register access per GPIO bank.
+// a subscribed task is notified at the start of every pump period while it
+// asks for it (setNotify) - a pump duty written before the next one is
+// applied exactly at its start. otherwise the subscriber is left alone.
+// the ISR measures its run time in cycles and the tick interval against the
+// half-cycle: GET /stats, cleared by POST /stats/reset. the decisions of a
+// tick (modulator, pump pattern) are host tested with benchmarks in
+// test/test_sigma_delta and test/test_pump_patterns.
+class SSRScheduler
+{
+public:
+  SSRScheduler(int32_t timer_id, uint32_t half_period_us);
+  SSRScheduler(SSRScheduler const&) = delete;
+  void operator=(SSRScheduler const&)  = delete;
+  static SSRScheduler* getInstance();
+
+  void setHeater(SSRHeater *heater);
+  void setPump(SSRPump *pump);
+  void setValve(SSR *valve);
+  void setSubscriber(TaskHandle_t task) {subscriber_ = task;};
+  void setNotify(bool notify) {notify_ = notify;};  // pump period notifications on/off
+  void getPeriod(uint32_t &start_us, uint32_t &period_us);  // last pump period
+  void syncMains(int32_t since_us, uint32_t half_period_us);  // ISR: us since the last zero-cross
+  void freeRun(uint32_t half_period_us);
+  bool isMainsLocked() {return mains_locked_;};
+  uint32_t getHalfPeriodUs() {return half_period_us_;};
+  void getStats(SchedulerStats_t &stats);
+  uint32_t getHalfCycles() {return half_cycles_;};  // since boot, not reset with the stats
+  uint32_t getHeaterHalfCycles() {return heater_on_;};  // switched on, since boot
+  void resetStats();
+  void tick();  // ISR
+
+private:
+  hw_timer_t *timer_;
+  SSRHeater *heater_;
+  SSRPump *pump_;
+  SSR *valve_;
+  uint32_t pin_heater_, pin_pump_, pin_valve_;
+  volatile uint32_t half_period_us_;
+  volatile bool mains_locked_;
+  volatile uint32_t half_cycles_;
+  volatile uint32_t heater_on_;
+  bool pump_on_;  // held for the second half of the sine period
+  uint32_t last_tick_us_;
+  uint32_t period_start_us_;
+  TaskHandle_t subscriber_;
+  volatile bool notify_;
+  bool skip_jitter_;  // interval after a phase correction is not jitter
+  SchedulerStats_t stats_;
+};
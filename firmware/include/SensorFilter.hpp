@@ -0,0 +1,294 @@
+#pragma once
+
+#include <stdint.h>
+
+// composable per-sample filter stages for the temperature sensors
+//
+// every stage provides:
+//   float process(float x)     - feed one sample, get filtered value
+//   void reset(float x)        - pre-fill the stage as if x was applied forever
+//   delay()                    - group delay in samples (at DC)
+//   ops()                      - rough cost per sample (compares + arithmetic)
+//
+// stages are chained at compile time with FilterChain<Stage1, Stage2, ..>
+// and handed to a Sensor via the SensorFilter interface.
+
+
+// median of the last N samples - removes single spikes without smearing steps
+template<uint32_t N>
+class MedianFilter
+{
+  static_assert(N % 2 == 1, "MedianFilter: N must be odd");
+
+public:
+  MedianFilter() : idx_(0) { reset(0.0f); }
+
+  float process(float x)
+  {
+    float sorted[N];
+
+    buffer_[idx_] = x;
+    idx_ = (idx_ + 1) % N;
+
+    // insertion sort - N is small
+    for (uint32_t i = 0; i < N; i++)
+    {
+      float v = buffer_[i];
+      uint32_t j = i;
+      while (j > 0 && sorted[j - 1] > v)
+      {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = v;
+    }
+    return sorted[N / 2];
+  }
+
+  void reset(float x)
+  {
+    for (uint32_t i = 0; i < N; i++)
+      buffer_[i] = x;
+  }
+
+  static constexpr float delay() { return (N - 1) / 2.0f; }
+  static constexpr uint32_t ops() { return N * (N - 1) / 2 + N; }
+
+private:
+  float buffer_[N];
+  uint32_t idx_;
+};
+
+
+// boxcar average of the last N samples with a running sum (O(1) per sample)
+// the sum is rebuilt once per buffer round to keep float rounding from drifting
+template<uint32_t N>
+class RunningAverage
+{
+public:
+  RunningAverage() : idx_(0), sum_(0.0f) { reset(0.0f); }
+
+  float process(float x)
+  {
+    sum_ += x - buffer_[idx_];
+    buffer_[idx_] = x;
+
+    if (++idx_ >= N)
+    {
+      idx_ = 0;
+      sum_ = 0.0f;
+      for (uint32_t i = 0; i < N; i++)
+        sum_ += buffer_[i];
+    }
+    return sum_ / N;
+  }
+
+  void reset(float x)
+  {
+    for (uint32_t i = 0; i < N; i++)
+      buffer_[i] = x;
+    sum_ = x * N;
+    idx_ = 0;
+  }
+
+  static constexpr float delay() { return (N - 1) / 2.0f; }
+  static constexpr uint32_t ops() { return 4 + 1; }  // +1: amortized re-sum
+
+private:
+  float buffer_[N];
+  uint32_t idx_;
+  float sum_;
+};
+
+
+// least squares line through the last N samples, evaluated D samples back.
+// on DC and ramps the output lags by D samples, while the white noise is still
+// averaged over all N samples. the price are negative weights on the oldest
+// samples: a kink in the signal shows up late and a step overshoots (~25%).
+// running sums (O(1) per sample), rebuilt once per buffer round like RunningAverage
+template<uint32_t N, uint32_t D>
+class LinearFit
+{
+  static_assert(N >= 2 && D < N, "LinearFit: needs N >= 2 and D < N");
+
+public:
+  LinearFit() : idx_(0), sum_(0.0f), sum_centered_(0.0f) { reset(0.0f); }
+
+  float process(float x)
+  {
+    // every sample gets one older, the oldest one drops out
+    float oldest = buffer_[idx_];
+    sum_centered_ += sum_ - (N - MEAN_AGE) * oldest - MEAN_AGE * x;
+    sum_ += x - oldest;
+    buffer_[idx_] = x;
+
+    if (++idx_ >= N)
+    {
+      // the newest sample is at N - 1
+      idx_ = 0;
+      sum_ = 0.0f;
+      sum_centered_ = 0.0f;
+      for (uint32_t age = 0; age < N; age++)
+      {
+        sum_ += buffer_[N - 1 - age];
+        sum_centered_ += (age - MEAN_AGE) * buffer_[N - 1 - age];
+      }
+    }
+
+    // line: mean + slope * (age - mean age)
+    float slope = sum_centered_ / AGE_VARIANCE;
+    return sum_ / N + slope * (D - MEAN_AGE);
+  }
+
+  void reset(float x)
+  {
+    for (uint32_t i = 0; i < N; i++)
+      buffer_[i] = x;
+    sum_ = x * N;
+    sum_centered_ = 0.0f;
+    idx_ = 0;
+  }
+
+  static constexpr float delay() { return D; }
+  static constexpr uint32_t ops() { return 9 + 3; }  // +3: amortized re-sum
+
+private:
+  static constexpr float MEAN_AGE = (N - 1) / 2.0f;
+  static constexpr float AGE_VARIANCE = N * (N * N - 1) / 12.0f;  // sum of (age - mean age)^2
+
+  float buffer_[N];
+  uint32_t idx_;
+  float sum_;
+  float sum_centered_;  // sum of (age - mean age) * sample, the newest sample has age 0 - small, keeps float precision
+};
+
+
+// exponential moving average with alpha = NUM / DEN
+template<uint32_t NUM, uint32_t DEN>
+class EMAFilter
+{
+  static_assert(NUM > 0 && NUM <= DEN, "EMAFilter: alpha must be in (0, 1]");
+
+public:
+  EMAFilter() : y_(0.0f) {}
+
+  float process(float x)
+  {
+    y_ += ((float)NUM / DEN) * (x - y_);
+    return y_;
+  }
+
+  void reset(float x) { y_ = x; }
+
+  static constexpr float delay() { return (float)(DEN - NUM) / NUM; }
+  static constexpr uint32_t ops() { return 3; }
+
+private:
+  float y_;
+};
+
+
+// first order lead/lag (1 + T_lead*s) / (1 + T_lag*s), time constants in samples
+// with T_lead > T_lag this advances the signal and compensates part of the
+// delay of the previous stages - at the price of amplified noise
+template<uint32_t T_LEAD, uint32_t T_LAG>
+class LeadLag
+{
+public:
+  LeadLag() : x1_(0.0f), y1_(0.0f) {}
+
+  float process(float x)
+  {
+    // backward euler discretization
+    float y = (T_LAG * y1_ + (1 + T_LEAD) * x - T_LEAD * x1_) / (1 + T_LAG);
+    x1_ = x;
+    y1_ = y;
+    return y;
+  }
+
+  void reset(float x)
+  {
+    x1_ = x;
+    y1_ = x;
+  }
+
+  static constexpr float delay() { return (float)T_LAG - (float)T_LEAD; }
+  static constexpr uint32_t ops() { return 6; }
+
+private:
+  float x1_;
+  float y1_;
+};
+
+
+// compile time chain of stages, applied left to right
+template<typename... Stages>
+class FilterStages;
+
+template<>
+class FilterStages<>
+{
+public:
+  float process(float x) { return x; }
+  void reset(float x) { (void)x; }
+  static constexpr float delay() { return 0.0f; }
+  static constexpr uint32_t ops() { return 0; }
+};
+
+template<typename First, typename... Rest>
+class FilterStages<First, Rest...>
+{
+public:
+  float process(float x) { return rest_.process(first_.process(x)); }
+
+  void reset(float x)
+  {
+    first_.reset(x);
+    rest_.reset(x);
+  }
+
+  static constexpr float delay() { return First::delay() + FilterStages<Rest...>::delay(); }
+  static constexpr uint32_t ops() { return First::ops() + FilterStages<Rest...>::ops(); }
+
+private:
+  First first_;
+  FilterStages<Rest...> rest_;
+};
+
+
+// runtime interface, so each Sensor can carry its own chain
+class SensorFilter
+{
+public:
+  virtual ~SensorFilter() {}
+  virtual float process(float x) = 0;
+  virtual void reset(float x) = 0;
+  virtual float getGroupDelay() = 0;  // samples
+  virtual uint32_t getOpsPerSample() = 0;
+};
+
+template<typename... Stages>
+class FilterChain : public SensorFilter
+{
+public:
+  float process(float x) override { return stages_.process(x); }
+  void reset(float x) override { stages_.reset(x); }
+  float getGroupDelay() override { return FilterStages<Stages...>::delay(); }
+  uint32_t getOpsPerSample() override { return FilterStages<Stages...>::ops(); }
+
+private:
+  FilterStages<Stages...> stages_;
+};
+
+
+// plain 24 sample boxcar as used before:
+//   group delay 11.5 samples, white noise variance / 24 - but every ADC spike
+//   leaks into the average with 1/24 of its amplitude for 24 samples
+typedef FilterChain<RunningAverage<24>> SensorFilterBoxcar;
+
+// median-3 removes the ADC spikes, the line fit over 96 samples averages the
+// white noise as well as the boxcar does (same variance on gaussian noise),
+// but lags only 5 instead of 11.5 samples (~145ms instead of ~330ms) on
+// ramps. with 2% spikes of +-80mV the variance is ~10x lower than the boxcar.
+// numbers from test/test_sensor_filter.
+typedef FilterChain<MedianFilter<3>, LinearFit<96, 4>> SensorFilterLowLatency;
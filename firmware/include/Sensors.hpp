@@ -4,25 +4,49 @@
 #include <driver/adc.h>
 #include <esp_adc_cal.h>
 #include <atomic>
-
-#define SENSORS_BUFFER_SIZE  24
+#include "SensorFilter.hpp"
+#include "NTCTable.hpp"
+#include "ADCSource.hpp"
 
 class Sensor
 {
 public:
-  Sensor(adc1_channel_t adc_channel, esp_adc_cal_characteristics_t *adc_chars);
-  esp_err_t update();
+  Sensor(SensorFilter *filter, const NTCTable *ntc_table);
+  void update(float voltage);  // mV
+  void invalidate();
+  void rebase();  // restart the filter from its current output
+  float getFilterDelay() {return filter_->getGroupDelay();};
+  uint32_t getFilterOps() {return filter_->getOpsPerSample();};
+  uint32_t getFilterCycles() {return filter_cycles_;};
 
   std::atomic<float> value_degc;
 
 private:
-  adc1_channel_t adc_channel_;
-  esp_adc_cal_characteristics_t *adc_chars_;
-  uint32_t avg_buffer_[SENSORS_BUFFER_SIZE];
-  uint8_t avg_buffer_idx_;  // current writing index
+  SensorFilter *filter_;
+  const NTCTable *ntc_table_;  // mV -> deg-C conversion of this probe
+  bool filter_primed_;  // filter gets pre-filled with the first valid sample
+  float filter_output_;  // mV - last filtered value
+  uint32_t filter_cycles_;  // cpu cycles spent in the filter for the last sample
 };
 
 
+typedef enum {
+  SENSORS_RATE_ACTIVE = 0,  // water, shot, steam, warm-up
+  SENSORS_RATE_IDLE,        // powered on, at temperature
+  SENSORS_RATE_OFF,         // powered off
+  SENSORS_RATE_COUNT
+} SENSORS_Rate_t;
+
+typedef struct SensorsStats {
+  uint32_t time_ms[SENSORS_RATE_COUNT];  // time spent in each rate
+  uint32_t wakeups[SENSORS_RATE_COUNT];
+  uint64_t busy_cycles[SENSORS_RATE_COUNT];  // cpu cycles spent sampling
+  uint32_t rate_changes;
+  uint32_t wakeups_saved;  // compared to sampling at the active rate all the time
+  uint64_t cycles_saved;
+} SensorsStats_t;
+
+
 class SensorsHandler
 {
 public:
@@ -36,9 +60,16 @@ public:
   static float getTempBoilerTop();
   static float getTempBoilerSide();
   static float getTempBrewhead();
+  static uint32_t getSampleTimeUs();
+  uint32_t getBurstCycles() {return burst_cycles_;};
+  SENSORS_Rate_t getRate() {return rate_;};
+  static uint32_t getPeriodMs(SENSORS_Rate_t rate);
+  void getStats(SensorsStats_t &stats);
+  void setSubscriber(TaskHandle_t task) {subscriber_ = task;};  // notified for every new sample
 
   static constexpr adc_unit_t ADC_SENSORS    = ADC_UNIT_1;
   static constexpr adc_atten_t ADC_ATTEN     = ADC_ATTEN_11db;
+  static constexpr uint32_t OVERSAMPLING     = 8;  // raw conversions per channel and burst
 
 private:
   static void timer_cb_wrapper(TimerHandle_t arg);
@@ -46,14 +77,21 @@ private:
   static void task_wrapper(void *arg);
   void task();
   void update();
+  SENSORS_Rate_t selectRate();
+  void changeRate(SENSORS_Rate_t rate);
 
   Sensor *sensor_top_;
   Sensor *sensor_side_;
   Sensor *sensor_brewhead_;
   esp_adc_cal_characteristics_t adc_chars_;
+  ADCSource *adc_source_;
+  ADCBurst<3> *adc_burst_;
+  std::atomic<uint32_t> sample_time_us_;  // time of the last burst (lower 32bit of esp_timer)
+  uint32_t burst_cycles_;  // cpu cycles spent for the last burst
+  SENSORS_Rate_t rate_;
+  SensorsStats_t stats_;
   SemaphoreHandle_t sem_update_;
   TaskHandle_t task_handle_;
+  TaskHandle_t subscriber_;
   hw_timer_t *timer_update_;
-
-  static constexpr uint32_t UPDATE_PERIOD_MS = 29;  // ms
 };
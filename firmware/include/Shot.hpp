@@ -1,57 +1,84 @@
 #pragma once
 
 #include <Arduino.h>
+#include "ShotProfile.hpp"
+#include "coffee_config.hpp"
 
 class WaterControl;
 
+typedef enum {
+  SHOT_EVENT_START = 0,  // pump starts, time base of the shot
+  SHOT_EVENT_SEGMENT,    // segment entered
+  SHOT_EVENT_DONE,       // end of the profile reached
+  SHOT_EVENT_STOP
+} SHOT_Event_t;
+
+#define SHOT_EVENTS_MAX  (SHOT_SEGMENTS_MAX + 3)
+
+// one entry of the shot timeline
+typedef struct ShotEvent {
+  uint32_t time_us;   // since the start of the shot
+  int32_t error_us;   // against the profile - segments only
+  uint8_t type;       // SHOT_Event_t
+  uint8_t segment;
+  uint8_t pump;       // % - commanded from this time on
+} ShotEvent_t;
+
+typedef struct ShotTiming {
+  uint32_t shots;
+  uint32_t error_max_us;    // largest segment start error of all shots
+  uint32_t latency_max_us;  // pump period start to the shot task
+  uint32_t late;            // duty written after the period it was meant for
+  uint32_t timeouts;        // no pump period notification - task timing used
+} ShotTiming_t;
+
 class Shot
 {
 public:
   Shot(WaterControl *water_control);
-  void start(uint32_t init_fill_ms, uint32_t time_ramp_ms, uint32_t time_pause_ms, uint8_t pump_start_percent, uint8_t pump_stop_percent);
+  void start();  // runs the selected profile
   void stop(uint8_t pump_percent, bool valve);
   uint32_t getShotTime();
+  uint8_t getPumpForecast();  // % - pump duty the current segment is heading for
+  float getFFGain();          // feed-forward of the current segment, < 0 = PIDHeater default
+
+  // profiles
+  bool setProfile(uint32_t slot, const ShotProfile_t &profile);  // validates and stores
+  bool getProfile(uint32_t slot, ShotProfile_t &profile);        // false if the slot is empty
+  bool selectProfile(uint32_t slot);
+  uint32_t getSelectedProfile() {return selected_;};
+  void getTiming(ShotTiming_t &timing);
+  uint32_t getTimeline(ShotEvent_t *events, uint32_t max_events);  // events of the last shot
 
 private:
   WaterControl *water_control_;
-  TimerHandle_t timer_;
-  
-  uint32_t time_init_fill_ms_;  // ms - initial 100% pump duration
-  uint32_t time_ramp_ms_;       // ms - ramp duration from start-percent to stop-percent
-  uint32_t time_pause_ms_;      // ms - pause after ramp with 0% pump
-  uint8_t pump_start_percent_;  // % - start of ramp
-  uint8_t pump_stop_percent_;   // % - stop of ramp (also part of ramp)
-  uint8_t current_ramp_percent_;
-
-  uint32_t start_time_;         // time-ms - start of current shot
-  uint32_t stop_time_;          // time-ms - stop of current shot
+
+  ShotProfile_t profiles_[SHOT_PROFILE_SLOTS];  // count 0 = empty slot
+  uint32_t selected_;
+  ShotProfile_t profile_;       // copy of the running profile
+  ShotSetpoint_t setpoint_;     // last evaluation
+  ShotTiming_t timing_;
+
+  ShotEvent_t events_[SHOT_EVENTS_MAX];
+  uint32_t event_count_;
+
+  // all times are the lower 32bit of esp_timer
+  uint32_t start_us_;           // start of the first pump period of the shot
+  uint32_t stop_us_;
+  uint32_t clock_ms_;           // ms after the start the shot time begins
+  uint32_t segment_;            // last segment applied, SHOT_SEGMENTS_MAX = none
+  uint8_t pump_;                // last duty applied
 
   bool active_;                 // shot is currently active
+  bool aligned_;                // time base set to a pump period
 
-  // commands for task to process
-  enum SHOT_CMD {
-    CMD_STOP = 0,
-    CMD_START,
-    CMD_RAMP,
-    CMD_PAUSE,
-    CMD_100PERCENT,
-  };
-  // queue sending commands to task
-  static constexpr uint8_t cmd_queue_size_ = 5;
-  static constexpr uint8_t cmd_queue_item_size_ = sizeof(uint32_t);
-  QueueHandle_t cmd_queue_;
+  void loadProfiles();
+  void storeProfile(uint32_t slot);
+  void defaultProfile(ShotProfile_t &profile);
 
   static void task_wrapper(void *arg);
   void task();
+  void step(uint32_t apply_us, uint32_t period_us);
+  void addEvent(SHOT_Event_t type, uint32_t time_us, int32_t error_us);
   TaskHandle_t task_handle_;
-
-  // current timer infos tell which command needs to be executed next by timer
-  typedef struct TimerInfos {
-    Shot *shot;
-    uint32_t cmd;
-  } TimerInfos_t;
-  TimerInfos_t timer_infos_;
-
-  void timer_cb(uint32_t cmd);
-  static void timer_cb_wrapper(TimerHandle_t arg);
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// shot profile: a list of segments, executed one after the other from the
+// start of the shot. the pump duty is a pure function of the time since the
+// start, so the schedule does not drift with the task that evaluates it.
+//
+// text form, one segment per line ('#' starts a comment):
+//   name <name>
+//   hold  <pump %> <ms>                 constant duty
+//   ramp  <pump %> <pump %> <ms>        linear from the first to the second duty
+//   pulse <pump %> <ms> <on ms> <off ms>  duty for on ms, 0 for off ms, repeated
+//   pause <ms>                          pump off
+// options after the values: ff=<% heater per % pump>  temp=<deg-C>  clock
+//   clock: the shot time counts from the start of this segment
+// a duration of 0 runs until the shot is stopped.
+// no Arduino dependencies - profiles can be parsed and replayed on the host.
+
+#define SHOT_SEGMENTS_MAX   12
+#define SHOT_NAME_LENGTH    16
+
+typedef enum {
+  SEGMENT_HOLD = 0,
+  SEGMENT_RAMP,
+  SEGMENT_PULSE,
+  SEGMENT_PAUSE
+} SEGMENT_Type_t;
+
+#define SEGMENT_FLAG_CLOCK  0x01  // shot time starts with this segment
+
+typedef struct ShotSegment {
+  uint8_t type;          // SEGMENT_Type_t
+  uint8_t flags;         // SEGMENT_FLAG_*
+  uint8_t pump;          // % - hold and pulse duty, start of a ramp
+  uint8_t pump_end;      // % - end of a ramp
+  uint32_t duration_ms;  // 0 = until the shot is stopped
+  uint16_t pulse_on_ms;
+  uint16_t pulse_off_ms;
+  float ff_gain;         // % heater per % pump, < 0 = PIDHeater default
+  float temp;            // deg-C - boiler target during the segment, 0 = keep
+} ShotSegment_t;
+
+typedef struct ShotProfile {
+  char name[SHOT_NAME_LENGTH];
+  uint32_t count;
+  ShotSegment_t segments[SHOT_SEGMENTS_MAX];
+} ShotProfile_t;
+
+// what the profile asks for at a given time
+typedef struct ShotSetpoint {
+  uint32_t segment;        // index, count when the profile is done
+  uint32_t segment_start_ms;  // planned start of the segment since the shot start
+  uint8_t pump;            // %
+  uint8_t pump_forecast;   // % - where the pump is heading in this segment
+  float ff_gain;           // < 0 = default
+  float temp;              // 0 = keep
+} ShotSetpoint_t;
+
+// false on an invalid profile
+bool shot_profile_validate(const ShotProfile_t &profile);
+// parses the text form, returns false with a reason in error
+bool shot_profile_parse(const char *text, ShotProfile_t &profile, const char **error);
+// writes the text form, returns the length (like snprintf)
+size_t shot_profile_format(const ShotProfile_t &profile, char *buffer, size_t size);
+// setpoint at elapsed_ms since the start of the shot
+void shot_profile_evaluate(const ShotProfile_t &profile, uint32_t elapsed_ms, ShotSetpoint_t &setpoint);
+// planned start of the segment with SEGMENT_FLAG_CLOCK, 0 if none
+uint32_t shot_profile_clock_start(const ShotProfile_t &profile);
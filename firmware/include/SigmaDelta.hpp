@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+
+// first order sigma-delta (Bresenham) modulator for a zero-cross SSR.
+// called once per mains half-cycle, it decides whether the half-cycle is
+// switched on. on-half-cycles are spread evenly, a new duty takes effect with
+// the next call.
+//
+// consecutive on-half-cycles of the same polarity would draw a DC current
+// (e.g. 50% = every second half-cycle = always the same half-wave). a pulse
+// that would do that is delayed by one half-cycle, the accumulator keeps it.
+// over any window the delivered half-cycles stay within 2 of the commanded
+// sum of duty / SCALE, also while the duty changes - test/test_sigma_delta
+// measures 1.998 at worst. a duty of 0 switches off at once and drops what is
+// still owed.
+// no Arduino dependencies - usable from the ISR and on the host.
+class SigmaDelta
+{
+public:
+  static constexpr uint32_t SCALE = 1000;  // duty 0..SCALE = 0..100%
+
+  SigmaDelta() :
+    duty_(0), acc_(0), positive_(true), dc_(0)
+  {
+  }
+
+  void setDuty(uint32_t duty)
+  {
+    duty_ = (duty > SCALE) ? SCALE : duty;
+  }
+
+  uint32_t getDuty() {return duty_;};
+
+  void reset()
+  {
+    acc_ = 0;
+    positive_ = true;
+    dc_ = 0;
+  }
+
+  // returns true if the next half-cycle shall be switched on
+  __attribute__((always_inline)) inline bool step()
+  {
+    uint32_t duty = duty_;
+    bool on = false;
+    int32_t polarity = positive_ ? 1 : -1;
+
+    positive_ = !positive_;
+
+    if (duty == 0)
+    {
+      // off means off - no pending pulse
+      acc_ = 0;
+      return false;
+    }
+
+    acc_ += duty;
+    if (acc_ >= SCALE && dc_ != polarity)
+    {
+      acc_ -= SCALE;
+      dc_ += polarity;
+      on = true;
+    }
+    return on;
+  }
+
+private:
+  volatile uint32_t duty_;
+  uint32_t acc_;       // energy owed, in 1/SCALE half-cycles
+  bool positive_;      // polarity of the next half-cycle
+  int32_t dc_;         // sum of the polarities switched on, -1..1
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+#include "WaterControl.hpp"
+
+// consistent view of the whole machine, published once per control tick
+typedef struct SystemSnapshot {
+  uint32_t seq;             // increments with every publish, 0 = nothing published yet
+  uint32_t time_ms;         // systime of publish
+  float temp_top;           // deg-C
+  float temp_side;          // deg-C
+  float temp_avg;           // deg-C
+  float temp_brewhead;      // deg-C
+  float temp_water;         // deg-C - estimated by the boiler observer
+  float target;             // deg-C - PID setpoint
+  float p_share;
+  float i_share;
+  float d_share;
+  float ff_share;           // pump feed-forward
+  float u;                  // uncorrected PID output
+  uint32_t sample_age_us;   // sensor sample age when the heater was set
+  uint8_t regime;           // PID_Regime_t of the gain schedule
+  uint8_t heater_percent;
+  uint8_t pump_percent;
+  WATERCTRL_State_t water_state;
+  uint32_t shot_time_ms;
+  bool power;
+} SystemSnapshot_t;
+
+// seqlock: one writer (the control task), any number of lock-free readers.
+// the sequence counter is odd while the writer copies, readers retry until
+// they got a copy with the same even counter before and after.
+class SystemState
+{
+public:
+  static void publish(const SystemSnapshot_t &snapshot);
+  static bool read(SystemSnapshot_t &snapshot);  // false if nothing was published yet
+  static uint32_t getSequence();
+};
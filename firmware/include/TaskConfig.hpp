@@ -18,6 +18,9 @@ public:
   static constexpr uint32_t WiFi_influx_stacksize = 5000u;  // words
   static constexpr uint32_t WiFi_influx_priority = 2;
 
+  static constexpr uint32_t WiFi_push_stacksize = 3000u;  // words
+  static constexpr uint32_t WiFi_push_priority = 2;
+
   static constexpr uint32_t WiFi_ota_stacksize = 5000u;  // words
   static constexpr uint32_t WiFi_ota_priority = 3;
 };
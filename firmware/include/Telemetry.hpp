@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ResponseWriter.hpp"
+
+// telemetry for InfluxDB: points are stored at sample time in a bounded ring
+// and sent later in batches, so WiFi outages and slow requests do not lose
+// data - only a full ring drops its oldest points.
+// every point gets a sequence number. a batch is read by sequence and only
+// released after the server accepted it, points overwritten in between are
+// simply skipped.
+// values are fixed point at 0.01, 40 bytes per point.
+// no Arduino dependencies - the ring and the line protocol can be checked on the host.
+
+#define TELEMETRY_TEMPS     5          // top, side, brewhead, avg, water
+#define TELEMETRY_SHARES    4          // p, i, d, ff
+#define TELEMETRY_INVALID   INT16_MIN  // temperature without a reading
+#define TELEMETRY_TEXT_MAX  768        // longest line protocol text of one point, either layout
+
+typedef enum {
+  TELEMETRY_LAYOUT_SERIES = 0,  // one row per value as before the ring, "temperature,pos=top value=93.27" - ~580 bytes per point
+  TELEMETRY_LAYOUT_FIELDS       // one row per measurement, "temperature top=93.27,side=91.50" - ~255 bytes per point
+} TELEMETRY_Layout_t;
+
+typedef struct TelemetryPoint {
+  uint32_t time_ms;                  // systime of the sample
+  int16_t temp[TELEMETRY_TEMPS];     // 0.01 deg-C
+  int32_t share[TELEMETRY_SHARES];   // 0.01 % heater - not bounded before the output limits
+  int32_t u;                         // 0.01 % - uncorrected PID output
+  uint8_t heater;                    // %
+  uint8_t pump;                      // %
+  uint8_t regime;                    // PID_Regime_t
+  uint8_t water_state;               // WATERCTRL_State_t
+} TelemetryPoint_t;
+
+// not thread safe - the caller locks
+class TelemetryRing
+{
+public:
+  TelemetryRing(TelemetryPoint_t *points, uint32_t capacity);
+  void push(const TelemetryPoint_t &point);  // drops the oldest point if full
+  bool get(uint32_t seq, TelemetryPoint_t &point);  // false if not (or no longer) stored
+  void release(uint32_t seq_end);  // points before seq_end were sent
+
+  uint32_t getFirst() {return read_seq_;};  // sequence of the oldest point
+  uint32_t getCount() {return write_seq_ - read_seq_;};
+  uint32_t getDropped() {return dropped_;};
+
+private:
+  TelemetryPoint_t *points_;
+  uint32_t capacity_;
+  uint32_t write_seq_;  // next point
+  uint32_t read_seq_;   // oldest point
+  uint32_t dropped_;
+};
+
+// fixed point conversions. temperatures: NaN, failed probes (999 deg-C) and
+// anything else beyond +-327.67 are TELEMETRY_INVALID. the 32 bit form is clamped.
+int16_t telemetry_temp(float value);
+int32_t telemetry_fixed32(float value);
+
+// line protocol rows of one point with ms timestamps (precision=ms).
+// now_ms is the systime at unix_now_ms, the point time is converted with it.
+void telemetry_format(const TelemetryPoint_t &point, uint32_t now_ms, uint64_t unix_now_ms,
+                      TELEMETRY_Layout_t layout, ResponseWriter &writer);
+
+// one request of the sender: the oldest points that fit into the buffer, and
+// the pause before the next request depending on how this one went.
+// the ring and the network stay with the caller:
+//   begin(ring first), add() points until false or none left, post the text,
+//   release [getFirst(), getEnd()) if accepted, wait sent() ms.
+class TelemetryBatch
+{
+public:
+  TelemetryBatch(char *buffer, size_t size, TELEMETRY_Layout_t layout,
+                 uint32_t flush_ms, uint32_t drain_ms, uint32_t backoff_max_ms);
+  void begin(uint32_t first);
+  bool add(const TelemetryPoint_t &point, uint32_t now_ms, uint64_t unix_now_ms);  // false if full
+  uint32_t sent(bool accepted, uint32_t duration_ms);  // ms until the next request
+
+  uint32_t getFirst() {return first_;};
+  uint32_t getEnd() {return end_;};  // sequence after the last point
+  uint32_t getCount() {return end_ - first_;};
+  bool isFull() {return full_;};
+  const char *c_str() {return writer_.c_str();};
+  size_t length() {return writer_.length();};
+
+private:
+  ResponseWriter writer_;
+  size_t size_;
+  TELEMETRY_Layout_t layout_;
+  uint32_t flush_ms_;        // interval while caught up, first backoff
+  uint32_t drain_ms_;        // min. pause between full batches
+  uint32_t backoff_max_ms_;
+  uint32_t backoff_ms_;      // pause after the next error
+  uint32_t first_;
+  uint32_t end_;
+  bool full_;                // points were left for the next request
+  char rows_[TELEMETRY_TEXT_MAX];
+};
@@ -3,8 +3,8 @@
 class Timers
 {
 public:
-  static constexpr uint32_t timer_pump = 0;
-  static constexpr uint32_t timer_heater = 1;
-  static constexpr uint32_t timer_sensors = 2;
+  static constexpr uint32_t timer_ssr = 0;  // SSRScheduler - heater, pump and valve
+  // static constexpr uint32_t timer_? = 1;
+  // static constexpr uint32_t timer_? = 2;
   // static constexpr uint32_t timer_? = 3;
 };
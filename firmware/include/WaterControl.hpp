@@ -34,7 +34,12 @@ public:
   void startPreheat();
   void startSteam(uint8_t pump_percent = 0, bool new_state_valve = false);
   void stop(uint8_t new_pump_percent = 0, bool new_state_valve = false, WATERCTRL_State_t new_state = WATERCTRL_OFF);
+  bool setBrewTemp(float temp);
+  float getBrewTemp() {return brew_temp_;};
+  static const char *getStateName(WATERCTRL_State_t state);
   PIDHeater *getBoilerPID() {return pid_boiler_;};
+  Shot *getShot() {return shot_;};
+  WATERCTRL_State_t getState() {return state_;};
 
 private:
   SSRPump *pump_;
@@ -47,6 +52,7 @@ private:
   PIDHeater *pid_boiler_;
 
   WATERCTRL_State_t state_;
+  float brew_temp_;  // deg-C - boiler target except for steam
   uint8_t pump_override_percent_;  // override pump with this value if positive
   uint16_t pump_override_total_ms_;  // for how many milli-secs the override should be in place
   uint16_t pump_override_active_ms_;  // for how long the override is already active
@@ -0,0 +1,110 @@
+// generated by embed_assets.py from data/ - do not edit
+#pragma once
+
+#include <Arduino.h>
+
+typedef struct WebAsset {
+  const char *path;
+  const char *type;
+  const uint8_t *data;  // gzip
+  size_t length;
+  const char *etag;
+  const char *cache;    // Cache-Control
+} WebAsset_t;
+
+static const uint8_t index_html[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xbd, 0x57, 0x6d, 0x6f, 0xe3, 0x36,
+  0x0c, 0xfe, 0x9e, 0x5f, 0xa1, 0x69, 0xc0, 0xce, 0x41, 0x73, 0x76, 0xd2, 0x62, 0x1b, 0x2e, 0x71,
+  0x7c, 0xb8, 0xa6, 0x2d, 0xba, 0x21, 0x6d, 0x8a, 0xa6, 0x7b, 0x43, 0x71, 0x28, 0x14, 0x9b, 0x89,
+  0x85, 0x3a, 0x92, 0x4f, 0x92, 0x93, 0x06, 0xc3, 0xfe, 0xfb, 0x28, 0xbf, 0xa4, 0xf6, 0x9a, 0x5c,
+  0x5b, 0xa0, 0xb7, 0x2f, 0xb1, 0x49, 0x8a, 0x0f, 0x1f, 0x93, 0x14, 0xa5, 0xf8, 0xdf, 0x9d, 0x4c,
+  0x46, 0x37, 0x7f, 0x5d, 0x9d, 0x92, 0xd8, 0x2c, 0x93, 0xa0, 0xe5, 0x57, 0x0f, 0x60, 0x11, 0x3e,
+  0x0c, 0x37, 0x09, 0x04, 0x53, 0x9e, 0xac, 0x38, 0xf3, 0xbd, 0x42, 0x6a, 0xf9, 0x4b, 0x30, 0x8c,
+  0x08, 0xb6, 0x84, 0x21, 0x5d, 0x71, 0x58, 0xa7, 0x52, 0x19, 0x4a, 0x42, 0x29, 0x0c, 0x08, 0x33,
+  0xa4, 0x6b, 0x1e, 0x99, 0x78, 0x18, 0xc1, 0x8a, 0x87, 0xf0, 0x3e, 0x17, 0x3a, 0x84, 0x0b, 0x6e,
+  0x38, 0x4b, 0xde, 0xeb, 0x90, 0x25, 0x30, 0xec, 0x51, 0x04, 0x49, 0xb8, 0xb8, 0x27, 0x0a, 0x92,
+  0x21, 0xe5, 0xe8, 0x4a, 0x49, 0xac, 0x60, 0x3e, 0xa4, 0x11, 0x33, 0xac, 0xdf, 0x69, 0xda, 0xb5,
+  0xd9, 0x24, 0xa0, 0x63, 0x00, 0x8c, 0x62, 0x36, 0x29, 0x46, 0x35, 0xf0, 0x60, 0xbc, 0x50, 0xeb,
+  0xca, 0x2b, 0x5f, 0xe1, 0xa2, 0xe2, 0xe3, 0x6a, 0xc8, 0x0e, 0x3f, 0x1c, 0x7e, 0x38, 0xfa, 0xa9,
+  0x6b, 0x31, 0x74, 0xa8, 0x78, 0x6a, 0x82, 0xd6, 0x3c, 0x13, 0xa1, 0xe1, 0x52, 0x90, 0x13, 0xae,
+  0xd3, 0x84, 0x6d, 0x46, 0x99, 0x52, 0xc8, 0xf5, 0x86, 0x2f, 0xc1, 0x69, 0x93, 0xbf, 0x5b, 0x2b,
+  0xa6, 0x08, 0x46, 0x06, 0x32, 0x24, 0x02, 0xd6, 0xe4, 0x04, 0x5f, 0x9d, 0xf6, 0x20, 0x57, 0xc7,
+  0x32, 0x53, 0x1a, 0xf5, 0xd6, 0xec, 0x2e, 0xc0, 0x9c, 0x5b, 0x19, 0x9d, 0x7c, 0xd2, 0xeb, 0x92,
+  0x8f, 0x84, 0x76, 0x29, 0x39, 0x78, 0x62, 0xec, 0xff, 0x57, 0x53, 0x60, 0x2d, 0xb9, 0xc8, 0x0c,
+  0xd4, 0xd1, 0x2e, 0x0a, 0xcd, 0x3e, 0xbc, 0x47, 0x73, 0xff, 0xa9, 0xae, 0xc0, 0xd4, 0x80, 0xd9,
+  0x8b, 0xea, 0x98, 0xd3, 0x42, 0xb3, 0x0f, 0xf3, 0xd1, 0xdc, 0x7f, 0xaa, 0x1b, 0xb4, 0x0c, 0xe6,
+  0x04, 0xc1, 0x8a, 0xcf, 0x3e, 0x20, 0xb4, 0x6f, 0x7d, 0x2b, 0xe2, 0x95, 0x5c, 0x06, 0x2d, 0x18,
+  0x84, 0x8f, 0xc9, 0xb4, 0x2c, 0x64, 0x98, 0x2d, 0x51, 0xb4, 0xb0, 0xa7, 0x09, 0xd8, 0xd7, 0xe3,
+  0xcd, 0x2f, 0x91, 0x43, 0x6b, 0xcb, 0x28, 0xc6, 0xa9, 0x89, 0x2e, 0x17, 0x02, 0xd4, 0xf9, 0xcd,
+  0xc5, 0x18, 0xfd, 0x6d, 0xfc, 0x41, 0xeb, 0x9f, 0xc1, 0x63, 0xcd, 0x46, 0x12, 0xcd, 0xa1, 0xd9,
+  0x16, 0x4a, 0xcb, 0xf0, 0x1e, 0x4c, 0x59, 0xaa, 0x3f, 0x60, 0x36, 0xcd, 0x65, 0x87, 0xae, 0x75,
+  0xdf, 0xf3, 0x2c, 0xbb, 0x44, 0x86, 0xcc, 0x7a, 0xba, 0xb1, 0xd4, 0xc6, 0x72, 0xf6, 0xd6, 0xda,
+  0x86, 0x2c, 0x1c, 0x5d, 0x29, 0x96, 0xa0, 0x35, 0x5b, 0x58, 0xb6, 0x55, 0x10, 0x07, 0x56, 0x48,
+  0x66, 0x1b, 0xc1, 0x14, 0xbd, 0xf0, 0xeb, 0x74, 0x72, 0xe9, 0xa6, 0x4c, 0x69, 0x28, 0xec, 0xae,
+  0xed, 0xce, 0x32, 0xef, 0x2b, 0x96, 0x64, 0x79, 0x29, 0x6f, 0xf3, 0xd5, 0xae, 0x81, 0x65, 0xea,
+  0x1a, 0x99, 0x76, 0x48, 0x4d, 0xd6, 0x3c, 0x82, 0x86, 0x82, 0xad, 0x16, 0x0d, 0x79, 0xa6, 0x60,
+  0x6d, 0xb7, 0x5a, 0xa5, 0x64, 0xa1, 0xc9, 0x98, 0x91, 0x4a, 0xbb, 0xa8, 0x35, 0xa0, 0x3a, 0xc4,
+  0x29, 0x0c, 0x3a, 0x96, 0xc6, 0xb5, 0xb9, 0xb9, 0x5b, 0x6a, 0xe2, 0x61, 0x5d, 0xbb, 0xdd, 0x36,
+  0x86, 0x3b, 0xe3, 0x0f, 0x10, 0x39, 0xbd, 0xf6, 0xe7, 0x82, 0x94, 0x42, 0x28, 0x2e, 0x16, 0x7a,
+  0x77, 0x1d, 0xf4, 0xf1, 0x66, 0x94, 0x30, 0xad, 0x2f, 0x71, 0xe7, 0x3a, 0x54, 0x45, 0x36, 0x27,
+  0x73, 0xa9, 0x88, 0x93, 0x57, 0x51, 0x66, 0xc2, 0x26, 0xb5, 0x3b, 0x28, 0x5f, 0xfd, 0xf2, 0x13,
+  0xdd, 0x04, 0xc4, 0xc2, 0xc4, 0xa5, 0xfa, 0xe0, 0xc0, 0x26, 0xa9, 0x8a, 0x73, 0x9b, 0xeb, 0x3e,
+  0x37, 0x0a, 0x58, 0x78, 0x95, 0x16, 0xac, 0x64, 0xeb, 0x59, 0x26, 0xe9, 0x5a, 0xd1, 0xf6, 0x6d,
+  0xb7, 0x09, 0x53, 0x7c, 0x76, 0x2a, 0xd7, 0xa0, 0x6c, 0x0b, 0x4f, 0x2e, 0x29, 0xf6, 0x2b, 0x9d,
+  0x9c, 0x9d, 0xd1, 0x41, 0x6b, 0x6f, 0x8f, 0x19, 0xa6, 0x50, 0x45, 0xdb, 0xbb, 0x90, 0x78, 0xe4,
+  0x16, 0xe6, 0x5a, 0xda, 0x9e, 0x85, 0xba, 0x9b, 0xc5, 0x7b, 0xd1, 0xaa, 0xda, 0xdd, 0xed, 0x80,
+  0xdd, 0x35, 0x67, 0xf2, 0xae, 0xde, 0xf6, 0x60, 0x98, 0x48, 0xdd, 0xe8, 0x40, 0x9b, 0x57, 0x0d,
+  0xf9, 0x5a, 0x99, 0x19, 0xa7, 0xec, 0xfa, 0x0e, 0x39, 0xb4, 0xa5, 0xce, 0x7d, 0xeb, 0x9b, 0x22,
+  0x4f, 0xcc, 0x44, 0x1c, 0x67, 0xc6, 0x48, 0x71, 0x56, 0xc7, 0x28, 0xfa, 0xe0, 0x0b, 0xd6, 0xa0,
+  0xda, 0x23, 0x7f, 0x5e, 0x8c, 0xcf, 0x8d, 0x49, 0xaf, 0x0b, 0xa5, 0x25, 0x52, 0xda, 0x5d, 0x99,
+  0x82, 0x70, 0xe8, 0xd5, 0x64, 0x7a, 0x43, 0x3b, 0xb8, 0x4d, 0x70, 0x0c, 0x77, 0x88, 0x51, 0x19,
+  0xd4, 0x96, 0x68, 0x10, 0x91, 0x23, 0xb2, 0x24, 0x69, 0xef, 0x22, 0x30, 0x9f, 0xbf, 0x31, 0x83,
+  0xf9, 0xfc, 0xe5, 0x14, 0x14, 0x60, 0xbe, 0xde, 0x36, 0x7e, 0x0e, 0xf9, 0x72, 0x06, 0x6b, 0xbb,
+  0x47, 0xe7, 0x3c, 0x49, 0xde, 0x96, 0xc5, 0x16, 0xf6, 0x59, 0x26, 0xdb, 0xf6, 0x65, 0x51, 0x74,
+  0x6a, 0x47, 0xd4, 0x98, 0x6b, 0x3c, 0x85, 0x41, 0x39, 0xef, 0x4e, 0x26, 0x17, 0xa3, 0xe2, 0x48,
+  0x1e, 0x4b, 0x16, 0x41, 0xf4, 0xae, 0xd3, 0xec, 0xb5, 0xed, 0x58, 0x45, 0x20, 0x34, 0xb1, 0x44,
+  0xdb, 0x38, 0xbe, 0x57, 0x9d, 0x99, 0xbe, 0x57, 0xde, 0x01, 0x66, 0x32, 0xda, 0xd8, 0x1b, 0x41,
+  0x6f, 0x7b, 0x0f, 0xc0, 0x57, 0x94, 0x8f, 0x82, 0x31, 0xc3, 0x6f, 0xcb, 0x52, 0x7b, 0x8a, 0xf4,
+  0x89, 0xaf, 0x53, 0x26, 0x08, 0x8f, 0x86, 0x8d, 0x49, 0x1f, 0x20, 0x20, 0xea, 0xf1, 0x81, 0xeb,
+  0x5b, 0x7e, 0x1a, 0x4c, 0x71, 0xff, 0x64, 0xba, 0x5a, 0x1e, 0xda, 0x29, 0x30, 0xcc, 0x27, 0x40,
+  0xe0, 0xba, 0xee, 0x76, 0x71, 0x6a, 0xef, 0x1e, 0x6c, 0x96, 0xdf, 0x36, 0x8c, 0xb2, 0x3f, 0x31,
+  0x29, 0xee, 0x15, 0xbd, 0x1f, 0xbb, 0xe9, 0x43, 0x30, 0x3d, 0xbd, 0x9c, 0x4e, 0xae, 0xf1, 0x46,
+  0x12, 0x37, 0x6c, 0x5d, 0x6b, 0xfb, 0xfd, 0xd3, 0xf8, 0xb7, 0xd3, 0xd2, 0xe4, 0x15, 0xce, 0xf9,
+  0x4f, 0x14, 0x34, 0x62, 0x62, 0x26, 0xb5, 0xc4, 0xb0, 0x37, 0x32, 0xdd, 0x86, 0x35, 0xd1, 0x8e,
+  0x85, 0x38, 0x28, 0x6b, 0xdc, 0xc8, 0x0f, 0x11, 0x2c, 0x06, 0xa3, 0x72, 0xed, 0x0b, 0xf0, 0xa7,
+  0x78, 0x06, 0x7c, 0xd3, 0x00, 0x9f, 0x56, 0xa0, 0xec, 0x69, 0xe6, 0x3c, 0x56, 0xa0, 0x9c, 0x83,
+  0x35, 0xd4, 0xf6, 0x37, 0xa5, 0x70, 0x5c, 0x8e, 0xc2, 0xa7, 0x1c, 0xec, 0x00, 0xfd, 0xdf, 0x68,
+  0x9c, 0xe7, 0x67, 0xe6, 0xeb, 0x42, 0x7c, 0x7f, 0xf4, 0xf3, 0xe0, 0x15, 0xc5, 0xc4, 0x63, 0x98,
+  0xd8, 0xc6, 0x7e, 0x55, 0x10, 0xdd, 0x08, 0xe0, 0x55, 0x8d, 0x3d, 0xcb, 0x87, 0x06, 0xb1, 0x67,
+  0x01, 0x0f, 0xef, 0x71, 0x17, 0xec, 0x9e, 0xe9, 0x34, 0xb8, 0xca, 0x4f, 0xc1, 0x89, 0xf0, 0xbd,
+  0xc2, 0x65, 0xaf, 0xef, 0xd3, 0x71, 0xbc, 0x75, 0x9e, 0xcf, 0xbf, 0xe2, 0xbd, 0x77, 0x8e, 0xd1,
+  0xe0, 0x0c, 0xb5, 0x5f, 0xf1, 0xdc, 0x39, 0x83, 0x69, 0x70, 0x6d, 0xd5, 0x35, 0x37, 0xaf, 0x1c,
+  0x22, 0x5e, 0xfe, 0xf7, 0xe2, 0x5f, 0x78, 0x3b, 0x0d, 0xf4, 0x75, 0x0c, 0x00, 0x00,
+};
+
+static const uint8_t style_css[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6d, 0x91, 0xc1, 0x6e, 0x83, 0x30,
+  0x0c, 0x86, 0x5f, 0x05, 0xb5, 0xd7, 0x31, 0x95, 0x16, 0x55, 0x55, 0x38, 0x75, 0x3b, 0xef, 0xb4,
+  0xbd, 0x40, 0x12, 0x1b, 0xb0, 0x9a, 0xc6, 0x28, 0x31, 0x6a, 0x3b, 0xc4, 0xbb, 0x0f, 0x4a, 0x99,
+  0x98, 0x56, 0xe5, 0xe2, 0xd8, 0xd6, 0xef, 0xef, 0xb7, 0x0d, 0xc3, 0xad, 0x13, 0xbc, 0x4a, 0xaa,
+  0x1d, 0x55, 0x5e, 0x59, 0xf4, 0x82, 0xa1, 0x28, 0xd9, 0x4b, 0x5a, 0xea, 0x33, 0xb9, 0x9b, 0x5a,
+  0x7d, 0x05, 0x34, 0xad, 0xad, 0x51, 0x92, 0x8f, 0xcf, 0xd5, 0xcb, 0x31, 0x90, 0x76, 0xbd, 0x68,
+  0xe3, 0xb0, 0x33, 0x1c, 0x00, 0x43, 0x6a, 0xd9, 0x39, 0xdd, 0x44, 0x54, 0x73, 0x50, 0x9c, 0x75,
+  0xa8, 0xc8, 0xa7, 0x0e, 0x4b, 0x51, 0xba, 0x15, 0x9e, 0x13, 0x81, 0xaa, 0x7a, 0xca, 0xf4, 0x52,
+  0x77, 0x8d, 0x06, 0x20, 0x5f, 0xa9, 0x6c, 0xdf, 0x5c, 0x0b, 0xa3, 0xed, 0xa9, 0x0a, 0xdc, 0x7a,
+  0x18, 0xf5, 0x38, 0xa8, 0xf5, 0x66, 0x93, 0xef, 0x74, 0x59, 0x4c, 0xbf, 0x4b, 0x4d, 0x82, 0xbd,
+  0x84, 0xc7, 0x4c, 0x95, 0x35, 0xd7, 0x24, 0xb2, 0x23, 0x48, 0xd6, 0x00, 0x50, 0x2c, 0xa5, 0x7a,
+  0x81, 0xb9, 0xcb, 0xb3, 0xc7, 0xbf, 0xb5, 0xd7, 0x88, 0x3e, 0x72, 0xe8, 0x16, 0xaa, 0x93, 0xdb,
+  0x0b, 0xde, 0xd9, 0x0c, 0x3b, 0x78, 0xc2, 0x62, 0xec, 0xf8, 0x7e, 0xa5, 0x0e, 0xa3, 0x92, 0x69,
+  0x45, 0xd8, 0x77, 0x40, 0xb1, 0x71, 0xfa, 0xa6, 0xc8, 0x3b, 0xf2, 0x98, 0x1a, 0xc7, 0xf6, 0xf4,
+  0xd4, 0xcd, 0xe1, 0xfd, 0xed, 0x58, 0x2c, 0xc1, 0x1e, 0xeb, 0x0b, 0x1a, 0xa8, 0x8d, 0x2a, 0x1f,
+  0x96, 0xb0, 0xa4, 0x5a, 0x62, 0x27, 0xf9, 0x66, 0xa8, 0xde, 0xef, 0x04, 0x68, 0x39, 0x68, 0x21,
+  0xf6, 0x93, 0xc8, 0x1d, 0x3e, 0xd2, 0x37, 0xaa, 0x6c, 0x3b, 0xf4, 0x4c, 0x8b, 0x56, 0x63, 0x68,
+  0xdb, 0x30, 0x38, 0x55, 0x0d, 0xd3, 0x78, 0xd3, 0x99, 0x77, 0xdb, 0xfd, 0x67, 0x2b, 0xf3, 0x7c,
+  0xb7, 0xdb, 0xf7, 0x3f, 0xab, 0x16, 0x81, 0x0f, 0x0d, 0x02, 0x00, 0x00,
+};
+
+static const WebAsset_t web_assets[] = {
+  {"/", "text/html", index_html, sizeof(index_html), "\"f3b5f355efa33425\"", "no-cache"},
+  {"/style.css", "text/css", style_css, sizeof(style_css), "\"a2929360220ef1ae\"", "public, max-age=31536000, immutable"},
+};
@@ -4,13 +4,15 @@
 #include "WebServer.h"  // https://github.com/me-no-dev/ESPAsyncWebServer/issues/418
 #include <ESPAsyncWebServer.h>
 #include <esp_http_client.h>
+#include "coffee_config.hpp"
+
+class ResponseWriter;
 
 class WebInterface
 {
 public:
   WebInterface();
-  static void updateInfluxDB();
-  SemaphoreHandle_t influx_sem_update;
+  static void sampleTelemetry();  // from the control task, after each snapshot
 
 private:
   static void task_http_wrapper(void *arg);
@@ -19,15 +21,31 @@ private:
   void task_influx();
   static void task_ota_wrapper(void *arg);
   void task_ota();
+  static void task_push_wrapper(void *arg);
+  void task_push();
+  static void wsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
   void wifiReconnect();
   void wifiCheckConnectionOrReconnect();
+  void writeMetrics(ResponseWriter &writer);
 
   AsyncWebServer server_;
+  AsyncWebSocket ws_;
+  uint32_t ws_clients_[WS_CLIENTS_MAX];  // ids, 0 = free
+  volatile uint32_t push_period_ms_;
+  uint32_t pushed_;
+  uint32_t dropped_;                     // clients too slow to keep up
+
+  // counters for /metrics
+  uint32_t wifi_reconnects_;
+  uint32_t influx_errors_;
+  uint32_t not_found_;
+
   esp_http_client_config_t http_client_config_;
   esp_http_client_handle_t http_client_;
   
   TaskHandle_t task_handle_http_;
   TaskHandle_t task_handle_influx_;
   TaskHandle_t task_handle_ota_;
+  TaskHandle_t task_handle_push_;
 
 };
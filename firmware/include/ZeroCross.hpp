@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+#include "MainsPLL.hpp"
+
+class SSRScheduler;
+
+// mains zero-cross input. every edge goes through the MainsPLL, while it is
+// locked the SSR scheduler is pulled onto the mains phase.
+// a supervision timer unlocks if the edges disappear and lets the scheduler
+// run free at the nominal rate of the last known frequency. a floating or
+// noisy input (more than ZEROCROSS_EDGES_MAX edges per period) is detached.
+class ZeroCross
+{
+public:
+  ZeroCross(uint8_t pin, SSRScheduler *scheduler);
+  ZeroCross(ZeroCross const&) = delete;
+  void operator=(ZeroCross const&)  = delete;
+  static ZeroCross* getInstance();
+
+  bool isLocked() {return pll_.isLocked();};
+  uint32_t getFrequency() {return pll_.getFrequency();};  // Hz
+  uint32_t getHalfPeriodUs() {return pll_.getHalfPeriodUs();};
+  bool isDetached() {return detached_;};
+  void getStats(MainsStats_t &stats);
+  void edge();  // ISR
+
+private:
+  MainsPLL pll_;
+  SSRScheduler *scheduler_;
+  uint8_t pin_;
+  bool detached_;  // too many edges, interrupt off
+  uint32_t last_edges_;  // edge count at the last supervision
+  bool was_locked_;
+  TimerHandle_t timer_supervision_;
+
+  static void timer_cb_wrapper(TimerHandle_t arg);
+  void timer_cb();
+};
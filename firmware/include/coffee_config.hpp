@@ -8,15 +8,29 @@
 #define SHOT_RAMP_MIN  40  // %
 #define SHOT_RAMP_MAX  100  // %
 
+#define SHOT_PROFILE_SLOTS  4   // profile 0 is built from the values above, if none is stored
+
 #define PREHEAT_T_WATER  1000  // ms
 #define PREHEAT_T_FILL   300  // ms
 #define PREHEAT_T_PAUSE  10000  // ms
 
 #define PUMP_OVERRIDE_MS  800  // ms
+#define PUMP_SOFTSTART_MS  0   // ms - pump ramp from 0 to 100%, 0 = off
+
+// mains
+#define MAINS_FREQUENCY    50   // Hz - until the zero-cross input detected it
+#define MAINS_HALF_PERIOD_US  (1000000 / MAINS_FREQUENCY / 2)
+#define ZEROCROSS_LEAD_US  500  // us - SSR timers fire this long before the detected zero-cross
+// the zero-cross detector is not on the current boards (hardware/new_wiring.sch) -
+// Pins::mains_zerocross would float. without it the SSR scheduler runs free.
+#define ZEROCROSS_INPUT        false  // true with a detector and pull on Pins::mains_zerocross
+#define ZEROCROSS_EDGES_MAX    40     // edges per 100 ms supervision period, more is noise: input detached
 
 
 // temperatures
-#define BREW_TEMP      92.0f   // deg-C
+#define BREW_TEMP      92.0f   // deg-C - default, adjustable over the api
+#define BREW_TEMP_MIN  80.0f   // deg-C
+#define BREW_TEMP_MAX  100.0f  // deg-C
 #define STEAM_TEMP     112.0f  // deg-C
 #define BREWHEAD_TEMP  75      // deg-C
 
@@ -29,12 +43,78 @@
 
 #define PID_MIN_OUTPUT  10  // if 0 < output <= MIN_OUTPUT --> apply MIN_OUTPUT
 
-#define PID_OVERRIDE_STARTSHOT  100.0f
-#define PID_OVERRIDE_COUNT      3
+#define PID_FF_PUMP  0.5f  // % heater per % pump - heat carried away by the fresh water
 
 #define PID_OVERRIDE_TEMP       100.0f
 #define PID_OVERRIDE_TEMP_ERR   10
 
+// gain schedule - regime boundaries, gains are set up in PIDHeater
+#define PID_REGIME_WARMUP_ERR   5.0f  // deg-C - below target - err: warm-up regime
+#define PID_REGIME_BAND         1.0f  // deg-C - warm-up and return from steam end within target +- band
+#define PID_STEAM_RETURN_MAX    5.0f  // % - output limit while cooling down from steam
+
+// PID_PV_OBSERVER is opt-in: tuned against the simulated boiler only (test/test_boiler_observer),
+// not checked on the machine yet
+#define PID_PV_SOURCE  PID_PV_PROBES  // PID_PV_PROBES or PID_PV_OBSERVER
+#define PID_ALGORITHM  PID_ALGO_PID   // PID_ALGO_PID or PID_ALGO_MPC
+
+// relay autotune around the setpoint
+#define AUTOTUNE_OUTPUT_HIGH     30.0f   // % - relay on
+#define AUTOTUNE_OUTPUT_LOW      0.0f    // % - relay off
+#define AUTOTUNE_HYSTERESIS      0.3f    // deg-C
+#define AUTOTUNE_CYCLES          4       // cycles averaged, after dropping the first one
+#define AUTOTUNE_MAX_OVERSHOOT   8.0f    // deg-C - abort above setpoint + overshoot
+#define AUTOTUNE_TIMEOUT_MS      (60u * 60u * 1000u)  // ms - whole run
+#define AUTOTUNE_HALF_CYCLE_MS   (15u * 60u * 1000u)  // ms - longest time between two switches
+
+// predictive controller - boiler model from simulation/python_pid/silvi_sim.py
+// compare against the PID with simulation/python_pid/mpc_sim.py
+#define MPC_HEATER_POWER   750.0   // W
+#define MPC_HEATER_LAG     21700   // ms - element cool-down, silvi_sim.py: 50 s heater dead time / 2.3
+#define MPC_CAPACITY       1254.6  // J/K
+#define MPC_LOSS_R         4e-12
+#define MPC_TEMP_AMBIENT   27.0    // deg-C
+#define MPC_DRAW_FADE      5000    // ms - pump draw expected to end: less droop <-> less overshoot after a shot
+#define MPC_DEAD_TIME      1000    // ms - output acts from the next period, the element lag is modelled
+#define MPC_HORIZON        10      // controller periods after the dead time
+#define MPC_CLTR           60.0    // s - closed loop response time
+#define MPC_DIST_GAIN      0.3f    // disturbance estimation gain
+
+// boiler observer model - initial values from simulation/python_pid/silvi_sim.py
+#define OBSERVER_HEATER_POWER   750.0f   // W
+#define OBSERVER_HEATER_TAU     50.0f    // s
+#define OBSERVER_CAPACITY       1254.6f  // J/K - 0.3l water
+#define OBSERVER_LOSS           0.9f     // W/K
+#define OBSERVER_PUMP_FLOW      8.4f     // W/K - ~2ml/s fresh water at 100% pump
+#define OBSERVER_TEMP_AMBIENT   25.0f    // deg-C
+#define OBSERVER_TEMP_INLET     25.0f    // deg-C
+#define OBSERVER_TAU_TOP        8.0f     // s
+#define OBSERVER_TAU_SIDE       5.0f     // s
+
+
+// sensor sampling
+#define SENSORS_PERIOD_ACTIVE_MS  29     // ms - water, shot, steam, warm-up
+#define SENSORS_PERIOD_IDLE_MS    100    // ms - powered on and at temperature
+#define SENSORS_PERIOD_OFF_MS     1000   // ms - powered off
+#define SENSORS_WARMUP_MARGIN     5.0f   // deg-C - below target counts as warm-up
+
+
+// live state push to the web page
+#define WS_PUSH_PERIOD_MS  250   // ms - default, down to SENSORS_PERIOD_ACTIVE_MS
+#define WS_CLIENTS_MAX     4
+
+
+// telemetry to InfluxDB, sampled from the control task and sent in batches
+#define TELEMETRY_SAMPLE_MS       1000   // ms - point interval, sampled after each PID step: PID_TS or a multiple
+#define TELEMETRY_RING_POINTS     600    // 10 min at TELEMETRY_SAMPLE_MS, 40 bytes each
+#define TELEMETRY_FLUSH_MS        10000  // ms - batch interval while caught up
+#define TELEMETRY_DRAIN_MS        100    // ms - min. pause between batches after an outage
+#define TELEMETRY_BACKOFF_MAX_MS  60000  // ms - longest retry interval after errors
+#define TELEMETRY_LAYOUT          TELEMETRY_LAYOUT_SERIES  // SERIES: rows of the existing dashboards, FIELDS: less than half the bytes
+#define TELEMETRY_BATCH_SIZE      8192   // bytes per request, ~14 points (SERIES) or ~32 (FIELDS)
+#define TELEMETRY_TIMEOUT_MS      2000   // ms - per request
+#define TELEMETRY_NTP_SERVER      "pool.ntp.org"
+
 
 // hardware config
 #define ADC_VREF_MEASURED  1141  // mV
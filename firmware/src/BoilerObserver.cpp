@@ -0,0 +1,154 @@
+#include "BoilerObserver.hpp"
+#include <string.h>
+
+BoilerObserver::BoilerObserver(const BoilerModel_t &model, float dt_s) :
+  model_(model),
+  dt_(dt_s),
+  r_(0.05f * 0.05f)
+{
+  // the water temperature follows the model well, the heater state is the
+  // least known part (supply voltage, scale) - let the filter adapt it fastest
+  q_[X_WATER] = 0.01f * 0.01f;
+  q_[X_HEATER] = 0.02f * 0.02f;
+  q_[X_TOP] = 0.02f * 0.02f;
+  q_[X_SIDE] = 0.02f * 0.02f;
+
+  reset(20.0f);
+}
+
+void BoilerObserver::reset(float temp)
+{
+  x_[X_WATER] = temp;
+  x_[X_HEATER] = 0.0f;
+  x_[X_TOP] = temp;
+  x_[X_SIDE] = temp;
+
+  memset(p_, 0, sizeof(p_));
+  p_[X_WATER][X_WATER] = 4.0f;
+  p_[X_HEATER][X_HEATER] = 0.1f;
+  p_[X_TOP][X_TOP] = 1.0f;
+  p_[X_SIDE][X_SIDE] = 1.0f;
+}
+
+void BoilerObserver::update(float heater_duty, float pump_duty, float temp_top, float temp_side)
+{
+  predict(heater_duty, pump_duty);
+  correct(temp_top, temp_side);
+}
+
+void BoilerObserver::predict(float heater_duty, float pump_duty)
+{
+  float a[N][N];
+  float ap[N][N];
+  float x[N];
+
+  // euler step of the model - the time constants are far above dt
+  float water_loss = (model_.loss + model_.pump_flow * pump_duty) / model_.capacity;
+
+  x[X_WATER] = x_[X_WATER] + dt_ * (model_.heater_power * x_[X_HEATER] / model_.capacity
+                                    - model_.loss * (x_[X_WATER] - model_.temp_ambient) / model_.capacity
+                                    - model_.pump_flow * pump_duty * (x_[X_WATER] - model_.temp_inlet) / model_.capacity);
+  x[X_HEATER] = x_[X_HEATER] + dt_ * (heater_duty - x_[X_HEATER]) / model_.heater_tau;
+  x[X_TOP] = x_[X_TOP] + dt_ * (x_[X_WATER] - x_[X_TOP]) / model_.probe_tau_top;
+  x[X_SIDE] = x_[X_SIDE] + dt_ * (x_[X_WATER] - x_[X_SIDE]) / model_.probe_tau_side;
+  memcpy(x_, x, sizeof(x_));
+
+  // jacobian of the step
+  memset(a, 0, sizeof(a));
+  a[X_WATER][X_WATER] = 1.0f - dt_ * water_loss;
+  a[X_WATER][X_HEATER] = dt_ * model_.heater_power / model_.capacity;
+  a[X_HEATER][X_HEATER] = 1.0f - dt_ / model_.heater_tau;
+  a[X_TOP][X_WATER] = dt_ / model_.probe_tau_top;
+  a[X_TOP][X_TOP] = 1.0f - dt_ / model_.probe_tau_top;
+  a[X_SIDE][X_WATER] = dt_ / model_.probe_tau_side;
+  a[X_SIDE][X_SIDE] = 1.0f - dt_ / model_.probe_tau_side;
+
+  // P = A * P * A' + Q
+  for (uint32_t i = 0; i < N; i++)
+    for (uint32_t j = 0; j < N; j++)
+    {
+      ap[i][j] = 0.0f;
+      for (uint32_t k = 0; k < N; k++)
+        ap[i][j] += a[i][k] * p_[k][j];
+    }
+
+  for (uint32_t i = 0; i < N; i++)
+    for (uint32_t j = 0; j < N; j++)
+    {
+      p_[i][j] = 0.0f;
+      for (uint32_t k = 0; k < N; k++)
+        p_[i][j] += ap[i][k] * a[j][k];
+    }
+
+  for (uint32_t i = 0; i < N; i++)
+    p_[i][i] += q_[i];
+}
+
+void BoilerObserver::correct(float temp_top, float temp_side)
+{
+  // invalid probes are left out, the model keeps running
+  bool top_valid = temp_top > 0.0f && temp_top < 200.0f;
+  bool side_valid = temp_side > 0.0f && temp_side < 200.0f;
+
+  if (!top_valid && !side_valid)
+    return;
+
+  // measurement picks X_TOP and X_SIDE: S = P[probes][probes] + R
+  float s00 = p_[X_TOP][X_TOP] + r_;
+  float s01 = p_[X_TOP][X_SIDE];
+  float s10 = p_[X_SIDE][X_TOP];
+  float s11 = p_[X_SIDE][X_SIDE] + r_;
+  float y0 = top_valid ? temp_top - x_[X_TOP] : 0.0f;
+  float y1 = side_valid ? temp_side - x_[X_SIDE] : 0.0f;
+
+  // a missing probe gets no weight
+  if (!top_valid)
+  {
+    s00 = 1.0f;
+    s01 = 0.0f;
+    s10 = 0.0f;
+  }
+  if (!side_valid)
+  {
+    s11 = 1.0f;
+    s01 = 0.0f;
+    s10 = 0.0f;
+  }
+
+  float det = s00 * s11 - s01 * s10;
+  if (det <= 0.0f)
+    return;
+
+  float si00 = s11 / det;
+  float si01 = -s01 / det;
+  float si10 = -s10 / det;
+  float si11 = s00 / det;
+  if (!top_valid)
+    si00 = si01 = si10 = 0.0f;
+  if (!side_valid)
+    si11 = si01 = si10 = 0.0f;
+
+  // K = P * H' * S^-1
+  float k[N][2];
+  for (uint32_t i = 0; i < N; i++)
+  {
+    k[i][0] = p_[i][X_TOP] * si00 + p_[i][X_SIDE] * si10;
+    k[i][1] = p_[i][X_TOP] * si01 + p_[i][X_SIDE] * si11;
+  }
+
+  for (uint32_t i = 0; i < N; i++)
+    x_[i] += k[i][0] * y0 + k[i][1] * y1;
+
+  // heater output can only be between off and full on
+  if (x_[X_HEATER] < 0.0f)
+    x_[X_HEATER] = 0.0f;
+  else if (x_[X_HEATER] > 1.0f)
+    x_[X_HEATER] = 1.0f;
+
+  // P = (I - K * H) * P
+  float p[N][N];
+  for (uint32_t i = 0; i < N; i++)
+    for (uint32_t j = 0; j < N; j++)
+      p[i][j] = p_[i][j] - k[i][0] * p_[X_TOP][j] - k[i][1] * p_[X_SIDE][j];
+  memcpy(p_, p, sizeof(p_));
+}
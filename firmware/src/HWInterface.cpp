@@ -8,10 +8,17 @@
 
 static HWInterface *instance = nullptr;
 
+// remote mode posted by the web server, applied by service()
+static portMUX_TYPE hw_mux = portMUX_INITIALIZER_UNLOCKED;
+
 HWInterface::HWInterface(WaterControl *water_control) :
   water_control_(water_control),
   power_trigger_available_(true),
-  power_state_(0)
+  power_state_(0),
+  remote_(false),
+  remote_switches_(0),
+  remote_pending_(false),
+  remote_mode_(WATERCTRL_OFF)
 {
   if (instance)
   {
@@ -38,6 +45,15 @@ HWInterface* HWInterface::getInstance()
 
 void HWInterface::service()
 {
+  WATERCTRL_State_t remote_mode;
+  bool remote_pending;
+
+  portENTER_CRITICAL(&hw_mux);
+  remote_pending = remote_pending_;
+  remote_mode = remote_mode_;
+  remote_pending_ = false;
+  portEXIT_CRITICAL(&hw_mux);
+
   if (btn_power->active())
   {
     if (power_trigger_available_)
@@ -84,6 +100,17 @@ void HWInterface::service()
       water_control_->overridePump(0, 0);
     }
     water_control_->overridePumpCheck();
+
+    if (remote_pending)
+      applyRemoteMode(remote_mode);
+
+    // a remote mode holds until the switches are moved
+    if (remote_)
+    {
+      if (readSwitches() == remote_switches_)
+        return;
+      remote_ = false;
+    }
   
     if (sw_coffee_active)
     {
@@ -138,6 +165,53 @@ void HWInterface::service()
   } /* if power_state */
 }
 
+uint32_t HWInterface::readSwitches()
+{
+  return (sw_coffee->active() ? 1 : 0) | (sw_water->active() ? 2 : 0) | (sw_steam->active() ? 4 : 0);
+}
+
+// web server task - the mode is switched by service()
+bool HWInterface::setRemoteMode(WATERCTRL_State_t mode)
+{
+  if (!power_state_ || mode > WATERCTRL_STEAM)
+    return false;
+
+  portENTER_CRITICAL(&hw_mux);
+  remote_mode_ = mode;
+  remote_pending_ = true;
+  portEXIT_CRITICAL(&hw_mux);
+  return true;
+}
+
+void HWInterface::applyRemoteMode(WATERCTRL_State_t mode)
+{
+  remote_switches_ = readSwitches();
+  remote_ = true;
+  power_state_ = systime_ms();  // re-set power-off timer
+
+  switch (mode)
+  {
+    case WATERCTRL_OFF:
+      water_control_->stop();
+      break;
+    case WATERCTRL_WATER:
+      water_control_->startPump(50, false);
+      break;
+    case WATERCTRL_WATER_VALVE:
+      water_control_->startPump(100, true);
+      break;
+    case WATERCTRL_SHOT:
+      water_control_->startShot();
+      break;
+    case WATERCTRL_PREHEAT:
+      water_control_->startPreheat();
+      break;
+    case WATERCTRL_STEAM:
+      water_control_->startSteam();
+      break;
+  }
+}
+
 bool HWInterface::isActive()
 {
   return (power_state_) ? true : false;
@@ -147,6 +221,7 @@ void HWInterface::powerOff()
 {
   Serial.println("powering DOWN!");
   power_state_ = 0;
+  remote_ = false;
   water_control_->disable();
   digitalWrite(Pins::led_green, LOW);
 }
@@ -0,0 +1,314 @@
+#include "History.hpp"
+#include "helpers.hpp"
+
+static History *instance = nullptr;
+
+static const char CSV_HEADER[] = "time_ms,top,side,brewhead,heater,pump\n";
+static constexpr float TEMP_INVALID = 999.0f;  // reading of a failed probe
+
+History::History() :
+  blocks_(nullptr),
+  mutex_(nullptr),
+  archive_invalid_(0),
+  archive_count_(0),
+  archive_start_ms_(0)
+{
+  if (instance)
+  {
+    Serial.println("ERROR: more than one History generated");
+    ESP.restart();
+    return;
+  }
+
+  blocks_ = static_cast<Block_t *>(calloc(ARCHIVE_BLOCKS + RECENT_BLOCKS, sizeof(Block_t)));
+  mutex_ = xSemaphoreCreateMutex();
+
+  if (blocks_ == nullptr || mutex_ == nullptr)
+  {
+    Serial.println("History ERROR init failed");
+    return;
+  }
+
+  tiers_[TIER_ARCHIVE].blocks = blocks_;
+  tiers_[TIER_ARCHIVE].size = ARCHIVE_BLOCKS;
+  tiers_[TIER_RECENT].blocks = blocks_ + ARCHIVE_BLOCKS;
+  tiers_[TIER_RECENT].size = RECENT_BLOCKS;
+  for (uint32_t t = 0; t < TIERS; t++)
+  {
+    tiers_[t].head = 0;
+    tiers_[t].generation = 0;
+    startBlock(tiers_[t], 0);
+  }
+
+  instance = this;
+}
+
+History* History::getInstance()
+{
+  return instance;
+}
+
+// temperatures are rounded to a binary fraction, so unchanged readings
+// compress to a single bit and changes only carry a few mantissa bits
+static void quantize(const float (&values)[HISTORY_CHANNELS], float (&quantized)[HISTORY_CHANNELS])
+{
+  for (uint32_t ch = 0; ch < HISTORY_CHANNELS; ch++)
+  {
+    if (ch == HISTORY_TEMP_TOP || ch == HISTORY_TEMP_SIDE || ch == HISTORY_TEMP_BREWHEAD)
+      quantized[ch] = roundf(values[ch] * History::TEMP_RESOLUTION) / History::TEMP_RESOLUTION;
+    else
+      quantized[ch] = roundf(values[ch]);
+  }
+}
+
+void History::record(uint32_t time_ms, const float (&values)[HISTORY_CHANNELS])
+{
+  if (instance == nullptr)
+    return;
+
+  float quantized[HISTORY_CHANNELS];
+  quantize(values, quantized);
+
+  xSemaphoreTake(instance->mutex_, portMAX_DELAY);
+  instance->append(instance->tiers_[TIER_RECENT], time_ms, quantized);
+  xSemaphoreGive(instance->mutex_);
+
+  instance->archive(time_ms, values);
+}
+
+// averages the samples of every ARCHIVE_PERIOD_MS into one archive record
+void History::archive(uint32_t time_ms, const float (&values)[HISTORY_CHANNELS])
+{
+  // unsigned difference - valid across the wrap-around of the systime
+  if (archive_count_ > 0 && time_ms - archive_start_ms_ >= ARCHIVE_PERIOD_MS)
+  {
+    float mean[HISTORY_CHANNELS];
+    float quantized[HISTORY_CHANNELS];
+
+    for (uint32_t ch = 0; ch < HISTORY_CHANNELS; ch++)
+      mean[ch] = (archive_invalid_ & (1u << ch)) ? TEMP_INVALID : archive_sum_[ch] / archive_count_;
+    quantize(mean, quantized);
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    append(tiers_[TIER_ARCHIVE], archive_start_ms_, quantized);
+    xSemaphoreGive(mutex_);
+
+    archive_count_ = 0;
+  }
+
+  if (archive_count_ == 0)
+  {
+    for (uint32_t ch = 0; ch < HISTORY_CHANNELS; ch++)
+      archive_sum_[ch] = 0.0f;
+    archive_invalid_ = 0;
+    archive_start_ms_ = time_ms;
+  }
+
+  for (uint32_t ch = 0; ch < HISTORY_CHANNELS; ch++)
+  {
+    if (values[ch] >= TEMP_INVALID)
+      archive_invalid_ |= 1u << ch;
+    archive_sum_[ch] += values[ch];
+  }
+  archive_count_++;
+}
+
+void History::append(Tier_t &tier, uint32_t time_ms, const float (&values)[HISTORY_CHANNELS])
+{
+  if (!tier.encoder.append(time_ms, values))
+  {
+    // block full - continue in the next one, which drops the oldest data
+    tier.head = (tier.head + 1) % tier.size;
+    startBlock(tier, tier.head);
+    if (!tier.encoder.append(time_ms, values))
+      return;
+  }
+
+  Block_t &block = tier.blocks[tier.head];
+  if (block.count == 0)
+    block.first_ms = time_ms;
+  block.last_ms = time_ms;
+  block.count = tier.encoder.getCount();
+}
+
+void History::startBlock(Tier_t &tier, uint32_t idx)
+{
+  Block_t &block = tier.blocks[idx];
+
+  block.generation = ++tier.generation;
+  block.first_ms = 0;
+  block.last_ms = 0;
+  block.count = 0;
+  tier.encoder.begin(block.data, BLOCK_SIZE);
+}
+
+// oldest block with at least min_generation containing data at/after from_ms
+History::Block_t *History::findBlock(Tier_t &tier, uint32_t min_generation, uint32_t from_ms)
+{
+  Block_t *found = nullptr;
+
+  for (uint32_t i = 0; i < tier.size; i++)
+  {
+    Block_t *block = &tier.blocks[i];
+    if (block->generation == 0 || block->generation < min_generation || block->count == 0)
+      continue;
+    if (block->last_ms < from_ms)
+      continue;
+    if (found == nullptr || block->generation < found->generation)
+      found = block;
+  }
+  return found;
+}
+
+History::Block_t *History::getBlock(Tier_t &tier, uint32_t generation)
+{
+  for (uint32_t i = 0; i < tier.size; i++)
+  {
+    if (tier.blocks[i].generation == generation)
+      return &tier.blocks[i];
+  }
+  return nullptr;
+}
+
+void History::beginCursor(Cursor_t &cursor, uint32_t from_ms, uint32_t to_ms)
+{
+  cursor.from_ms = from_ms;
+  cursor.to_ms = to_ms;
+  cursor.tier = TIER_ARCHIVE;
+  cursor.generation = 0;
+  cursor.record = 0;
+  cursor.count = 0;
+  cursor.header_sent = false;
+  cursor.done = false;
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  Block_t *oldest = findBlock(tiers_[TIER_RECENT], 0, 0);
+  cursor.recent_ms = (oldest != nullptr) ? oldest->first_ms : 0;
+  xSemaphoreGive(mutex_);
+}
+
+// copies the next (part of a) block into the cursor, false at the end of the tier.
+// only the copy is done under the lock - blocks are decoded and formatted without it.
+bool History::loadBlock(Cursor_t &cursor)
+{
+  Tier_t &tier = tiers_[cursor.tier];
+  bool loaded = true;
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+
+  // current block - it might have been overwritten or appended to meanwhile
+  Block_t *block = (cursor.generation != 0) ? getBlock(tier, cursor.generation) : nullptr;
+
+  if (block != nullptr && block->count > cursor.count)
+  {
+    // records were appended - the bits already decoded are unchanged
+    memcpy(cursor.data, block->data, BLOCK_SIZE);
+    cursor.count = block->count;
+  }
+  else if (block != nullptr && block == &tier.blocks[tier.head])
+  {
+    // reached the end of the block currently written
+    loaded = false;
+  }
+  else
+  {
+    block = findBlock(tier, cursor.generation + 1, cursor.from_ms);
+    if (block != nullptr)
+    {
+      memcpy(cursor.data, block->data, BLOCK_SIZE);
+      cursor.generation = block->generation;
+      cursor.record = 0;
+      cursor.count = block->count;
+      cursor.decoder.begin(cursor.data);
+    }
+    else
+      loaded = false;
+  }
+
+  xSemaphoreGive(mutex_);
+
+  return loaded;
+}
+
+// decodes the block copy in the cursor into the response buffer,
+// the decoder state in the cursor carries over to the next call
+size_t History::read(Cursor_t &cursor, uint8_t *buffer, size_t max_len)
+{
+  size_t len = 0;
+  char *out = reinterpret_cast<char *>(buffer);
+
+  if (cursor.done)
+    return 0;
+
+  if (!cursor.header_sent)
+  {
+    if (max_len < sizeof(CSV_HEADER))
+      return 0;
+    memcpy(out, CSV_HEADER, sizeof(CSV_HEADER) - 1);
+    len = sizeof(CSV_HEADER) - 1;
+    cursor.header_sent = true;
+  }
+
+  while (max_len - len >= LINE_MAX)
+  {
+    if (cursor.record >= cursor.count && !loadBlock(cursor))
+    {
+      if (cursor.tier == TIER_RECENT)
+      {
+        cursor.done = true;
+        break;
+      }
+      // archive read - continue at full rate
+      cursor.tier = TIER_RECENT;
+      cursor.generation = 0;
+      cursor.record = 0;
+      cursor.count = 0;
+      continue;
+    }
+
+    uint32_t time_ms;
+    float values[HISTORY_CHANNELS];
+    cursor.decoder.next(time_ms, values);
+    cursor.record++;
+
+    if (cursor.tier == TIER_ARCHIVE && time_ms >= cursor.recent_ms)
+    {
+      // the rest is covered by the full rate records
+      cursor.tier = TIER_RECENT;
+      cursor.generation = 0;
+      cursor.record = 0;
+      cursor.count = 0;
+      continue;
+    }
+    if (time_ms < cursor.from_ms)
+      continue;
+    if (time_ms > cursor.to_ms)
+    {
+      cursor.done = true;
+      break;
+    }
+
+    len += snprintf(out + len, max_len - len, "%u,%.2f,%.2f,%.2f,%.0f,%.0f\n", time_ms,
+                    values[HISTORY_TEMP_TOP], values[HISTORY_TEMP_SIDE], values[HISTORY_TEMP_BREWHEAD],
+                    values[HISTORY_HEATER], values[HISTORY_PUMP]);
+  }
+
+  return len;
+}
+
+uint32_t History::getMemoryUsage()
+{
+  return (ARCHIVE_BLOCKS + RECENT_BLOCKS) * sizeof(Block_t);
+}
+
+uint32_t History::getRecordCount()
+{
+  uint32_t count = 0;
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  for (uint32_t i = 0; i < ARCHIVE_BLOCKS + RECENT_BLOCKS; i++)
+    count += blocks_[i].count;
+  xSemaphoreGive(mutex_);
+
+  return count;
+}
@@ -0,0 +1,299 @@
+#include "Json.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+JsonWriter::JsonWriter(ResponseWriter &writer) :
+  writer_(writer),
+  depth_(0)
+{
+  first_[0] = true;
+}
+
+void JsonWriter::next(const char *key)
+{
+  if (!first_[depth_])
+    writer_.append(",", 1);
+  first_[depth_] = false;
+
+  if (key)
+  {
+    appendString(key);
+    writer_.append(":", 1);
+  }
+}
+
+void JsonWriter::beginObject(const char *key)
+{
+  next(key);
+  writer_.append("{", 1);
+  if (depth_ < DEPTH_MAX)
+    depth_++;
+  first_[depth_] = true;
+}
+
+void JsonWriter::endObject()
+{
+  writer_.append("}", 1);
+  if (depth_ > 0)
+    depth_--;
+}
+
+void JsonWriter::beginArray(const char *key)
+{
+  next(key);
+  writer_.append("[", 1);
+  if (depth_ < DEPTH_MAX)
+    depth_++;
+  first_[depth_] = true;
+}
+
+void JsonWriter::endArray()
+{
+  writer_.append("]", 1);
+  if (depth_ > 0)
+    depth_--;
+}
+
+void JsonWriter::addFloat(const char *key, float value, uint32_t decimals)
+{
+  next(key);
+  if (isnan(value) || isinf(value))
+    writer_.append("null", 4);
+  else
+    writer_.appendFloat(value, decimals);
+}
+
+void JsonWriter::addUInt(const char *key, uint32_t value)
+{
+  next(key);
+  writer_.appendUInt(value);
+}
+
+void JsonWriter::addInt(const char *key, int32_t value)
+{
+  next(key);
+  writer_.appendInt(value);
+}
+
+void JsonWriter::addBool(const char *key, bool value)
+{
+  next(key);
+  if (value)
+    writer_.append("true", 4);
+  else
+    writer_.append("false", 5);
+}
+
+void JsonWriter::addString(const char *key, const char *value)
+{
+  next(key);
+  appendString(value);
+}
+
+void JsonWriter::appendString(const char *text)
+{
+  static const char hex[] = "0123456789abcdef";
+  const char *run = text;
+
+  writer_.append("\"", 1);
+  for (const char *p = text; *p != '\0'; p++)
+  {
+    unsigned char c = *p;
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+
+    // flush the plain run, then the escape
+    writer_.append(run, p - run);
+    run = p + 1;
+    if (c == '"')
+      writer_.append("\\\"", 2);
+    else if (c == '\\')
+      writer_.append("\\\\", 2);
+    else if (c == '\n')
+      writer_.append("\\n", 2);
+    else
+    {
+      char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+      writer_.append(escape, 6);
+    }
+  }
+  writer_.append(run, strlen(run));
+  writer_.append("\"", 1);
+}
+
+static const char *skip_space(const char *p)
+{
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+    p++;
+  return p;
+}
+
+// end of the string starting at the opening quote, nullptr if unterminated
+static const char *skip_string(const char *p)
+{
+  for (p++; *p != '\0'; p++)
+  {
+    if (*p == '\\')
+    {
+      if (*++p == '\0')
+        return nullptr;
+    }
+    else if (*p == '"')
+      return p + 1;
+  }
+  return nullptr;
+}
+
+// end of any value, nullptr if malformed
+static const char *skip_value(const char *p)
+{
+  if (*p == '"')
+    return skip_string(p);
+
+  if (*p == '{' || *p == '[')
+  {
+    uint32_t depth = 0;
+    for (; *p != '\0'; p++)
+    {
+      if (*p == '"')
+      {
+        p = skip_string(p);
+        if (p == nullptr)
+          return nullptr;
+        p--;
+      }
+      else if (*p == '{' || *p == '[')
+        depth++;
+      else if ((*p == '}' || *p == ']') && --depth == 0)
+        return p + 1;
+    }
+    return nullptr;
+  }
+
+  // number, true, false, null
+  const char *start = p;
+  while (*p != '\0' && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+    p++;
+  return (p > start) ? p : nullptr;
+}
+
+// start of the value of key in the top level object
+static const char *find_value(const char *json, const char *key)
+{
+  size_t key_length = strlen(key);
+  const char *p = skip_space(json);
+
+  if (*p++ != '{')
+    return nullptr;
+
+  while (1)
+  {
+    p = skip_space(p);
+    if (*p != '"')
+      return nullptr;
+
+    const char *key_start = p + 1;
+    const char *key_end = skip_string(p);
+    if (key_end == nullptr)
+      return nullptr;
+
+    p = skip_space(key_end);
+    if (*p++ != ':')
+      return nullptr;
+    p = skip_space(p);
+
+    if ((size_t)(key_end - 1 - key_start) == key_length && strncmp(key_start, key, key_length) == 0)
+      return p;
+
+    p = skip_value(p);
+    if (p == nullptr)
+      return nullptr;
+    p = skip_space(p);
+    if (*p++ != ',')
+      return nullptr;
+  }
+}
+
+bool json_get_float(const char *json, const char *key, float &value)
+{
+  const char *p = find_value(json, key);
+  char *end;
+
+  if (p == nullptr || !(*p == '-' || (*p >= '0' && *p <= '9')))
+    return false;
+  value = strtof(p, &end);
+  return end != p;
+}
+
+bool json_get_uint(const char *json, const char *key, uint32_t &value)
+{
+  const char *p = find_value(json, key);
+  char *end;
+
+  // digits only: no sign, fraction or exponent
+  if (p == nullptr || !(*p >= '0' && *p <= '9'))
+    return false;
+  errno = 0;
+  unsigned long number = strtoul(p, &end, 10);
+  if (errno == ERANGE || number > UINT32_MAX || skip_value(p) != end)
+    return false;
+  value = number;
+  return true;
+}
+
+bool json_get_bool(const char *json, const char *key, bool &value)
+{
+  const char *p = find_value(json, key);
+
+  if (p && strncmp(p, "true", 4) == 0)
+    value = true;
+  else if (p && strncmp(p, "false", 5) == 0)
+    value = false;
+  else
+    return false;
+  return true;
+}
+
+bool json_get_string(const char *json, const char *key, char *buffer, size_t size)
+{
+  const char *p = find_value(json, key);
+  size_t length = 0;
+
+  if (p == nullptr || *p != '"' || size == 0 || skip_string(p) == nullptr)
+    return false;
+
+  for (p++; *p != '"'; p++)
+  {
+    char c = *p;
+    if (c == '\\')
+    {
+      c = *++p;
+      if (c == 'n')
+        c = '\n';
+      else if (c == 't')
+        c = '\t';
+      else if (c == 'r')
+        c = '\r';
+      else if (c == 'u')
+      {
+        // ASCII only
+        char hex[5] = {0};
+        for (uint32_t n = 0; n < 4; n++)
+          if ((hex[n] = *++p) == '\0')
+            return false;
+        unsigned long code = strtoul(hex, nullptr, 16);
+        if (code > 0x7F)
+          return false;
+        c = code;
+      }
+      // '"', '\\' and '/' stand for themselves
+    }
+    if (length + 1 >= size)
+      return false;
+    buffer[length++] = c;
+  }
+  buffer[length] = '\0';
+  return true;
+}
@@ -0,0 +1,86 @@
+#include "MPCController.hpp"
+#include <string.h>
+
+MPCController::MPCController(const MPCTable *table, float disturbance_gain) :
+  table_(table),
+  disturbance_gain_(disturbance_gain),
+  target_(-1.0f),
+  disturbance_(0.0f),
+  element_(0.0f),
+  prediction_(0.0f),
+  prediction_valid_(false),
+  idx_(0)
+{
+  reset();
+}
+
+// heater element and outputs start at 0%
+void MPCController::reset()
+{
+  memset(&point_, 0, sizeof(point_));
+  memset(outputs_, 0, sizeof(outputs_));
+  idx_ = 0;
+  disturbance_ = 0.0f;
+  element_ = 0.0f;
+  prediction_valid_ = false;
+  target_ = -1.0f;
+}
+
+float MPCController::update(float target, float pv, float known)
+{
+  uint32_t dead_steps = table_->getDeadSteps();
+  float ae = table_->getElementPole();
+  float ak = table_->getFadePole();
+
+  if (target != target_)
+  {
+    // deviations are relative to the hold output of the target - move the history along
+    float shift = point_.u_hold;
+    target_ = target;
+    point_ = table_->lookup(target);
+    shift -= point_.u_hold;
+    element_ += shift;
+    for (uint32_t i = 0; i < dead_steps; i++)
+      outputs_[i] += shift;
+    // old prediction is meaningless now
+    prediction_valid_ = false;
+  }
+
+  float y = pv - target_;
+
+  // learn the disturbance from what the model did not expect
+  if (prediction_valid_)
+    disturbance_ += disturbance_gain_ * (y - prediction_) / point_.b;
+
+  // the element output heats during this period, the oldest output moves it on
+  prediction_ = point_.a * y + point_.b * (element_ + disturbance_ - known);
+  prediction_valid_ = true;
+
+  // deviation, element output and known disturbance at the end of the dead time
+  float y_dead = y;
+  float h_dead = element_;
+  float k_dead = -known;
+  for (uint32_t i = 0; i < dead_steps; i++)
+  {
+    y_dead = point_.a * y_dead + point_.b * (h_dead + disturbance_ + k_dead);
+    h_dead = ae * h_dead + (1.0f - ae) * outputs_[(idx_ + i) % dead_steps];
+    k_dead *= ak;
+  }
+
+  return point_.u_hold + point_.gain_y * y_dead + point_.gain_h * h_dead
+         + point_.gain_d * disturbance_ + point_.gain_k * k_dead;
+}
+
+void MPCController::setApplied(float u)
+{
+  uint32_t dead_steps = table_->getDeadSteps();
+  float ae = table_->getElementPole();
+
+  if (dead_steps == 0)
+    return;
+
+  // the oldest output leaves the dead time and drives the element
+  element_ = ae * element_ + (1.0f - ae) * outputs_[idx_];
+  outputs_[idx_] = u - point_.u_hold;
+  idx_ = (idx_ + 1) % dead_steps;
+}
@@ -0,0 +1,177 @@
+#include "MainsPLL.hpp"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_attr.h>
+#else
+#define IRAM_ATTR
+#endif
+
+// +-5% around the nominal interval
+#define MAINS_TOLERANCE_PERMILLE  50
+
+const MainsPLL::Nominal_t MainsPLL::nominals_[MainsPLL::NOMINALS] = {
+  {10000, 50, 2},
+  { 8333, 60, 2},
+  {20000, 50, 1},
+  {16667, 60, 1},
+};
+
+MainsPLL::MainsPLL(uint32_t default_frequency) :
+  state_(MAINS_UNLOCKED),
+  frequency_(default_frequency),
+  edges_per_cycle_(2)
+{
+  memset(&stats_, 0, sizeof(stats_));
+  reset();
+}
+
+void MainsPLL::reset()
+{
+  state_ = MAINS_UNLOCKED;
+  candidate_ = -1;
+  candidate_count_ = 0;
+  candidate_sum_us_ = 0;
+  last_edge_us_ = 0;
+  last_edge_valid_ = false;
+  last_good_us_ = 0;
+  phase_us_ = 0;
+  phase_frac_ = 0;
+  period_q8_ = (1000000u / frequency_ / 2) << 8;
+  nominal_q8_ = period_q8_;
+  outliers_ = 0;
+}
+
+uint32_t IRAM_ATTR MainsPLL::getHalfPeriodUs()
+{
+  if (state_ != MAINS_LOCKED)
+    return 1000000u / frequency_ / 2;
+  return (period_q8_ * edges_per_cycle_ / 2 + 128) >> 8;
+}
+
+int32_t IRAM_ATTR MainsPLL::classify(uint32_t interval_us)
+{
+  for (uint32_t n = 0; n < NOMINALS; n++)
+  {
+    uint32_t nominal = nominals_[n].interval_us;
+    uint32_t tolerance = nominal * MAINS_TOLERANCE_PERMILLE / 1000;
+    if (interval_us + tolerance >= nominal && interval_us <= nominal + tolerance)
+      return n;
+  }
+  return -1;
+}
+
+void IRAM_ATTR MainsPLL::edge(uint32_t time_us)
+{
+  stats_.edges++;
+
+  if (state_ == MAINS_LOCKED)
+  {
+    uint32_t period_us = period_q8_ >> 8;
+    int32_t err = (int32_t)(time_us - phase_us_) - (int32_t)period_us;
+    uint32_t skipped = 0;
+
+    // bridge missing edges
+    while (err > (int32_t)period_us / 2 && skipped <= LOST_PERIODS)
+    {
+      phase_us_ += period_us;
+      err -= period_us;
+      skipped++;
+    }
+
+    if (skipped > LOST_PERIODS)
+    {
+      unlock();
+    }
+    else if (err > (int32_t)period_us / 8 || err < -(int32_t)period_us / 8)
+    {
+      // noise - keep the prediction
+      stats_.outliers++;
+      if (++outliers_ > MAX_OUTLIERS)
+        unlock();
+    }
+    else
+    {
+      stats_.missed += skipped;
+      outliers_ = 0;
+      last_good_us_ = time_us;
+
+      // PI loop, proportional part on the phase, integral part on the period
+      uint32_t phase_q8 = phase_frac_ + period_q8_ + err * 256 / 8;
+      phase_us_ += phase_q8 >> 8;
+      phase_frac_ = phase_q8 & 0xff;
+
+      period_q8_ += err * 256 / 128;
+      uint32_t limit = nominal_q8_ * MAINS_TOLERANCE_PERMILLE / 1000;
+      if (period_q8_ > nominal_q8_ + limit)
+        period_q8_ = nominal_q8_ + limit;
+      else if (period_q8_ < nominal_q8_ - limit)
+        period_q8_ = nominal_q8_ - limit;
+      return;
+    }
+
+    if (state_ == MAINS_LOCKED)
+      return;
+    // lost it - this edge starts a new acquisition
+  }
+
+  // acquisition: the same nominal interval LOCK_EDGES times in a row
+  if (last_edge_valid_)
+  {
+    uint32_t interval = time_us - last_edge_us_;
+    int32_t n = classify(interval);
+
+    if (n < 0 || n != candidate_)
+    {
+      candidate_ = n;
+      candidate_count_ = 0;
+      candidate_sum_us_ = 0;
+    }
+    if (n >= 0)
+    {
+      candidate_count_++;
+      candidate_sum_us_ += interval;
+    }
+  }
+  last_edge_us_ = time_us;
+  last_edge_valid_ = true;
+
+  if (candidate_ >= 0 && candidate_count_ >= LOCK_EDGES)
+    lock(time_us);
+}
+
+void IRAM_ATTR MainsPLL::lock(uint32_t time_us)
+{
+  const Nominal_t &nominal = nominals_[candidate_];
+
+  nominal_q8_ = nominal.interval_us << 8;
+  period_q8_ = (candidate_sum_us_ << 8) / candidate_count_;
+  phase_us_ = time_us;
+  phase_frac_ = 0;
+  last_good_us_ = time_us;
+  outliers_ = 0;
+  frequency_ = nominal.frequency;
+  edges_per_cycle_ = nominal.edges_per_cycle;
+  stats_.locks++;
+  state_ = MAINS_LOCKED;
+}
+
+void IRAM_ATTR MainsPLL::unlock()
+{
+  stats_.losses++;
+  state_ = MAINS_UNLOCKED;
+  candidate_ = -1;
+  candidate_count_ = 0;
+  candidate_sum_us_ = 0;
+  last_edge_valid_ = false;
+}
+
+void MainsPLL::poll(uint32_t now_us)
+{
+  if (state_ != MAINS_LOCKED)
+    return;
+
+  // signed - an edge may have come in after now_us was taken
+  if ((int32_t)(now_us - last_good_us_) > (int32_t)(LOST_PERIODS * (period_q8_ >> 8)))
+    unlock();
+}
@@ -3,47 +3,101 @@
 #include "SSRPump.hpp"
 #include "WaterControl.hpp"
 #include "Pins.hpp"
-#include "Timers.hpp"
+#include "SSRScheduler.hpp"
 #include "TaskConfig.hpp"
 #include "Sensors.hpp"
 #include "WebInterface.hpp"
+#include "HWInterface.hpp"
+#include "SystemState.hpp"
+#include "BoilerObserver.hpp"
+#include "Shot.hpp"
+#include "MPCController.hpp"
+#include "RelayAutotune.hpp"
 #include "helpers.hpp"
 
+static constexpr MPCTable mpc_table({
+  MPC_HEATER_POWER,
+  MPC_HEATER_LAG / 1000.0,
+  MPC_CAPACITY,
+  MPC_LOSS_R,
+  MPC_TEMP_AMBIENT,
+  MPC_DRAW_FADE / 1000.0,
+  PID_TS / 1000.0,
+  MPC_DEAD_TIME / PID_TS,
+  MPC_HORIZON,
+  MPC_CLTR
+});
+
+static portMUX_TYPE gains_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static_assert(mpc_table.getDeadSteps() >= 1 && mpc_table.getDeadSteps() <= MPCTable::DEAD_STEPS_MAX, "MPC: dead time out of range");
+
 PIDHeater::PIDHeater(WaterControl *water_control, float p_pos, float p_neg, float i, float d, uint32_t ts_ms) :
   water_control_(water_control),
-  kPpos_(p_pos),
-  kPneg_(p_neg),
-  kI_(i),
-  kD_(d),
+  gains_changed_(false),
+  regime_(PID_REGIME_IDLE),
+  kernel_mode_(PID_MODE_WATER),
+  switch_count_(0),
   ts_(ts_ms),
   u_(0.0f),
   p_share_(0.0f),
   i_share_(0.0f),
   d_share_(0.0f),
-  u1_(0.0f),
-  pv1_(0.0f),
-  pv2_(0.0f),
+  ff_gain_(PID_FF_PUMP),
+  ff_share_(0.0f),
   target_(0.0f),
   mode_(PID_MODE_WATER),
+  pv_source_(PID_PV_SOURCE),
+  observer_(nullptr),
+  algorithm_(PID_ALGORITHM),
+  mpc_(nullptr),
+  autotune_(nullptr),
+  autotune_start_(false),
+  autotune_stop_(false),
+  autotune_setpoint_(0.0f),
   u_override_(-1.0f),
   u_override_cnt_(0),
   enabled_(false),
-  sem_update_(nullptr),
-  timer_update_(nullptr),
+  next_step_us_(0),
+  resync_(true),
+  sample_age_us_(0),
+  sample_age_max_us_(0),
+  steps_(0),
   task_handle_(nullptr)
 {
-  heater_ = new SSRHeater(Pins::ssr_heater, Timers::timer_heater, 10000);
+  heater_ = new SSRHeater(Pins::ssr_heater);
+  SSRScheduler::getInstance()->setHeater(heater_);
 
-  // sync semaphore
-  sem_update_ = xSemaphoreCreateBinary();
-  
-  // update timer - start must be called separately
-  timer_update_ = xTimerCreate("tmr_pid", pdMS_TO_TICKS(ts_), pdTRUE, this, &PIDHeater::timer_cb_wrapper);
+  // same gains everywhere, except steam: always use the less defensive P+ value
+  // and cooling down from steam, where the heater has nothing to do
+  for (uint32_t r = 0; r < PID_REGIME_COUNT; r++)
+    gains_[r] = {p_pos, p_neg, i, d, 0.0f, 100.0f};
+  gains_[PID_REGIME_STEAM].p_neg = p_pos;
+  gains_[PID_REGIME_STEAM_RETURN].out_max = PID_STEAM_RETURN_MAX;
+  memset(switch_log_, 0, sizeof(switch_log_));
 
-  // create task
+  applyRegime(regime_, 0.0f);
+
+  BoilerModel_t model = {
+    OBSERVER_HEATER_POWER,
+    OBSERVER_HEATER_TAU,
+    OBSERVER_CAPACITY,
+    OBSERVER_LOSS,
+    OBSERVER_PUMP_FLOW,
+    OBSERVER_TEMP_AMBIENT,
+    OBSERVER_TEMP_INLET,
+    OBSERVER_TAU_TOP,
+    OBSERVER_TAU_SIDE
+  };
+  observer_ = new BoilerObserver(model, ts_ / 1000.0f);
+
+  mpc_ = new MPCController(&mpc_table, MPC_DIST_GAIN);
+  autotune_ = new RelayAutotune();
+
+  // create task - runs on notifications from SensorsHandler
   BaseType_t rval = xTaskCreate(&PIDHeater::task_wrapper, "task_pid", TaskConfig::PIDHeater_stacksize, this, TaskConfig::PIDHeater_priority, &task_handle_);
 
-  if (sem_update_ == NULL || timer_update_ == NULL || rval != pdPASS || task_handle_ == NULL)
+  if (rval != pdPASS || task_handle_ == NULL)
   {
     Serial.println("PIDHeater ERROR init failed");
   }
@@ -52,15 +106,19 @@ PIDHeater::PIDHeater(WaterControl *water_control, float p_pos, float p_neg, floa
 void PIDHeater::start()
 {
   Serial.println("PIDHeater ON!");
-  pv2_= SensorsHandler::getInstance()->getTempBoilerAvg();
-  pv1_ = pv2_;
-  u1_ = 0.0f;
+  float pv = SensorsHandler::getInstance()->getTempBoilerAvg();
+  kernel_.reset(q16_from_float(pv), 0);
+  kernel_mode_ = mode_;
+  observer_->reset(pv);
+  mpc_->reset();
   
   heater_->sync();
-  xTimerReset(timer_update_, 0);
+  resync_ = true;
 
   enabled_ = true;
-  Serial.println("P+ = " + String(kPpos_) + " P- = " + String(kPneg_) + " I = " + String(kI_) + " D = " + String(kD_));
+  PIDGains_t gains;
+  getRegimeGains(regime_, gains);
+  Serial.println(String(getRegimeName(regime_)) + ": P+ = " + String(gains.p_pos) + " P- = " + String(gains.p_neg) + " I = " + String(gains.i) + " D = " + String(gains.d));
 
   heater_->enable();
 }
@@ -68,6 +126,7 @@ void PIDHeater::start()
 void PIDHeater::stop()
 {
   enabled_ = false;
+  stopAutotune();
   heater_->setPWM(0);
   heater_->disable();
   Serial.println("PIDHeater OFF!");
@@ -89,13 +148,221 @@ void PIDHeater::setTarget(float temp, PID_Mode_t mode)
   mode_ = mode;
 }
 
-void PIDHeater::timer_cb_wrapper(TimerHandle_t arg)
+void PIDHeater::setAlgorithm(PID_Algorithm_t algorithm)
+{
+  // MPC restarts without history, PID continues from the last output
+  if (algorithm == PID_ALGO_MPC && algorithm_ != PID_ALGO_MPC)
+    mpc_->reset();
+  algorithm_ = algorithm;
+}
+
+// start and stop are only requested here, the state machine is run by the PID task
+bool PIDHeater::startAutotune(float setpoint)
+{
+  // false for NaN as well
+  if (!enabled_ || autotune_->isRunning() || !(setpoint > PID_MIN_TEMP && setpoint < PID_MAX_TEMP))
+  {
+    Serial.println("PIDHeater ERROR: autotune not possible");
+    return false;
+  }
+
+  portENTER_CRITICAL(&gains_mux);
+  autotune_setpoint_ = setpoint;
+  autotune_start_ = true;
+  autotune_stop_ = false;
+  portEXIT_CRITICAL(&gains_mux);
+  return true;
+}
+
+void PIDHeater::stopAutotune()
 {
-  static_cast<PIDHeater *>(pvTimerGetTimerID(arg))->timer_cb();
+  portENTER_CRITICAL(&gains_mux);
+  autotune_start_ = false;
+  autotune_stop_ = true;
+  portEXIT_CRITICAL(&gains_mux);
 }
-void PIDHeater::timer_cb()
+
+// in the PID task, before the step
+void PIDHeater::serviceAutotune()
 {
-  xSemaphoreGive(sem_update_);
+  portENTER_CRITICAL(&gains_mux);
+  bool start = autotune_start_;
+  bool stop = autotune_stop_;
+  float setpoint = autotune_setpoint_;
+  autotune_start_ = false;
+  autotune_stop_ = false;
+  portEXIT_CRITICAL(&gains_mux);
+
+  if ((stop || !enabled_) && autotune_->isRunning())
+  {
+    autotune_->stop();
+    reportAutotune();
+    return;
+  }
+  if (!start || !enabled_ || autotune_->isRunning())
+    return;
+
+  AutotuneConfig_t config = {
+    setpoint,
+    AUTOTUNE_OUTPUT_HIGH,
+    AUTOTUNE_OUTPUT_LOW,
+    AUTOTUNE_HYSTERESIS,
+    AUTOTUNE_CYCLES,
+    AUTOTUNE_MAX_OVERSHOOT,
+    PID_MIN_TEMP,
+    AUTOTUNE_TIMEOUT_MS,
+    AUTOTUNE_HALF_CYCLE_MS
+  };
+
+  if (autotune_->start(config, systime_ms()))
+    Serial.println("PIDHeater: autotune at " + String(setpoint) + " deg-C");
+  else
+    Serial.println("PIDHeater ERROR: autotune config invalid");
+}
+
+void PIDHeater::reportAutotune()
+{
+  if (autotune_->getState() != AUTOTUNE_DONE)
+  {
+    Serial.println("PIDHeater: autotune aborted, reason " + String(autotune_->getAbortReason()));
+    return;
+  }
+
+  const AutotuneResult_t &result = autotune_->getResult();
+  Serial.println("PIDHeater: autotune Ku = " + String(result.ku) + " Pu = " + String(result.pu) + " s turn time = " + String(result.turn_time) + " s");
+  Serial.println("  classic      P = " + String(result.classic.p) + " I = " + String(result.classic.i) + " D = " + String(result.classic.d));
+  Serial.println("  no overshoot P = " + String(result.no_overshoot.p) + " I = " + String(result.no_overshoot.i) + " D = " + String(result.no_overshoot.d));
+  Serial.println("  PI           P = " + String(result.pi.p) + " I = " + String(result.pi.i));
+}
+
+float PIDHeater::getWaterTempEstimate()
+{
+  return observer_->getWaterTemp();
+}
+
+// decimation of the sensor samples to the control period.
+// steps are scheduled on the sample timestamps, so the period does not drift
+// with the sensor rate. a step is taken with the sample closest to the due time.
+bool PIDHeater::isStepDue(uint32_t sample_us)
+{
+  uint32_t ts_us = ts_ * 1000;
+  SensorsHandler *sensors = SensorsHandler::getInstance();
+  int32_t half_period_us = (int32_t)SensorsHandler::getPeriodMs(sensors->getRate()) * 500;
+  int32_t late_us = (int32_t)(sample_us - next_step_us_);
+
+  // first sample or fell behind by more than a period (e.g. slow sensor rate)
+  if (resync_ || late_us >= (int32_t)ts_us)
+  {
+    resync_ = false;
+    next_step_us_ = sample_us + ts_us;
+    return true;
+  }
+
+  if (late_us + half_period_us < 0)
+    return false;
+
+  next_step_us_ += ts_us;
+  return true;
+}
+
+const char *PIDHeater::getRegimeName(PID_Regime_t regime)
+{
+  static const char *names[PID_REGIME_COUNT] = {"warmup", "idle", "shot", "steam", "steam-return"};
+  if (regime >= PID_REGIME_COUNT)
+    return "invalid";
+  return names[regime];
+}
+
+bool PIDHeater::setRegimeGains(PID_Regime_t regime, const PIDGains_t &gains)
+{
+  // written to be false for NaN, e.g. max=nan would switch off the limits
+  if (regime >= PID_REGIME_COUNT ||
+      !(isfinite(gains.p_pos) && isfinite(gains.p_neg) && isfinite(gains.i) && isfinite(gains.d)) ||
+      !(0.0f <= gains.out_min && gains.out_min <= gains.out_max && gains.out_max <= 100.0f))
+  {
+    Serial.println("PIDHeater ERROR: invalid gains");
+    return false;
+  }
+
+  portENTER_CRITICAL(&gains_mux);
+  gains_[regime] = gains;
+  gains_changed_ = true;
+  portEXIT_CRITICAL(&gains_mux);
+  return true;
+}
+
+void PIDHeater::getRegimeGains(PID_Regime_t regime, PIDGains_t &gains)
+{
+  portENTER_CRITICAL(&gains_mux);
+  gains = gains_[regime];
+  portEXIT_CRITICAL(&gains_mux);
+}
+
+// copies the switches, newest first. returns the number copied
+uint32_t PIDHeater::getSwitchLog(PIDRegimeSwitch_t *log, uint32_t size)
+{
+  uint32_t count;
+
+  portENTER_CRITICAL(&gains_mux);
+  count = switch_count_ < PID_SWITCH_LOG_SIZE ? switch_count_ : PID_SWITCH_LOG_SIZE;
+  if (count > size)
+    count = size;
+  for (uint32_t n = 0; n < count; n++)
+    log[n] = switch_log_[(switch_count_ - 1 - n) % PID_SWITCH_LOG_SIZE];
+  portEXIT_CRITICAL(&gains_mux);
+
+  return count;
+}
+
+PID_Regime_t PIDHeater::selectRegime(float pv)
+{
+  if (mode_ == PID_MODE_STEAM)
+    return PID_REGIME_STEAM;
+
+  if (water_control_->getState() == WATERCTRL_SHOT)
+    return PID_REGIME_SHOT;
+
+  // coming down from steam until the brew target is reached
+  if ((regime_ == PID_REGIME_STEAM || regime_ == PID_REGIME_STEAM_RETURN) && pv > target_ + PID_REGIME_BAND)
+    return PID_REGIME_STEAM_RETURN;
+
+  // cold, until close to the target
+  if (pv < target_ - PID_REGIME_WARMUP_ERR || (regime_ == PID_REGIME_WARMUP && pv < target_ - PID_REGIME_BAND))
+    return PID_REGIME_WARMUP;
+
+  return PID_REGIME_IDLE;
+}
+
+// bumpless transfer: the velocity form keeps its last output u1 across a gain
+// change, only u1 has to be moved into the limits of the new regime.
+// nothing is reset - the integral action lives in u1.
+void PIDHeater::applyRegime(PID_Regime_t regime, float pv)
+{
+  PIDGains_t gains;
+  getRegimeGains(regime, gains);
+
+  kernel_.setGains(gains.p_pos, gains.p_neg, gains.i, gains.d, ts_ / 1000.0f);
+
+  float u1 = q16_to_float(kernel_.getBase());
+  if (u1 < gains.out_min)
+    u1 = gains.out_min;
+  else if (u1 > gains.out_max)
+    u1 = gains.out_max;
+  kernel_.setBase(q16_from_float(u1));
+
+  if (regime != regime_)
+  {
+    PIDRegimeSwitch_t entry = {systime_ms(), regime_, regime, pv, u1};
+
+    portENTER_CRITICAL(&gains_mux);
+    switch_log_[switch_count_ % PID_SWITCH_LOG_SIZE] = entry;
+    switch_count_++;
+    portEXIT_CRITICAL(&gains_mux);
+
+    Serial.println("PIDHeater: " + String(getRegimeName(regime_)) + " -> " + String(getRegimeName(regime)) +
+                   " at " + String(pv) + " deg-C, u = " + String(u1));
+    regime_ = regime;
+  }
 }
 
 void PIDHeater::task_wrapper(void *arg)
@@ -106,20 +373,36 @@ void PIDHeater::task()
 {
   float pv, e;
   float u_limited;
+  uint32_t sample_us;
+  PIDGains_t gains;
 
-  xTimerStart(timer_update_, portMAX_DELAY);
+  SensorsHandler::getInstance()->setSubscriber(xTaskGetCurrentTaskHandle());
 
   while(1)
   {
-    if (xSemaphoreTake(sem_update_, portMAX_DELAY) == pdTRUE)
+    // every fresh sample wakes us up, most of them are skipped
+    if (ulTaskNotifyTake(pdTRUE, portMAX_DELAY) == 0)
+      continue;
+
+    sample_us = SensorsHandler::getSampleTimeUs();
+    if (isStepDue(sample_us))
     {
+      // heater and pump as applied during the last period
+      observer_->update(heater_->getDuty() / 1000.0f, water_control_->pump_->getPWM() / 100.0f,
+                        SensorsHandler::getTempBoilerTop(), SensorsHandler::getTempBoilerSide());
+      serviceAutotune();
+
       if (enabled_ == true)
       {
         // Serial.println("PID running at " + String(systime_ms()));
-        if (mode_ == PID_MODE_WATER)
+        float top = SensorsHandler::getInstance()->getTempBoilerTop();
+        float side = SensorsHandler::getInstance()->getTempBoilerSide();
+
+        // the model alone must not heat - without any probe the heuristic sees 999 and stops
+        if (pv_source_ == PID_PV_OBSERVER && mode_ == PID_MODE_WATER && (top < PID_MAX_TEMP || side < PID_MAX_TEMP))
+          pv = observer_->getWaterTemp();
+        else if (mode_ == PID_MODE_WATER)
         {
-          float top = SensorsHandler::getInstance()->getTempBoilerTop();
-          float side = SensorsHandler::getInstance()->getTempBoilerSide();
           float average = SensorsHandler::getInstance()->getTempBoilerAvg();
           if (side > top)
             pv = side;
@@ -130,33 +413,91 @@ void PIDHeater::task()
           pv = SensorsHandler::getInstance()->getTempBoilerMax();
           
         e = target_ - pv;
-        
-        // PID type C
-        // always use less defensive P+ value in steam mode
-        if ((pv1_ - pv) > 0 || mode_ == PID_MODE_STEAM)
-          p_share_ = kPpos_ * (pv1_ - pv);
+
+        // steam uses the maximum probe - rebase the process values, not the output
+        if (mode_ != kernel_mode_)
+        {
+          kernel_.reset(q16_from_float(pv), kernel_.getBase());
+          kernel_mode_ = mode_;
+        }
+
+        PID_Regime_t regime = selectRegime(pv);
+        if (regime != regime_ || gains_changed_)
+        {
+          gains_changed_ = false;
+          applyRegime(regime, pv);
+        }
+
+        // the relay experiment needs undisturbed oscillations
+        if (autotune_->isRunning() && water_control_->pump_->getPWM() != PWM_0_PERCENT)
+        {
+          autotune_->abort(AUTOTUNE_ABORT_DISTURBANCE);
+          reportAutotune();
+        }
+
+        // feed-forward: heat carried away by the fresh water, before the probes see it
+        ff_share_ = autotune_->isRunning() ? 0.0f : getFFGain() * getPumpForecast();
+
+        if (autotune_->isRunning())
+        {
+          p_share_ = 0;
+          i_share_ = 0;
+          d_share_ = 0;
+          u_ = autotune_->update(systime_ms(), pv);
+          u_limited = u_;
+
+          // back to normal control from a clean state
+          if (!autotune_->isRunning())
+          {
+            reportAutotune();
+            kernel_.reset(q16_from_float(pv), 0);
+            mpc_->reset();
+          }
+        }
+        else if (algorithm_ == PID_ALGO_MPC)
+        {
+          // predictive controller knows the element lag - no heuristics needed.
+          // the pump draw is part of its model, the feed-forward is added back below.
+          p_share_ = 0;
+          i_share_ = 0;
+          d_share_ = 0;
+          u_ = mpc_->update(target_, pv, ff_share_) - ff_share_;
+          u_limited = u_;
+        }
         else
-          p_share_ = kPneg_ * (pv1_ - pv);
-        i_share_ = kI_ * ((float)(ts_)/1000.0f) * e;
-        d_share_ = (kD_ * (2*pv1_ - pv - pv2_)) / ((float)(ts_)/1000.0f);
-        
-        u_ = u1_ + p_share_ + i_share_ + d_share_;
-        // keep calculated u_ value separate from modifications for data-logging
-        u_limited = u_;
+        {
+          // PID type C
+          u_ = q16_to_float(kernel_.step(q16_from_float(target_), q16_from_float(pv)));
+          p_share_ = q16_to_float(kernel_.getPShare());
+          i_share_ = q16_to_float(kernel_.getIShare());
+          d_share_ = q16_to_float(kernel_.getDShare());
+
+          // keep calculated u_ value separate from modifications for data-logging
+          u_limited = u_;
      
-        // modifications/overrides to default PID
+          // modifications/overrides to default PID
 
-        // faster heat-up, if far too cold
-        if (e > PID_OVERRIDE_TEMP_ERR)
-          u_limited = PID_OVERRIDE_TEMP;
+          // faster heat-up, if far too cold
+          if (e > PID_OVERRIDE_TEMP_ERR)
+            u_limited = PID_OVERRIDE_TEMP;
 
-        if (water_control_->pump_->getPWM() == PWM_0_PERCENT)
-        {
-          // limit heater, if pump is off and we are hotter than SP
-          if (u_limited > 5 && pv >= target_ + 0.5)
-            u_limited = 5;
+          if (water_control_->pump_->getPWM() == PWM_0_PERCENT)
+          {
+            // limit heater, if pump is off and we are hotter than SP
+            if (u_limited > 5 && pv >= target_ + 0.5)
+              u_limited = 5;
+          }
+
+          // limits of the regime
+          getRegimeGains(regime_, gains);
+          if (u_limited < gains.out_min)
+            u_limited = gains.out_min;
+          else if (u_limited > gains.out_max)
+            u_limited = gains.out_max;
         }
 
+        u_limited += ff_share_;
+
         // apply override value if activated
         if (u_override_ >= 0.0f && u_override_cnt_ > 0)
         {
@@ -170,21 +511,30 @@ void PIDHeater::task()
         else if (u_limited > 100)
           u_limited = 100;
 
+        if (algorithm_ == PID_ALGO_MPC)
+          mpc_->setApplied(u_limited);
+
         // check again, if we got interrupted (not perfect, but better)
         if (enabled_)
         {
-          uint32_t set_value = lroundf(u_limited);
+          uint32_t set_value = lroundf(u_limited * 10);  // permille
           // if the PID output is positive, apply a minimum value
           // otherwise heater is too slow to react and system is instable
           if (set_value == 0)
-            heater_->setPWM(0);
-          else if (set_value <= PID_MIN_OUTPUT)
-            heater_->setPWM(PID_MIN_OUTPUT);  // minimum heater output
+            heater_->setDuty(0);
+          else if (set_value <= PID_MIN_OUTPUT * 10 && algorithm_ == PID_ALGO_PID)
+            heater_->setDuty(PID_MIN_OUTPUT * 10);  // minimum heater output
           else
-            heater_->setPWM(set_value);
+            heater_->setDuty(set_value);
         }
         else
           heater_->setPWM(0);
+
+        // sensor-to-actuator latency
+        sample_age_us_ = (uint32_t)esp_timer_get_time() - sample_us;
+        if (sample_age_us_ > sample_age_max_us_)
+          sample_age_max_us_ = sample_age_us_;
+        steps_++;
     
         // thermostat simulation
         // if (pv < target_temp)
@@ -193,19 +543,19 @@ void PIDHeater::task()
         //   heater_->setPWM(0);
     
         // save old values
-        pv2_ = pv1_;
-        pv1_ = pv;
-        u1_ = u_limited;
+        kernel_.commit(q16_from_float(pv), q16_from_float(u_limited - ff_share_));
       }  // end of pid_enabled
       else
       {
         p_share_ = 0;
         i_share_ = 0;
         d_share_ = 0;
+        ff_share_ = 0;
         u_ = 0;
       }
-                       
-      WebInterface::updateInfluxDB();
+
+      publishSnapshot();
+      WebInterface::sampleTelemetry();
 
       // Serial.println(String(systime_ms()) + " , " + 
       //                 String(target_) + " , " + 
@@ -218,6 +568,58 @@ void PIDHeater::task()
       //                 String(p_share_) + " , " + 
       //                 String(i_share_) + " , " + 
       //                 String(d_share_) );
-    }  // end of sem take
+    }  // end of step
   }  // end of while(1)
 }
+
+float PIDHeater::getPumpForecast()
+{
+  // a running shot knows where its pump ramp is heading
+  if (water_control_->getState() == WATERCTRL_SHOT)
+    return water_control_->shot_->getPumpForecast();
+
+  return water_control_->pump_->getPWM();
+}
+
+float PIDHeater::getFFGain()
+{
+  // a shot profile may override the gain per segment
+  if (water_control_->getState() == WATERCTRL_SHOT)
+  {
+    float gain = water_control_->shot_->getFFGain();
+    if (gain >= 0.0f)
+      return gain;
+  }
+
+  return ff_gain_;
+}
+
+void PIDHeater::publishSnapshot()
+{
+  SystemSnapshot_t snapshot;
+
+  // water control is still being set up
+  if (WaterControl::getInstance() == nullptr)
+    return;
+
+  snapshot.temp_top = SensorsHandler::getTempBoilerTop();
+  snapshot.temp_side = SensorsHandler::getTempBoilerSide();
+  snapshot.temp_avg = (snapshot.temp_top + snapshot.temp_side) / 2;
+  snapshot.temp_brewhead = SensorsHandler::getTempBrewhead();
+  snapshot.temp_water = observer_->getWaterTemp();
+  snapshot.target = target_;
+  snapshot.p_share = p_share_;
+  snapshot.i_share = i_share_;
+  snapshot.d_share = d_share_;
+  snapshot.ff_share = ff_share_;
+  snapshot.sample_age_us = sample_age_us_;
+  snapshot.regime = regime_;
+  snapshot.u = u_;
+  snapshot.heater_percent = heater_->getPWM();
+  snapshot.pump_percent = water_control_->pump_->getPWM();
+  snapshot.water_state = water_control_->getState();
+  snapshot.shot_time_ms = water_control_->getShotTime();
+  snapshot.power = HWInterface::getInstance() ? HWInterface::getInstance()->isActive() : false;
+
+  SystemState::publish(snapshot);
+}
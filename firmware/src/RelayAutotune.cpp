@@ -0,0 +1,185 @@
+#include "RelayAutotune.hpp"
+#include <math.h>
+#include <string.h>
+
+RelayAutotune::RelayAutotune() :
+  state_(AUTOTUNE_IDLE),
+  abort_reason_(AUTOTUNE_ABORT_NONE),
+  relay_high_(false),
+  start_ms_(0),
+  switch_ms_(0),
+  rise_ms_(0),
+  rise_valid_(false),
+  peak_ms_(0),
+  peak_(0.0f),
+  cycles_(0)
+{
+  memset(&config_, 0, sizeof(config_));
+  memset(&result_, 0, sizeof(result_));
+}
+
+bool RelayAutotune::start(const AutotuneConfig_t &config, uint32_t time_ms)
+{
+  // a NaN setpoint would never trip the overtemperature abort
+  if (!(isfinite(config.setpoint) && isfinite(config.output_high) && isfinite(config.output_low) &&
+        isfinite(config.hysteresis) && isfinite(config.max_overshoot) && isfinite(config.min_temp)))
+    return false;
+
+  config_ = config;
+  memset(&result_, 0, sizeof(result_));
+  abort_reason_ = AUTOTUNE_ABORT_NONE;
+
+  start_ms_ = time_ms;
+  switch_ms_ = time_ms;
+  rise_ms_ = time_ms;
+  rise_valid_ = false;
+  peak_ms_ = time_ms;
+  relay_high_ = true;
+  peak_ = 0.0f;
+  cycles_ = 0;
+
+  sum_period_ = 0.0f;
+  sum_max_ = 0.0f;
+  sum_min_ = 0.0f;
+  sum_turn_ = 0.0f;
+  count_max_ = 0;
+  count_min_ = 0;
+  count_turn_ = 0;
+
+  state_ = AUTOTUNE_HEATUP;
+  return true;
+}
+
+void RelayAutotune::stop()
+{
+  if (isRunning())
+    abort(AUTOTUNE_ABORT_USER);
+}
+
+float RelayAutotune::update(uint32_t time_ms, float pv)
+{
+  if (!isRunning())
+    return 0.0f;
+
+  // safety first
+  if (!(pv >= config_.min_temp && pv < 150.0f))
+    abort(AUTOTUNE_ABORT_SENSOR);
+  else if (pv > config_.setpoint + config_.max_overshoot)
+    abort(AUTOTUNE_ABORT_OVERTEMP);
+  else if (time_ms - start_ms_ > config_.timeout_ms)
+    abort(AUTOTUNE_ABORT_TIMEOUT);
+  else if (state_ == AUTOTUNE_RELAY && time_ms - switch_ms_ > config_.half_cycle_ms)
+    abort(AUTOTUNE_ABORT_NO_SWITCH);
+
+  if (!isRunning())
+    return 0.0f;
+
+  if (state_ == AUTOTUNE_HEATUP)
+  {
+    if (pv >= config_.setpoint + config_.hysteresis)
+    {
+      state_ = AUTOTUNE_RELAY;
+      switchRelay(time_ms, false);
+    }
+    return relay_high_ ? config_.output_high : config_.output_low;
+  }
+
+  // extreme value of this half cycle - a maximum while low, a minimum while high
+  if ((!relay_high_ && pv > peak_) || (relay_high_ && pv < peak_))
+  {
+    peak_ = pv;
+    peak_ms_ = time_ms;
+  }
+
+  if (!relay_high_ && pv <= config_.setpoint - config_.hysteresis)
+    switchRelay(time_ms, true);
+  else if (relay_high_ && pv >= config_.setpoint + config_.hysteresis)
+    switchRelay(time_ms, false);
+
+  if (state_ == AUTOTUNE_DONE)
+    return 0.0f;
+  return relay_high_ ? config_.output_high : config_.output_low;
+}
+
+void RelayAutotune::switchRelay(uint32_t time_ms, bool high)
+{
+  // the first cycle is dropped, it starts from the heat-up and is not settled yet
+  bool settled = cycles_ >= 1;
+
+  if (settled)
+  {
+    // half cycle done: extreme and how long the temperature kept going the old way
+    if (relay_high_)
+    {
+      sum_min_ += peak_;
+      count_min_++;
+    }
+    else
+    {
+      sum_max_ += peak_;
+      count_max_++;
+    }
+    sum_turn_ += (peak_ms_ - switch_ms_) / 1000.0f;
+    count_turn_++;
+  }
+
+  if (high)
+  {
+    // a full cycle goes from switch-on to switch-on
+    if (rise_valid_)
+    {
+      if (settled)
+        sum_period_ += (time_ms - rise_ms_) / 1000.0f;
+      cycles_++;
+    }
+    rise_ms_ = time_ms;
+    rise_valid_ = true;
+  }
+
+  relay_high_ = high;
+  switch_ms_ = time_ms;
+  peak_ms_ = time_ms;
+  peak_ = high ? 999.0f : 0.0f;
+
+  if (cycles_ > config_.cycles && count_max_ > 0 && count_min_ > 0)
+    finish();
+}
+
+void RelayAutotune::finish()
+{
+  float amplitude = (sum_max_ / count_max_ - sum_min_ / count_min_) / 2;
+  float d = (config_.output_high - config_.output_low) / 2;
+
+  // describing function of a relay with hysteresis
+  if (amplitude <= config_.hysteresis)
+  {
+    abort(AUTOTUNE_ABORT_NO_SWITCH);
+    return;
+  }
+
+  result_.amplitude = amplitude;
+  result_.ku = 4 * d / ((float)M_PI * sqrtf(amplitude * amplitude - config_.hysteresis * config_.hysteresis));
+  result_.pu = sum_period_ / (cycles_ - 1);
+  result_.turn_time = sum_turn_ / count_turn_;
+
+  // Ziegler-Nichols, in PIDHeater form: i = Kp / Ti, d = Kp * Td
+  result_.classic.p = 0.6f * result_.ku;
+  result_.classic.i = result_.classic.p / (result_.pu / 2);
+  result_.classic.d = result_.classic.p * result_.pu / 8;
+
+  result_.no_overshoot.p = 0.2f * result_.ku;
+  result_.no_overshoot.i = result_.no_overshoot.p / (result_.pu / 2);
+  result_.no_overshoot.d = result_.no_overshoot.p * result_.pu / 3;
+
+  result_.pi.p = 0.45f * result_.ku;
+  result_.pi.i = result_.pi.p / (result_.pu / 1.2f);
+  result_.pi.d = 0.0f;
+
+  state_ = AUTOTUNE_DONE;
+}
+
+void RelayAutotune::abort(AUTOTUNE_Abort_t reason)
+{
+  abort_reason_ = reason;
+  state_ = AUTOTUNE_ABORTED;
+}
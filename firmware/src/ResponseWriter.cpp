@@ -0,0 +1,203 @@
+#include "ResponseWriter.hpp"
+#include <string.h>
+#include <math.h>
+
+ResponseWriter::ResponseWriter(char *buffer, size_t size) :
+  buffer_(buffer),
+  size_(size),
+  length_(0),
+  overflow_(false)
+{
+  if (size_ > 0)
+    buffer_[0] = '\0';
+}
+
+void ResponseWriter::clear()
+{
+  length_ = 0;
+  overflow_ = false;
+  if (size_ > 0)
+    buffer_[0] = '\0';
+}
+
+void ResponseWriter::append(const char *text)
+{
+  append(text, strlen(text));
+}
+
+void ResponseWriter::append(const char *text, size_t length)
+{
+  // one byte stays for the terminator
+  if (length_ + length >= size_)
+  {
+    overflow_ = true;
+    length = (size_ > length_ + 1) ? size_ - length_ - 1 : 0;
+  }
+  memcpy(buffer_ + length_, text, length);
+  length_ += length;
+  if (size_ > 0)
+    buffer_[length_] = '\0';
+}
+
+void ResponseWriter::appendUInt(uint32_t value)
+{
+  char digits[10];
+  uint32_t n = sizeof(digits);
+
+  do
+  {
+    digits[--n] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+
+  append(digits + n, sizeof(digits) - n);
+}
+
+void ResponseWriter::appendInt(int32_t value)
+{
+  if (value < 0)
+  {
+    append("-", 1);
+    appendUInt(0u - (uint32_t)value);
+  }
+  else
+    appendUInt(value);
+}
+
+void ResponseWriter::appendFloat(float value, uint32_t decimals)
+{
+  static const uint32_t scales[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+  if (isnan(value))
+  {
+    append("nan", 3);
+    return;
+  }
+  if (decimals > 6)
+    decimals = 6;
+  if (value < 0)
+  {
+    append("-", 1);
+    value = -value;
+  }
+  // beyond 32bit integer part (or inf) - not used for readings
+  if (!(value < 4294967040.0f))
+  {
+    append("ovf", 3);
+    return;
+  }
+
+  // integer part first - the fraction alone is exact in float
+  uint32_t scale = scales[decimals];
+  uint32_t integer = (uint32_t)value;
+  uint32_t fraction = (uint32_t)((value - integer) * scale + 0.5f);
+  if (fraction >= scale)
+  {
+    integer++;
+    fraction -= scale;
+  }
+  appendUInt(integer);
+  if (decimals == 0)
+    return;
+
+  char digits[7];
+  digits[0] = '.';
+  for (uint32_t n = decimals; n > 0; n--)
+  {
+    digits[n] = '0' + fraction % 10;
+    fraction /= 10;
+  }
+  append(digits, decimals + 1);
+}
+
+ResponsePool::ResponsePool(char *buffers, size_t size, uint32_t count) :
+  buffers_(buffers),
+  size_(size),
+  count_(count < COUNT_MAX ? count : COUNT_MAX),
+  used_(0)
+{
+}
+
+char *ResponsePool::acquire()
+{
+  for (uint32_t n = 0; n < count_; n++)
+  {
+    if (used_ & (1u << n))
+      continue;
+    used_ |= 1u << n;
+    return buffers_ + n * size_;
+  }
+  return nullptr;
+}
+
+void ResponsePool::release(char *buffer)
+{
+  if (buffer < buffers_ || size_ == 0)
+    return;
+  uint32_t n = (buffer - buffers_) / size_;
+  if (n < count_)
+    used_ &= ~(1u << n);
+}
+
+uint32_t ResponsePool::getUsed() const
+{
+  uint32_t used = 0;
+  for (uint32_t n = 0; n < count_; n++)
+    used += (used_ >> n) & 1u;
+  return used;
+}
+
+ResponseTemplate::ResponseTemplate(const char *text, const char *const *fields, uint32_t field_count) :
+  text_(text),
+  part_count_(0),
+  valid_(true)
+{
+  const char *p = text;
+  const char *literal = text;
+
+  while (valid_)
+  {
+    const char *start = strchr(p, '%');
+    const char *end = start ? strchr(start + 1, '%') : nullptr;
+    if (end == nullptr)
+      break;
+
+    // which field
+    int32_t field = -1;
+    for (uint32_t n = 0; n < field_count; n++)
+      if (strlen(fields[n]) == (size_t)(end - start - 1) && strncmp(fields[n], start + 1, end - start - 1) == 0)
+        field = n;
+    if (field < 0 || part_count_ + 2 > PARTS_MAX)
+    {
+      valid_ = false;
+      break;
+    }
+
+    if (start > literal)
+      parts_[part_count_++] = {(uint16_t)(literal - text), (uint16_t)(start - literal), -1};
+    parts_[part_count_++] = {0, 0, (int16_t)field};
+    literal = end + 1;
+    p = end + 1;
+  }
+
+  size_t rest = strlen(literal);
+  if (valid_ && rest > 0)
+  {
+    if (part_count_ < PARTS_MAX)
+      parts_[part_count_++] = {(uint16_t)(literal - text), (uint16_t)rest, -1};
+    else
+      valid_ = false;
+  }
+}
+
+void ResponseTemplate::render(ResponseWriter &writer, Filler filler, const void *arg) const
+{
+  for (uint32_t n = 0; n < part_count_; n++)
+  {
+    const Part_t &part = parts_[n];
+    if (part.field < 0)
+      writer.append(text_ + part.offset, part.length);
+    else
+      filler(part.field, writer, arg);
+  }
+}
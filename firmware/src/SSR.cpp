@@ -2,7 +2,8 @@
 
 SSR::SSR(uint8_t ctrl_pin) :
   enabled_(false),
-  ctrl_pin_(ctrl_pin)
+  ctrl_pin_(ctrl_pin),
+  state_(false)
 {
   disable();
 }
@@ -10,15 +11,17 @@ SSR::SSR(uint8_t ctrl_pin) :
 void SSR::enable()
 {
   off();
+  digitalWrite(ctrl_pin_, LOW);
   pinMode(ctrl_pin_, OUTPUT);
   enabled_ = true;
 }
 
 void SSR::disable()
 {
+  enabled_ = false;
   off();
+  digitalWrite(ctrl_pin_, LOW);
   pinMode(ctrl_pin_, INPUT);
-  enabled_ = false;
 }
 
 bool IRAM_ATTR SSR::isEnabled()
@@ -29,10 +32,15 @@ bool IRAM_ATTR SSR::isEnabled()
 void IRAM_ATTR SSR::on()
 {
   if (enabled_)
-    digitalWrite(ctrl_pin_, HIGH);
+    state_ = true;
 }
 
 void IRAM_ATTR SSR::off()
 {
-  digitalWrite(ctrl_pin_, LOW);
-}
\ No newline at end of file
+  state_ = false;
+}
+
+bool IRAM_ATTR SSR::isOn()
+{
+  return state_ && enabled_;
+}
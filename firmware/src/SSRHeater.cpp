@@ -1,12 +1,8 @@
 #include "SSRHeater.hpp"
 
-static void timer_callback(void);
-
 static SSRHeater *instance = nullptr;
 
-SSRHeater::SSRHeater(uint8_t ctrl_pin, int32_t timer_id, uint32_t timer_period_us) : SSR(ctrl_pin),
-  timer_pwm_(nullptr),
-  pwm_percent_(0)
+SSRHeater::SSRHeater(uint8_t ctrl_pin) : SSR(ctrl_pin)
 {
   if (instance)
   {
@@ -15,11 +11,6 @@ SSRHeater::SSRHeater(uint8_t ctrl_pin, int32_t timer_id, uint32_t timer_period_u
     return;
   }
 
-  timer_pwm_ = timerBegin(timer_id, 80, true);
-  timerAttachInterrupt(timer_pwm_, &timer_callback, true);
-  timerAlarmWrite(timer_pwm_, timer_period_us, true);
-  timerAlarmEnable(timer_pwm_);
-
   instance = this;
 }
 
@@ -30,49 +21,46 @@ SSRHeater* SSRHeater::getInstance()
 
 void SSRHeater::sync()
 {
-  if (timer_pwm_)
-    timerRestart(timer_pwm_);
+  modulator_.reset();
 }
 
 void SSRHeater::setPWM(uint8_t percent)
 {
-  if (!enabled_ || timer_pwm_ == nullptr)
-    return;
-  
   if (percent > 100)
   {
     percent = 0;
     Serial.println("SSRHeater: percent > 100!");
   }
-  
-  pwm_percent_ = percent;
+
+  setDuty(percent * 10);
 }
 
-uint8_t IRAM_ATTR SSRHeater::getPWM()
+uint8_t SSRHeater::getPWM()
 {
-  return pwm_percent_;
+  return (modulator_.getDuty() + 5) / 10;
 }
 
-static void IRAM_ATTR timer_callback(void)
+void SSRHeater::setDuty(uint32_t permille)
 {
-  static uint32_t pwm_period_counter_ = 0;  // 0 to 99 elapsed periods
-
-  if (instance == nullptr)
+  if (!enabled_)
     return;
-  
-  if (!instance->isEnabled())
+
+  if (permille > SigmaDelta::SCALE)
   {
-    pwm_period_counter_ = 0;
-    instance->off();
-    return;
+    permille = 0;
+    Serial.println("SSRHeater: permille > 1000!");
   }
 
-  // called every 10ms == halve sine period
-  if (instance->getPWM() > pwm_period_counter_)
-    instance->on();
-  else
-    instance->off();
-  
-  if (++pwm_period_counter_ >= 100)
-    pwm_period_counter_ = 0;
+  // takes effect with the next half-cycle
+  modulator_.setDuty(permille);
+}
+
+uint32_t SSRHeater::getDuty()
+{
+  return modulator_.getDuty();
+}
+
+bool IRAM_ATTR SSRHeater::nextHalfCycle()
+{
+  return modulator_.step();
 }
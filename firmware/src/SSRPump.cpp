@@ -1,14 +1,18 @@
 #include "SSRPump.hpp"
 #include "helpers.hpp"
+#include "coffee_config.hpp"
+#include "PumpPatterns.hpp"
 
-static void timer_callback(void);
+// in internal RAM - the ISR must not depend on the flash cache
+static const PumpPatterns DRAM_ATTR patterns;
 
 static SSRPump *instance = nullptr;
 
-SSRPump::SSRPump(uint8_t ctrl_pin, int32_t timer_id, uint32_t timer_period_us) : SSR(ctrl_pin),
-  timer_pwm_(nullptr),
+SSRPump::SSRPump(uint8_t ctrl_pin) : SSR(ctrl_pin),
   pwm_percent_(PWM_0_PERCENT),
-  time_on_(0)
+  ramp_ms_(0),
+  applied_(0),
+  pattern_pos_(0)
 {
   if (instance)
   {
@@ -17,10 +21,7 @@ SSRPump::SSRPump(uint8_t ctrl_pin, int32_t timer_id, uint32_t timer_period_us) :
     return;
   }
 
-  timer_pwm_ = timerBegin(timer_id, 80, true);
-  timerAttachInterrupt(timer_pwm_, &timer_callback, true);
-  timerAlarmWrite(timer_pwm_, timer_period_us, true);
-  timerAlarmEnable(timer_pwm_);
+  setSoftStart(PUMP_SOFTSTART_MS);
 
   instance = this;
 }
@@ -32,156 +33,75 @@ SSRPump* SSRPump::getInstance()
 
 void SSRPump::setPWM(uint8_t percent)
 {
-  if (!enabled_ || timer_pwm_ == nullptr)
+  if (!enabled_)
     return;
   
-  if (percent < 5)
+  if (percent > 100)
   {
-    if (pwm_percent_ != PWM_0_PERCENT && systime_ms() - time_on_ > 3000)
-    {
-      // if (SHOT_getState() != SHOT_PAUSE)
-      //   PID_override(0.0f, PID_OVERRIDE_CNT);
-    }
+    Serial.print("SSRPump: pump pwm percent not valid! ");
+    Serial.println(percent);
     pwm_percent_ = PWM_0_PERCENT;
+    return;
   }
+
+  if (percent < 5)
+    pwm_percent_ = PWM_0_PERCENT;
   else
-  {
-    if (pwm_percent_ == PWM_0_PERCENT)
-      time_on_ = systime_ms();
-      
-    if (percent < 15)
-      pwm_percent_ = PWM_10_PERCENT;
-    else if (percent < 25)
-      pwm_percent_ = PWM_20_PERCENT;
-    else if (percent < 35)
-      pwm_percent_ = PWM_30_PERCENT;
-    else if (percent < 45)
-      pwm_percent_ = PWM_40_PERCENT;
-    else if (percent < 55)
-      pwm_percent_ = PWM_50_PERCENT;
-    else if (percent < 65)
-      pwm_percent_ = PWM_60_PERCENT;
-    else if (percent < 75)
-      pwm_percent_ = PWM_70_PERCENT;
-    else if (percent < 85)
-      pwm_percent_ = PWM_80_PERCENT;
-    else if (percent < 95)
-      pwm_percent_ = PWM_90_PERCENT;
-    else if (percent <= 100)
-      pwm_percent_ = PWM_100_PERCENT;
-    else
-    {
-      Serial.print("SSRPump: pump pwm percent not valid! ");
-      Serial.println(percent);
-      pwm_percent_ = PWM_0_PERCENT;
-      return;
-    }
-  }
+    pwm_percent_ = percent;
 }
 
-PWM_Percent_t IRAM_ATTR SSRPump::getPWM()
+uint8_t IRAM_ATTR SSRPump::getPWM()
 {
   return pwm_percent_;
 }
 
-static void IRAM_ATTR timer_callback(void)
+void SSRPump::setSoftStart(uint32_t ramp_ms)
 {
-  static uint32_t pwm_period_counter_ = 0;  // elapsed periods
-  
-  if (instance == nullptr)
-    return;
-  
-  if (!instance->isEnabled())
+  ramp_ms_ = ramp_ms;
+}
+
+// period_us is the sine period the scheduler runs at - 50 or 60 Hz as locked
+uint32_t IRAM_ATTR SSRPump::nextDuty(uint32_t period_us)
+{
+  uint32_t target = pwm_percent_ * 1000;
+  uint32_t ramp_ms = ramp_ms_;
+  uint32_t ramp_step;  // 1/1000 % per period
+
+  if (!enabled_)
   {
-    pwm_period_counter_ = 0;
-    instance->off();
-    return;
+    applied_ = 0;
+    return 0;
   }
 
-  // called every 20ms == full sine period
-  switch (instance->getPWM())
+  // ramps shorter than a period jump to the target
+  if (ramp_ms * 1000 < period_us)
+    ramp_step = 100 * 1000;
+  else
+    ramp_step = 100 * period_us / ramp_ms;
+
+  // only increases are ramped, the pump stops at once
+  if (applied_ + ramp_step < target)
+    applied_ += ramp_step;
+  else
+    applied_ = target;
+
+  return applied_ / 1000;
+}
+
+bool IRAM_ATTR SSRPump::nextPeriod(uint32_t period_us)
+{
+  uint32_t duty = nextDuty(period_us);
+  bool on;
+
+  if (duty == 0)
   {
-    case PWM_0_PERCENT:
-      instance->off();
-      pwm_period_counter_ = 0;
-      break;
-    case PWM_10_PERCENT:
-      if (pwm_period_counter_ == 0)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 10)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_20_PERCENT:
-      if (pwm_period_counter_ == 0)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 5)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_30_PERCENT:
-      if (pwm_period_counter_ == 0)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 3)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_40_PERCENT:
-      if (pwm_period_counter_ == 0 || pwm_period_counter_ == 2)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 5)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_50_PERCENT:
-      if (pwm_period_counter_ == 0)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 2)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_60_PERCENT:
-      if (pwm_period_counter_ == 0 || pwm_period_counter_ == 1 || pwm_period_counter_ == 3)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 5)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_70_PERCENT:
-      if (pwm_period_counter_ == 3 || pwm_period_counter_ == 6 || pwm_period_counter_ == 9)
-        instance->off();
-      else
-        instance->on();
-      if (++pwm_period_counter_ >= 10)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_80_PERCENT:
-      if (pwm_period_counter_ < 4)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 5)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_90_PERCENT:
-      if (pwm_period_counter_ < 9)
-        instance->on();
-      else
-        instance->off();
-      if (++pwm_period_counter_ >= 10)
-        pwm_period_counter_ = 0;
-      break;
-    case PWM_100_PERCENT:
-      instance->on();
-      pwm_period_counter_ = 0;
-      break;
-    default:
-      instance->off();
+    // next start begins with an on-period
+    pattern_pos_ = 0;
+    return false;
   }
+
+  on = patterns.isOn(duty, pattern_pos_);
+  if (++pattern_pos_ >= PumpPatterns::STEPS)
+    pattern_pos_ = 0;
+  return on;
 }
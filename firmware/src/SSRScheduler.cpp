@@ -0,0 +1,214 @@
+#include "SSRScheduler.hpp"
+#include "SSR.hpp"
+#include "SSRHeater.hpp"
+#include "SSRPump.hpp"
+#include <soc/gpio_reg.h>
+
+static void timer_callback(void);
+
+static SSRScheduler *instance = nullptr;
+static portMUX_TYPE scheduler_mux = portMUX_INITIALIZER_UNLOCKED;
+
+SSRScheduler::SSRScheduler(int32_t timer_id, uint32_t half_period_us) :
+  timer_(nullptr),
+  heater_(nullptr),
+  pump_(nullptr),
+  valve_(nullptr),
+  pin_heater_(0),
+  pin_pump_(0),
+  pin_valve_(0),
+  half_period_us_(half_period_us),
+  mains_locked_(false),
+  half_cycles_(0),
+  heater_on_(0),
+  pump_on_(false),
+  last_tick_us_(0),
+  period_start_us_(0),
+  subscriber_(nullptr),
+  notify_(false),
+  skip_jitter_(true)
+{
+  if (instance)
+  {
+    Serial.println("ERROR: more than one SSRSchedulers generated");
+    ESP.restart();
+    return;
+  }
+
+  memset(&stats_, 0, sizeof(stats_));
+  instance = this;
+
+  timer_ = timerBegin(timer_id, 80, true);
+  timerAttachInterrupt(timer_, &timer_callback, true);
+  timerAlarmWrite(timer_, half_period_us, true);
+  timerAlarmEnable(timer_);
+}
+
+SSRScheduler* SSRScheduler::getInstance()
+{
+  return instance;
+}
+
+// outputs are registered once, the ISR must not call into flash
+void SSRScheduler::setHeater(SSRHeater *heater)
+{
+  pin_heater_ = heater->getPin();
+  heater_ = heater;
+}
+
+void SSRScheduler::setPump(SSRPump *pump)
+{
+  pin_pump_ = pump->getPin();
+  pump_ = pump;
+}
+
+void SSRScheduler::setValve(SSR *valve)
+{
+  pin_valve_ = valve->getPin();
+  valve_ = valve;
+}
+
+void IRAM_ATTR SSRScheduler::syncMains(int32_t since_us, uint32_t half_period_us)
+{
+  if (timer_ == nullptr)
+    return;
+
+  int32_t count = since_us % (int32_t)half_period_us;
+  if (count < 0)
+    count += half_period_us;
+
+  portENTER_CRITICAL_ISR(&scheduler_mux);
+  half_period_us_ = half_period_us;
+  mains_locked_ = true;
+  skip_jitter_ = true;
+  stats_.syncs++;
+  portEXIT_CRITICAL_ISR(&scheduler_mux);
+
+  timerAlarmWrite(timer_, half_period_us, true);
+  timerWrite(timer_, count);
+}
+
+void SSRScheduler::freeRun(uint32_t half_period_us)
+{
+  if (timer_ == nullptr)
+    return;
+
+  portENTER_CRITICAL(&scheduler_mux);
+  half_period_us_ = half_period_us;
+  mains_locked_ = false;
+  skip_jitter_ = true;
+  portEXIT_CRITICAL(&scheduler_mux);
+
+  timerAlarmWrite(timer_, half_period_us, true);
+}
+
+void SSRScheduler::getStats(SchedulerStats_t &stats)
+{
+  portENTER_CRITICAL(&scheduler_mux);
+  stats = stats_;
+  portEXIT_CRITICAL(&scheduler_mux);
+}
+
+void SSRScheduler::getPeriod(uint32_t &start_us, uint32_t &period_us)
+{
+  portENTER_CRITICAL(&scheduler_mux);
+  start_us = period_start_us_;
+  period_us = 2 * half_period_us_;
+  portEXIT_CRITICAL(&scheduler_mux);
+}
+
+void SSRScheduler::resetStats()
+{
+  portENTER_CRITICAL(&scheduler_mux);
+  memset(&stats_, 0, sizeof(stats_));
+  skip_jitter_ = true;
+  portEXIT_CRITICAL(&scheduler_mux);
+}
+
+// adds the pin to the set or clear mask of its bank
+static inline void IRAM_ATTR add_pin(uint32_t pin, bool on, uint32_t *set, uint32_t *clear)
+{
+  uint32_t bank = pin >> 5;
+  uint32_t mask = 1u << (pin & 31);
+
+  if (on)
+    set[bank] |= mask;
+  else
+    clear[bank] |= mask;
+}
+
+void IRAM_ATTR SSRScheduler::tick()
+{
+  uint32_t cycles_start = ESP.getCycleCount();
+  uint32_t now = (uint32_t)esp_timer_get_time();
+  uint32_t set[2] = {0, 0};
+  uint32_t clear[2] = {0, 0};
+  bool period_start = (half_cycles_ & 1) == 0;
+
+  // heater: every half-cycle
+  if (heater_)
+  {
+    bool heater_on = heater_->nextHalfCycle() && heater_->isEnabled();
+    add_pin(pin_heater_, heater_on, set, clear);
+    if (heater_on)
+      heater_on_++;
+  }
+
+  // pump: once per full sine period
+  if (pump_)
+  {
+    if (period_start)
+      pump_on_ = pump_->nextPeriod(2 * half_period_us_) && pump_->isEnabled();
+    add_pin(pin_pump_, pump_on_ && pump_->isEnabled(), set, clear);
+  }
+
+  if (valve_)
+    add_pin(pin_valve_, valve_->isOn(), set, clear);
+
+  // disabled SSRs are inputs - writing their output register does no harm
+  if (set[0])
+    REG_WRITE(GPIO_OUT_W1TS_REG, set[0]);
+  if (clear[0])
+    REG_WRITE(GPIO_OUT_W1TC_REG, clear[0]);
+  if (set[1])
+    REG_WRITE(GPIO_OUT1_W1TS_REG, set[1]);
+  if (clear[1])
+    REG_WRITE(GPIO_OUT1_W1TC_REG, clear[1]);
+
+  half_cycles_++;
+
+  portENTER_CRITICAL_ISR(&scheduler_mux);
+  if (!skip_jitter_)
+  {
+    int32_t jitter = (int32_t)(now - last_tick_us_) - (int32_t)half_period_us_;
+    if (jitter < 0)
+      jitter = -jitter;
+    if ((uint32_t)jitter > stats_.jitter_max_us)
+      stats_.jitter_max_us = jitter;
+  }
+  skip_jitter_ = false;
+  last_tick_us_ = now;
+  if (period_start)
+    period_start_us_ = now;
+
+  uint32_t cycles = ESP.getCycleCount() - cycles_start;
+  stats_.ticks++;
+  stats_.cycles_sum += cycles;
+  if (cycles > stats_.cycles_max)
+    stats_.cycles_max = cycles;
+  portEXIT_CRITICAL_ISR(&scheduler_mux);
+
+  if (period_start && subscriber_ && notify_)
+  {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(subscriber_, &woken);
+    if (woken)
+      portYIELD_FROM_ISR();
+  }
+}
+
+static void IRAM_ATTR timer_callback(void)
+{
+  if (instance)
+    instance->tick();
+}
@@ -3,22 +3,86 @@
 #include "Timers.hpp"
 #include "TaskConfig.hpp"
 #include "coffee_config.hpp"
+#include "SSRHeater.hpp"
+#include "SSRPump.hpp"
+#include "HWInterface.hpp"
+#include "WaterControl.hpp"
+#include "PIDHeater.hpp"
+#include "History.hpp"
+#include "helpers.hpp"
 
 // static void timer_callback(void);
 
 static SensorsHandler *instance = nullptr;
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// mV -> deg-C curves of the probes - all probes share the same fit for now
+static constexpr NTCCurve_t ntc_curve_boiler = {13.582, 0.00433, 2230.8, 30.0};
+static constexpr NTCCurve_t ntc_curve_brewhead = ntc_curve_boiler;
+
+static constexpr NTCTable ntc_table_top(ntc_curve_boiler);
+static constexpr NTCTable ntc_table_side(ntc_curve_boiler);
+static constexpr NTCTable ntc_table_brewhead(ntc_curve_brewhead);
+
+static_assert(ntc_table_top.maxError(ntc_curve_boiler) < 0.005, "NTC table top: interpolation error too large");
+static_assert(ntc_table_side.maxError(ntc_curve_boiler) < 0.005, "NTC table side: interpolation error too large");
+static_assert(ntc_table_brewhead.maxError(ntc_curve_brewhead) < 0.005, "NTC table brewhead: interpolation error too large");
+
+// order of the channels in a burst
+enum {
+  CH_TOP = 0,
+  CH_SIDE,
+  CH_BREWHEAD,
+};
+static constexpr uint32_t burst_channels[3] = {Pins::sensor_top, Pins::sensor_side, Pins::sensor_brewhead};
+
+// ESP32 ADC1 with eFuse/default calibration
+class ESP32ADCSource : public ADCSource
+{
+public:
+  ESP32ADCSource(esp_adc_cal_characteristics_t *adc_chars) : adc_chars_(adc_chars) {}
+
+  int32_t readRaw(uint32_t channel) override
+  {
+    return adc1_get_raw((adc1_channel_t)channel);
+  }
+
+  // the calibration only takes integer counts - interpolate to keep the
+  // additional resolution of the oversampled average
+  float rawToMillivolts(float raw) override
+  {
+    uint32_t raw_int = (uint32_t)raw;
+    float frac = raw - raw_int;
+    uint32_t mv_low = esp_adc_cal_raw_to_voltage(raw_int, adc_chars_);
+    if (frac == 0.0f)
+      return mv_low;
+    uint32_t mv_high = esp_adc_cal_raw_to_voltage(raw_int + 1, adc_chars_);
+    return mv_low + frac * ((float)mv_high - (float)mv_low);
+  }
+
+private:
+  esp_adc_cal_characteristics_t *adc_chars_;
+};
 
-Sensor::Sensor(adc1_channel_t adc_channel, esp_adc_cal_characteristics_t *adc_chars) :
+Sensor::Sensor(SensorFilter *filter, const NTCTable *ntc_table) :
   value_degc(888.0f),
-  adc_channel_(adc_channel),
-  adc_chars_(adc_chars),
-  avg_buffer_idx_(0)
+  filter_(filter),
+  ntc_table_(ntc_table),
+  filter_primed_(false),
+  filter_output_(0.0f),
+  filter_cycles_(0)
 {
 }
 
 SensorsHandler::SensorsHandler() :
+  adc_source_(nullptr),
+  adc_burst_(nullptr),
+  sample_time_us_(0),
+  burst_cycles_(0),
+  rate_(SENSORS_RATE_ACTIVE),
   sem_update_(nullptr),
   task_handle_(nullptr),
+  subscriber_(nullptr),
   timer_update_(nullptr)
 {
   if (instance)
@@ -65,9 +129,16 @@ SensorsHandler::SensorsHandler() :
   Serial.println("ADC bit_width " + String(adc_chars_.bit_width));
 
   // create sensors and configre ADC channels
-  sensor_top_ = new Sensor(Pins::sensor_top, &adc_chars_);
-  sensor_side_ = new Sensor(Pins::sensor_side, &adc_chars_);
-  sensor_brewhead_ = new Sensor(Pins::sensor_brewhead, &adc_chars_);
+  adc_source_ = new ESP32ADCSource(&adc_chars_);
+  adc_burst_ = new ADCBurst<3>(adc_source_, burst_channels);
+
+  sensor_top_ = new Sensor(new SensorFilterLowLatency(), &ntc_table_top);
+  sensor_side_ = new Sensor(new SensorFilterLowLatency(), &ntc_table_side);
+  sensor_brewhead_ = new Sensor(new SensorFilterLowLatency(), &ntc_table_brewhead);
+
+  Serial.println("Sensor filter delay " + String(sensor_top_->getFilterDelay()) + " samples, ~" + String(sensor_top_->getFilterOps()) + " ops/sample");
+
+  memset(&stats_, 0, sizeof(stats_));
 
   // sync semaphore
   sem_update_ = xSemaphoreCreateBinary();
@@ -97,64 +168,178 @@ void SensorsHandler::task_wrapper(void *arg)
 }
 void SensorsHandler::task()
 {
-  // call update function rapidly to pre-fill filter-buffer
-  for (uint32_t i = 0; i < SENSORS_BUFFER_SIZE; i++)
-    update();
+  TickType_t last_wake = xTaskGetTickCount();
 
   while (1)
   {
+    SENSORS_Rate_t rate = selectRate();
+    if (rate != rate_)
+      changeRate(rate);
+
+    uint32_t cycles_start = ESP.getCycleCount();
     update();
-    vTaskDelay(pdMS_TO_TICKS(28));
+    uint32_t cycles = ESP.getCycleCount() - cycles_start;
+
+    // wake up the controller - also after a failed conversion, it has to see the invalid values
+    if (subscriber_ != nullptr)
+      xTaskNotifyGive(subscriber_);
+
+    portENTER_CRITICAL(&stats_mux);
+    stats_.time_ms[rate_] += getPeriodMs(rate_);
+    stats_.wakeups[rate_]++;
+    stats_.busy_cycles[rate_] += cycles;
+    portEXIT_CRITICAL(&stats_mux);
+
+    // fixed rate - independent of how long the burst took
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(getPeriodMs(rate_)));
   }
 }
 
-esp_err_t Sensor::update()
+SENSORS_Rate_t SensorsHandler::selectRate()
 {
-  uint32_t voltage;
+  HWInterface *hw = HWInterface::getInstance();
+  WaterControl *water_control = WaterControl::getInstance();
 
-  // get voltages as mV and insert into buffer
-  esp_err_t error = esp_adc_cal_get_voltage((adc_channel_t)adc_channel_, adc_chars_, &voltage);
-  avg_buffer_[avg_buffer_idx_] = voltage;
+  // full rate until everything is up
+  if (hw == nullptr || water_control == nullptr)
+    return SENSORS_RATE_ACTIVE;
 
-  // move (circular-)buffer index to next position
-  if (error == ESP_OK)
-    avg_buffer_idx_ = (avg_buffer_idx_ + 1) % SENSORS_BUFFER_SIZE;
-  else
+  if (!hw->isActive())
+    return SENSORS_RATE_OFF;
+
+  if (water_control->getState() != WATERCTRL_OFF)
+    return SENSORS_RATE_ACTIVE;
+
+  // warm-up
+  PIDHeater *pid = water_control->getBoilerPID();
+  if (pid && getTempBoilerAvg() < pid->getTarget() - SENSORS_WARMUP_MARGIN)
+    return SENSORS_RATE_ACTIVE;
+
+  return SENSORS_RATE_IDLE;
+}
+
+void SensorsHandler::changeRate(SENSORS_Rate_t rate)
+{
+  // the filters count samples, not time - drop the history taken at the old
+  // rate, but keep the current output so the readings do not jump
+  sensor_top_->rebase();
+  sensor_side_->rebase();
+  sensor_brewhead_->rebase();
+
+  rate_ = rate;
+
+  portENTER_CRITICAL(&stats_mux);
+  stats_.rate_changes++;
+  portEXIT_CRITICAL(&stats_mux);
+
+  Serial.println("Sensors: sample period " + String(getPeriodMs(rate)) + " ms");
+}
+
+uint32_t SensorsHandler::getPeriodMs(SENSORS_Rate_t rate)
+{
+  switch (rate)
+  {
+    case SENSORS_RATE_IDLE:
+      return SENSORS_PERIOD_IDLE_MS;
+    case SENSORS_RATE_OFF:
+      return SENSORS_PERIOD_OFF_MS;
+    case SENSORS_RATE_ACTIVE:
+    default:
+      return SENSORS_PERIOD_ACTIVE_MS;
+  }
+}
+
+void SensorsHandler::getStats(SensorsStats_t &stats)
+{
+  portENTER_CRITICAL(&stats_mux);
+  stats = stats_;
+  portEXIT_CRITICAL(&stats_mux);
+
+  uint32_t wakeups = 0;
+  uint32_t wakeups_full_rate = 0;
+  uint64_t cycles = 0;
+  for (uint32_t i = 0; i < SENSORS_RATE_COUNT; i++)
   {
-    value_degc = 999;
-    return error;
+    wakeups += stats.wakeups[i];
+    wakeups_full_rate += stats.time_ms[i] / SENSORS_PERIOD_ACTIVE_MS;
+    cycles += stats.busy_cycles[i];
   }
 
-  uint64_t sum = 0;
+  stats.wakeups_saved = (wakeups_full_rate > wakeups) ? wakeups_full_rate - wakeups : 0;
+  stats.cycles_saved = (wakeups > 0) ? cycles / wakeups * stats.wakeups_saved : 0;
+}
+
+void Sensor::update(float voltage)
+{
   float value;
 
-  // calculate average of buffer
-  for (uint32_t i = 0; i < SENSORS_BUFFER_SIZE; i++)
-    sum += avg_buffer_[i];
-  value = (float)sum / SENSORS_BUFFER_SIZE;
+  // pre-fill filter with the first sample, so it starts settled
+  if (!filter_primed_)
+  {
+    filter_->reset(voltage);
+    filter_primed_ = true;
+  }
+
+  uint32_t cycles_start = ESP.getCycleCount();
+  value = filter_->process(voltage);
+  filter_cycles_ = ESP.getCycleCount() - cycles_start;
+  filter_output_ = value;
 
   // convert mV to deg-C
-  value = (13.582 - sqrt(13.582 * 13.582 + 4 * 0.00433 * (2230.8 - value) ) ) / (2 * -0.00433) + 30;
+  value = ntc_table_->convert(value);
 
   if (value < 10 || value > 150)
     value = 999;
 
   value_degc = value;
-  
-  return error;
+}
+
+void Sensor::invalidate()
+{
+  value_degc = 999;
+}
+
+void Sensor::rebase()
+{
+  if (filter_primed_)
+    filter_->reset(filter_output_);
 }
 
 void SensorsHandler::update()
 {
-  esp_err_t error = ESP_OK;
+  float voltages[3];
 
-  error |= sensor_top_->update();
-  error |= sensor_side_->update();
-  error |= sensor_brewhead_->update();
+  // all three channels from the same burst
+  int64_t burst_start_us = esp_timer_get_time();
+  uint32_t cycles_start = ESP.getCycleCount();
+  bool ok = adc_burst_->acquire(OVERSAMPLING, voltages);
+  burst_cycles_ = ESP.getCycleCount() - cycles_start;
 
-  if (error != ESP_OK)
+  // center of the burst - a failed burst is a sample as well, with invalid values
+  sample_time_us_ = (uint32_t)((burst_start_us + esp_timer_get_time()) / 2);
+
+  if (!ok)
+  {
+    sensor_top_->invalidate();
+    sensor_side_->invalidate();
+    sensor_brewhead_->invalidate();
     Serial.println("ESP32-ADC failed!");
-  
+    return;
+  }
+
+  sensor_top_->update(voltages[CH_TOP]);
+  sensor_side_->update(voltages[CH_SIDE]);
+  sensor_brewhead_->update(voltages[CH_BREWHEAD]);
+
+  // keep every sample in the history
+  float record[HISTORY_CHANNELS];
+  record[HISTORY_TEMP_TOP] = sensor_top_->value_degc;
+  record[HISTORY_TEMP_SIDE] = sensor_side_->value_degc;
+  record[HISTORY_TEMP_BREWHEAD] = sensor_brewhead_->value_degc;
+  record[HISTORY_HEATER] = SSRHeater::getInstance() ? SSRHeater::getInstance()->getPWM() : 0;
+  record[HISTORY_PUMP] = SSRPump::getInstance() ? SSRPump::getInstance()->getPWM() : 0;
+  History::record(systime_ms(), record);
+
   // Serial.println("New Values: top=" + String(sensor_top_->value_degc) + " side=" + String(sensor_side_->value_degc) + " bh=" + String(sensor_brewhead_->value_degc));
 }
 
@@ -195,6 +380,14 @@ float SensorsHandler::getTempBoilerSide()
     return 999.0f;
 }
 
+uint32_t SensorsHandler::getSampleTimeUs()
+{
+  if (instance)
+    return instance->sample_time_us_;
+  else
+    return 0;
+}
+
 float SensorsHandler::getTempBrewhead()
 {
   if (instance)
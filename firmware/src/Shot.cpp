@@ -5,173 +5,234 @@
 #include "PIDHeater.hpp"
 #include "helpers.hpp"
 #include "TaskConfig.hpp"
+#include "SSRScheduler.hpp"
+#include <Preferences.h>
+
+// profiles, setpoint and timing are shared between the shot task and the web server
+static portMUX_TYPE shot_mux = portMUX_INITIALIZER_UNLOCKED;
+// pump and boiler target are written outside shot_mux - step() holds this while it
+// writes them, so stop() cannot come in between and be overwritten
+static SemaphoreHandle_t output_mutex = nullptr;
+
+// a missed pump period notification during a shot - the task runs on its own.
+// without a shot the scheduler does not notify and the task blocks
+static constexpr uint32_t tick_timeout_ms = 100;
 
 Shot::Shot(WaterControl *water_control) :
   water_control_(water_control),
-  time_init_fill_ms_(0),
-  time_ramp_ms_(0),
-  time_pause_ms_(0),
-  pump_start_percent_(0),
-  pump_stop_percent_(0),
-  current_ramp_percent_(0),
-  active_(false)
+  selected_(0),
+  event_count_(0),
+  start_us_(0),
+  stop_us_(0),
+  clock_ms_(0),
+  segment_(SHOT_SEGMENTS_MAX),
+  pump_(0),
+  active_(false),
+  aligned_(false)
 {
-  start_time_ = systime_ms();
-  stop_time_ = start_time_;
+  memset(&timing_, 0, sizeof(timing_));
+  memset(&setpoint_, 0, sizeof(setpoint_));
 
-  cmd_queue_ = xQueueCreate(cmd_queue_size_, cmd_queue_item_size_);
-
-  // crete timer for delayed execution of commands
-  timer_infos_.cmd = CMD_STOP;
-  timer_infos_.shot = this;
-  timer_ = xTimerCreate("tmr_shot", pdMS_TO_TICKS(1), pdFALSE, &timer_infos_, &Shot::timer_cb_wrapper);
+  loadProfiles();
+  profile_ = profiles_[selected_];
 
+  output_mutex = xSemaphoreCreateMutex();
   BaseType_t rval = xTaskCreate(&Shot::task_wrapper, "task_shot", TaskConfig::Shot_stacksize, this, TaskConfig::Shot_priority, &task_handle_);
 
-  if (timer_ == NULL || cmd_queue_ == NULL || rval != pdPASS )
+  if (rval != pdPASS || output_mutex == nullptr || SSRScheduler::getInstance() == nullptr)
   {
     Serial.println("Shot ERROR init failed");
     return; // error
   }
+  SSRScheduler::getInstance()->setSubscriber(task_handle_);
 }
+
 void Shot::task_wrapper(void *arg)
 {
   static_cast<Shot *>(arg)->task();
 }
 void Shot::task()
 {
-  uint32_t command;
-
   while (1)
   {
-    if (xQueueReceive(cmd_queue_, &command, portMAX_DELAY))
+    uint32_t period_start_us, period_us;
+    TickType_t timeout = active_ ? pdMS_TO_TICKS(tick_timeout_ms) : portMAX_DELAY;
+    bool notified = ulTaskNotifyTake(pdTRUE, timeout) > 0;
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    if (!active_)
+      continue;
+
+    if (notified)
     {
-      // start: enable valve
-      // ramp up pump from pump_percent_start to 100% in time_ramp seconds
-      //   increment_duration = time_ramp_ms / ((pump_stop_percent - pump_start_percent)/10)
-      //   
-      // continue with 100% until stop
-      switch (command)
-      {
-        case CMD_STOP:
-          stop_time_ = systime_ms();
-          break;
-
-        case CMD_START:
-          start_time_ = 0;
-          water_control_->valve_->on();
-          water_control_->pump_->setPWM(100);
-          current_ramp_percent_ = pump_start_percent_;
-          // 100% pump for time_init_fill_ms_
-          xTimerChangePeriod(timer_, pdMS_TO_TICKS(time_init_fill_ms_), portMAX_DELAY);
-          timer_infos_.cmd = CMD_RAMP;
-          break;
-
-        case CMD_RAMP:
-          if (!active_)
-            break;
-          // check if we are done with ramp
-          if (current_ramp_percent_ > pump_stop_percent_ || current_ramp_percent_ >= 100)
-          {
-            // ramp finished
-            uint32_t cmd = CMD_PAUSE;
-            xQueueSendToBack(cmd_queue_, &cmd, portMAX_DELAY);
-            break;
-          }
-          
-          // engage PID override in second stage of ramp, so it's not triggered by a short flip of the switch
-          if (current_ramp_percent_ > pump_start_percent_)
-            water_control_->pid_boiler_->overrideOutput(PID_OVERRIDE_STARTSHOT, PID_OVERRIDE_COUNT);
-            
-          water_control_->pump_->setPWM(current_ramp_percent_);
-          current_ramp_percent_ += 10;
-          
-          xTimerChangePeriod(timer_, pdMS_TO_TICKS(time_ramp_ms_ / ((pump_stop_percent_ - pump_start_percent_)/10)), portMAX_DELAY);
-          timer_infos_.cmd = CMD_RAMP;
-          break;
-
-        case CMD_PAUSE:
-          if (!active_)
-            break;
-          // pause or 100%
-          if (time_pause_ms_ > 0)
-          {
-            water_control_->pump_->setPWM(0);
-            xTimerChangePeriod(timer_, pdMS_TO_TICKS(time_pause_ms_), portMAX_DELAY);
-            timer_infos_.cmd = CMD_100PERCENT;
-          }
-          else
-          {
-            // go directly to 100%
-            uint32_t cmd = CMD_100PERCENT;
-            xQueueSendToBack(cmd_queue_, &cmd, portMAX_DELAY);
-          }
-          break;
-
-        case CMD_100PERCENT:
-          if (!active_)
-            break;
-          stop_time_ = 0;
-          start_time_ = systime_ms();
-          water_control_->pump_->setPWM(100);
-          break;
-        
-        default:
-          Serial.println("Shot ERROR command unkown");
-          break;
-      }
+      SSRScheduler::getInstance()->getPeriod(period_start_us, period_us);
     }
+    else
+    {
+      period_start_us = now;
+      period_us = 2 * SSRScheduler::getInstance()->getHalfPeriodUs();
+    }
+
+    portENTER_CRITICAL(&shot_mux);
+    if (notified)
+    {
+      uint32_t latency = now - period_start_us;
+      if (latency > timing_.latency_max_us)
+        timing_.latency_max_us = latency;
+      if (latency >= period_us)
+        timing_.late++;
+    }
+    else
+      timing_.timeouts++;
+    portEXIT_CRITICAL(&shot_mux);
+
+    // the duty written now is applied with the next pump period
+    step(period_start_us + period_us, period_us);
   }
 }
 
-void Shot::timer_cb_wrapper(TimerHandle_t arg)
+// evaluates the profile for the pump period starting at apply_us.
+// the setpoint is a function of the time since the start, so a late
+// notification does not shift the following segments.
+void Shot::step(uint32_t apply_us, uint32_t period_us)
 {
-  TimerInfos_t *timer_infos = static_cast<TimerInfos_t *>(pvTimerGetTimerID(arg));
-  timer_infos->shot->timer_cb(timer_infos->cmd);
+  ShotSetpoint_t setpoint;
+  bool pump_changed;
+  float temp = 0.0f;
+
+  xSemaphoreTake(output_mutex, portMAX_DELAY);
+  portENTER_CRITICAL(&shot_mux);
+  if (!active_)
+  {
+    portEXIT_CRITICAL(&shot_mux);
+    xSemaphoreGive(output_mutex);
+    return;
+  }
+
+  // the shot starts with a pump period - segments of whole periods start exactly on time
+  bool first = !aligned_;
+  if (first)
+  {
+    start_us_ = apply_us;
+    aligned_ = true;
+  }
+
+  uint32_t elapsed_us = apply_us - start_us_;
+  // the period closest to a boundary takes it - mains jitter must not slip a whole period
+  shot_profile_evaluate(profile_, (elapsed_us + period_us / 2) / 1000, setpoint);
+
+  pump_changed = setpoint.pump != pump_;
+  pump_ = setpoint.pump;
+  setpoint_ = setpoint;
+  if (first)
+    addEvent(SHOT_EVENT_START, 0, 0);
+
+  if (setpoint.segment != segment_)
+  {
+    segment_ = setpoint.segment;
+    if (segment_ < profile_.count)
+    {
+      int32_t error_us = elapsed_us - setpoint.segment_start_ms * 1000;
+      addEvent(SHOT_EVENT_SEGMENT, elapsed_us, error_us);
+      if ((uint32_t)abs(error_us) > timing_.error_max_us)
+        timing_.error_max_us = abs(error_us);
+      temp = profile_.segments[segment_].temp;
+    }
+    else
+      addEvent(SHOT_EVENT_DONE, elapsed_us, 0);
+  }
+  portEXIT_CRITICAL(&shot_mux);
+
+  // still before any stop() - it waits for output_mutex
+  if (pump_changed)
+    water_control_->pump_->setPWM(setpoint.pump);
+  if (temp > 0.0f)
+    water_control_->pid_boiler_->setTarget(temp, PID_MODE_WATER);
+  xSemaphoreGive(output_mutex);
 }
-void Shot::timer_cb(uint32_t cmd)
+
+// with shot_mux held
+void Shot::addEvent(SHOT_Event_t type, uint32_t time_us, int32_t error_us)
 {
-  if (xQueueSendToBack(cmd_queue_, &cmd, 0) != pdPASS )
-    Serial.println("Shot ERROR timed cb queue send");
+  if (event_count_ >= SHOT_EVENTS_MAX)
+    return;
+
+  ShotEvent_t &event = events_[event_count_++];
+  event.time_us = time_us;
+  event.error_us = error_us;
+  event.type = type;
+  event.segment = segment_ < SHOT_SEGMENTS_MAX ? segment_ : 0;
+  event.pump = pump_;
 }
 
-void Shot::start(uint32_t init_fill_ms, uint32_t time_ramp_ms, uint32_t time_pause_ms, 
-                         uint8_t pump_start_percent, uint8_t pump_stop_percent)
+void Shot::start()
 {
-  if (active_ ||
-      init_fill_ms == 0 || init_fill_ms > 5000 ||
-      time_ramp_ms > 10000 || time_pause_ms > 10000 ||
-      pump_start_percent > 100 || pump_stop_percent > 100 || pump_start_percent > pump_stop_percent)
+  ShotProfile_t profile;
+  bool active;
+
+  portENTER_CRITICAL(&shot_mux);
+  active = active_;
+  profile = profiles_[selected_];
+  portEXIT_CRITICAL(&shot_mux);
+
+  if (active)
+    return;
+  if (!shot_profile_validate(profile))
+  {
+    Serial.println("Shot start: invalid profile");
+    return;
+  }
+
+  // the task sets the time base with the next pump period.
+  // checked again - another start may have come in since the copy
+  portENTER_CRITICAL(&shot_mux);
+  if (active_)
   {
-    Serial.println("Shot start: invalid parameters");
+    portEXIT_CRITICAL(&shot_mux);
     return;
   }
-  Serial.println("Shot: starting");
-  xTimerStop(timer_, portMAX_DELAY);
+  profile_ = profile;
+  clock_ms_ = shot_profile_clock_start(profile_);
+  shot_profile_evaluate(profile_, 0, setpoint_);
+  segment_ = SHOT_SEGMENTS_MAX;
+  pump_ = water_control_->pump_->getPWM();
+  event_count_ = 0;
+  timing_.shots++;
+  start_us_ = (uint32_t)esp_timer_get_time();
+  stop_us_ = start_us_;
+  aligned_ = false;
   active_ = true;
-  
-  time_init_fill_ms_ = init_fill_ms;
-  time_ramp_ms_ = time_ramp_ms;
-  time_pause_ms_ = time_pause_ms;
-  pump_start_percent_ = pump_start_percent;
-  pump_stop_percent_ = pump_stop_percent;
-  
-  uint32_t cmd = CMD_START;
-  xQueueSendToBack(cmd_queue_, &cmd, portMAX_DELAY);
+  // wakes the task with the next pump period
+  SSRScheduler::getInstance()->setNotify(true);
+  portEXIT_CRITICAL(&shot_mux);
+
+  Serial.println("Shot: starting " + String(profile.name));
+  water_control_->valve_->on();
 }
 
 void Shot::stop(uint8_t pump_percent, bool valve)
 {
+  // a running step() finishes its pump and target writes first,
+  // the task does not touch them after this
+  xSemaphoreTake(output_mutex, portMAX_DELAY);
+  portENTER_CRITICAL(&shot_mux);
   if (!active_)
+  {
+    portEXIT_CRITICAL(&shot_mux);
+    xSemaphoreGive(output_mutex);
     return;
-
-  Serial.println("Shot: stopping");
+  }
   active_ = false;
-  xTimerStop(timer_, portMAX_DELAY);
+  SSRScheduler::getInstance()->setNotify(false);
+  stop_us_ = (uint32_t)esp_timer_get_time();
+  if (!aligned_)
+    start_us_ = stop_us_;
+  pump_ = pump_percent;
+  addEvent(SHOT_EVENT_STOP, stop_us_ - start_us_, 0);
+  portEXIT_CRITICAL(&shot_mux);
+  xSemaphoreGive(output_mutex);
 
-  uint32_t cmd = CMD_STOP;
-  xQueueSendToBack(cmd_queue_, &cmd, portMAX_DELAY);
-  
+  Serial.println("Shot: stopping");
   if (valve)
     water_control_->valve_->on();
   else
@@ -179,26 +240,194 @@ void Shot::stop(uint8_t pump_percent, bool valve)
   water_control_->pump_->setPWM(pump_percent);
 }
 
+uint8_t Shot::getPumpForecast()
+{
+  uint8_t pump = water_control_->pump_->getPWM();
+  ShotSetpoint_t setpoint;
+  uint32_t count;
+  bool active;
+
+  portENTER_CRITICAL(&shot_mux);
+  active = active_;
+  setpoint = setpoint_;
+  count = profile_.count;
+  portEXIT_CRITICAL(&shot_mux);
+
+  // the first segment may be just a short flip of the switch - no head start yet
+  if (!active || setpoint.segment == 0 || setpoint.segment >= count)
+    return pump;
+
+  // the profile is known in advance - the heater needs the head start
+  return setpoint.pump_forecast;
+}
+
+float Shot::getFFGain()
+{
+  float gain;
+
+  portENTER_CRITICAL(&shot_mux);
+  gain = active_ ? setpoint_.ff_gain : -1.0f;
+  portEXIT_CRITICAL(&shot_mux);
+  return gain;
+}
+
 uint32_t Shot::getShotTime()
 {
-  if (start_time_ == 0)
-  {
-    // pre-infusion
+  uint32_t start, stop, clock;
+  bool active;
+
+  // one consistent set - start and stop are written by different tasks
+  portENTER_CRITICAL(&shot_mux);
+  start = start_us_;
+  stop = stop_us_;
+  clock = clock_ms_;
+  active = active_ && aligned_;
+  portEXIT_CRITICAL(&shot_mux);
+
+  // the time base may lie up to one pump period ahead
+  int32_t elapsed_us = (active ? (uint32_t)esp_timer_get_time() : stop) - start;
+  if (elapsed_us < 0)
     return 0;
-  }
-  else if (stop_time_ == 0)
+
+  // pre-infusion
+  uint32_t elapsed = elapsed_us / 1000;
+  if (elapsed < clock)
+    return 0;
+  return elapsed - clock;
+}
+
+bool Shot::setProfile(uint32_t slot, const ShotProfile_t &profile)
+{
+  if (slot >= SHOT_PROFILE_SLOTS || !shot_profile_validate(profile))
+    return false;
+
+  portENTER_CRITICAL(&shot_mux);
+  profiles_[slot] = profile;
+  portEXIT_CRITICAL(&shot_mux);
+
+  storeProfile(slot);
+  return true;
+}
+
+bool Shot::getProfile(uint32_t slot, ShotProfile_t &profile)
+{
+  if (slot >= SHOT_PROFILE_SLOTS)
+    return false;
+
+  portENTER_CRITICAL(&shot_mux);
+  profile = profiles_[slot];
+  portEXIT_CRITICAL(&shot_mux);
+  return profile.count > 0;
+}
+
+bool Shot::selectProfile(uint32_t slot)
+{
+  if (slot >= SHOT_PROFILE_SLOTS)
+    return false;
+
+  // takes effect with the next shot
+  portENTER_CRITICAL(&shot_mux);
+  bool valid = profiles_[slot].count > 0;
+  if (valid)
+    selected_ = slot;
+  portEXIT_CRITICAL(&shot_mux);
+  if (!valid)
+    return false;
+
+  Preferences prefs;
+  prefs.begin("shot", false);
+  prefs.putUInt("active", slot);
+  prefs.end();
+  return true;
+}
+
+void Shot::getTiming(ShotTiming_t &timing)
+{
+  portENTER_CRITICAL(&shot_mux);
+  timing = timing_;
+  portEXIT_CRITICAL(&shot_mux);
+}
+
+uint32_t Shot::getTimeline(ShotEvent_t *events, uint32_t max_events)
+{
+  uint32_t count;
+
+  portENTER_CRITICAL(&shot_mux);
+  count = (event_count_ < max_events) ? event_count_ : max_events;
+  memcpy(events, events_, count * sizeof(ShotEvent_t));
+  portEXIT_CRITICAL(&shot_mux);
+  return count;
+}
+
+void Shot::loadProfiles()
+{
+  Preferences prefs;
+  bool stored = prefs.begin("shot", true);  // fails until something was stored
+
+  for (uint32_t slot = 0; slot < SHOT_PROFILE_SLOTS; slot++)
   {
-    // during shot
-    return systime_ms() - start_time_;
+    char key[4];
+    const char *error = "";
+
+    profiles_[slot].count = 0;
+    if (!stored)
+      continue;
+
+    snprintf(key, sizeof(key), "p%u", (unsigned)slot);
+    String text = prefs.getString(key, "");
+    if (text.length() > 0 && !shot_profile_parse(text.c_str(), profiles_[slot], &error))
+    {
+      Serial.println("Shot ERROR stored profile " + String(slot) + ": " + String(error));
+      profiles_[slot].count = 0;
+    }
   }
-  else if (stop_time_ < start_time_)
+
+  if (stored)
   {
-    Serial.println("Shot ERROR: start and stop time wrong");
-    return 0;
+    selected_ = prefs.getUInt("active", 0);
+    prefs.end();
   }
-  else
+
+  if (profiles_[0].count == 0)
+    defaultProfile(profiles_[0]);
+  if (selected_ >= SHOT_PROFILE_SLOTS || profiles_[selected_].count == 0)
+    selected_ = 0;
+}
+
+void Shot::storeProfile(uint32_t slot)
+{
+  ShotProfile_t profile;
+  char key[4];
+  char text[SHOT_SEGMENTS_MAX * 64];
+
+  getProfile(slot, profile);
+  if (shot_profile_format(profile, text, sizeof(text)) >= sizeof(text))
   {
-    // after shot stopped
-    return stop_time_ - start_time_;
+    Serial.println("Shot ERROR profile too long to store");
+    return;
   }
+
+  snprintf(key, sizeof(key), "p%u", (unsigned)slot);
+  Preferences prefs;
+  prefs.begin("shot", false);
+  prefs.putString(key, text);
+  prefs.end();
+}
+
+// the classic shot: fill, ramp up, optional pause, then full pump until stopped
+void Shot::defaultProfile(ShotProfile_t &profile)
+{
+  static const ShotSegment_t fill  = {SEGMENT_HOLD, 0, 100, 100, SHOT_T_INITWATER, 0, 0, -1.0f, 0.0f};
+  static const ShotSegment_t ramp  = {SEGMENT_RAMP, 0, SHOT_RAMP_MIN, SHOT_RAMP_MAX, SHOT_T_RAMP, 0, 0, -1.0f, 0.0f};
+  static const ShotSegment_t pause = {SEGMENT_PAUSE, 0, 0, 0, SHOT_T_PAUSE, 0, 0, -1.0f, 0.0f};
+  static const ShotSegment_t brew  = {SEGMENT_HOLD, SEGMENT_FLAG_CLOCK, 100, 100, 0, 0, 0, -1.0f, 0.0f};
+
+  memset(&profile, 0, sizeof(profile));
+  strcpy(profile.name, "default");
+  profile.segments[profile.count++] = fill;
+  if (SHOT_T_RAMP > 0)
+    profile.segments[profile.count++] = ramp;
+  if (SHOT_T_PAUSE > 0)
+    profile.segments[profile.count++] = pause;
+  profile.segments[profile.count++] = brew;
 }
@@ -0,0 +1,336 @@
+#include "ShotProfile.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const char *type_names[] = {"hold", "ramp", "pulse", "pause"};
+
+bool shot_profile_validate(const ShotProfile_t &profile)
+{
+  if (profile.count == 0 || profile.count > SHOT_SEGMENTS_MAX)
+    return false;
+
+  for (uint32_t n = 0; n < profile.count; n++)
+  {
+    const ShotSegment_t &s = profile.segments[n];
+
+    if (s.type > SEGMENT_PAUSE || s.pump > 100 || s.pump_end > 100 || s.duration_ms > 120000)
+      return false;
+    // only the last segment may run until the shot is stopped
+    if (s.duration_ms == 0 && n != profile.count - 1)
+      return false;
+    if (s.type == SEGMENT_PULSE && s.pulse_on_ms + s.pulse_off_ms == 0)
+      return false;
+    if (s.temp != 0.0f && !(s.temp >= 20.0f && s.temp < 139.0f))
+      return false;
+    if (!(s.ff_gain <= 5.0f))
+      return false;
+  }
+  return true;
+}
+
+// next whitespace separated token, NULL at the end of the line
+static char *next_token(char **pos)
+{
+  char *p = *pos;
+
+  while (*p == ' ' || *p == '\t')
+    p++;
+  if (*p == '\0')
+    return NULL;
+
+  char *start = p;
+  while (*p != '\0' && *p != ' ' && *p != '\t')
+    p++;
+  if (*p != '\0')
+    *p++ = '\0';
+  *pos = p;
+  return start;
+}
+
+static bool parse_uint(const char *token, uint32_t max, uint32_t &value)
+{
+  char *end;
+
+  if (token == NULL)
+    return false;
+  unsigned long v = strtoul(token, &end, 10);
+  if (*end != '\0' || v > max)
+    return false;
+  value = v;
+  return true;
+}
+
+static bool parse_float(const char *token, float &value)
+{
+  char *end;
+
+  value = strtof(token, &end);
+  return end != token && *end == '\0' && isfinite(value);
+}
+
+static bool parse_line(char *line, ShotProfile_t &profile, const char **error)
+{
+  char *pos = line;
+  char *token = next_token(&pos);
+  uint32_t v[4];
+  int32_t type = -1;
+
+  if (token == NULL)
+    return true;
+
+  if (strcmp(token, "name") == 0)
+  {
+    token = next_token(&pos);
+    if (token == NULL || strlen(token) >= SHOT_NAME_LENGTH)
+    {
+      *error = "invalid name";
+      return false;
+    }
+    strcpy(profile.name, token);
+    return true;
+  }
+
+  for (uint32_t n = 0; n < sizeof(type_names) / sizeof(type_names[0]); n++)
+    if (strcmp(token, type_names[n]) == 0)
+      type = n;
+  if (type < 0)
+  {
+    *error = "unknown segment type";
+    return false;
+  }
+  if (profile.count >= SHOT_SEGMENTS_MAX)
+  {
+    *error = "too many segments";
+    return false;
+  }
+
+  ShotSegment_t &s = profile.segments[profile.count];
+  memset(&s, 0, sizeof(s));
+  s.type = type;
+  s.ff_gain = -1.0f;
+
+  // pump %, durations in ms
+  static const uint32_t value_max[][4] = {
+    {100, 120000, 0, 0},
+    {100, 100, 120000, 0},
+    {100, 120000, 60000, 60000},
+    {120000, 0, 0, 0},
+  };
+  static const uint32_t value_count[] = {2, 3, 4, 1};
+  for (uint32_t n = 0; n < value_count[type]; n++)
+  {
+    if (!parse_uint(next_token(&pos), value_max[type][n], v[n]))
+    {
+      *error = "missing or invalid value";
+      return false;
+    }
+  }
+
+  switch (type)
+  {
+    case SEGMENT_HOLD:
+      s.pump = v[0];
+      s.pump_end = v[0];
+      s.duration_ms = v[1];
+      break;
+    case SEGMENT_RAMP:
+      s.pump = v[0];
+      s.pump_end = v[1];
+      s.duration_ms = v[2];
+      break;
+    case SEGMENT_PULSE:
+      s.pump = v[0];
+      s.pump_end = v[0];
+      s.duration_ms = v[1];
+      s.pulse_on_ms = v[2];
+      s.pulse_off_ms = v[3];
+      break;
+    default:
+      s.duration_ms = v[0];
+      break;
+  }
+
+  // options
+  while ((token = next_token(&pos)) != NULL)
+  {
+    if (strcmp(token, "clock") == 0)
+      s.flags |= SEGMENT_FLAG_CLOCK;
+    else if (strncmp(token, "ff=", 3) == 0)
+    {
+      if (!parse_float(token + 3, s.ff_gain))
+      {
+        *error = "invalid ff";
+        return false;
+      }
+    }
+    else if (strncmp(token, "temp=", 5) == 0)
+    {
+      if (!parse_float(token + 5, s.temp))
+      {
+        *error = "invalid temp";
+        return false;
+      }
+    }
+    else
+    {
+      *error = "unknown option";
+      return false;
+    }
+  }
+
+  profile.count++;
+  return true;
+}
+
+bool shot_profile_parse(const char *text, ShotProfile_t &profile, const char **error)
+{
+  char line[96];
+  const char *p = text;
+  const char *dummy;
+
+  if (error == NULL)
+    error = &dummy;
+  memset(&profile, 0, sizeof(profile));
+  strcpy(profile.name, "unnamed");
+
+  while (*p != '\0')
+  {
+    size_t length = strcspn(p, "\r\n");
+    if (length >= sizeof(line))
+    {
+      *error = "line too long";
+      return false;
+    }
+    memcpy(line, p, length);
+    line[length] = '\0';
+    p += length;
+    while (*p == '\r' || *p == '\n')
+      p++;
+
+    char *comment = strchr(line, '#');
+    if (comment)
+      *comment = '\0';
+
+    if (!parse_line(line, profile, error))
+      return false;
+  }
+
+  if (!shot_profile_validate(profile))
+  {
+    *error = "invalid profile";
+    return false;
+  }
+  return true;
+}
+
+size_t shot_profile_format(const ShotProfile_t &profile, char *buffer, size_t size)
+{
+  size_t length = 0;
+  char dummy;
+
+  // like snprintf: keep counting if the buffer is full
+  #define APPEND(...) do { \
+      int n = snprintf(length < size ? buffer + length : &dummy, length < size ? size - length : 0, __VA_ARGS__); \
+      if (n > 0) length += n; \
+    } while (0)
+
+  APPEND("name %s\n", profile.name);
+  for (uint32_t n = 0; n < profile.count && n < SHOT_SEGMENTS_MAX; n++)
+  {
+    const ShotSegment_t &s = profile.segments[n];
+    switch (s.type)
+    {
+      case SEGMENT_HOLD:
+        APPEND("hold %u %u", s.pump, (unsigned)s.duration_ms);
+        break;
+      case SEGMENT_RAMP:
+        APPEND("ramp %u %u %u", s.pump, s.pump_end, (unsigned)s.duration_ms);
+        break;
+      case SEGMENT_PULSE:
+        APPEND("pulse %u %u %u %u", s.pump, (unsigned)s.duration_ms, s.pulse_on_ms, s.pulse_off_ms);
+        break;
+      default:
+        APPEND("pause %u", (unsigned)s.duration_ms);
+        break;
+    }
+    if (s.ff_gain >= 0.0f)
+      APPEND(" ff=%.2f", s.ff_gain);
+    if (s.temp != 0.0f)
+      APPEND(" temp=%.1f", s.temp);
+    if (s.flags & SEGMENT_FLAG_CLOCK)
+      APPEND(" clock");
+    APPEND("\n");
+  }
+  #undef APPEND
+
+  return length;
+}
+
+void shot_profile_evaluate(const ShotProfile_t &profile, uint32_t elapsed_ms, ShotSetpoint_t &setpoint)
+{
+  uint32_t start = 0;
+
+  for (uint32_t n = 0; n < profile.count; n++)
+  {
+    const ShotSegment_t &s = profile.segments[n];
+
+    if (s.duration_ms == 0 || elapsed_ms < start + s.duration_ms)
+    {
+      uint32_t t = elapsed_ms - start;
+
+      setpoint.segment = n;
+      setpoint.segment_start_ms = start;
+      setpoint.ff_gain = s.ff_gain;
+      setpoint.temp = s.temp;
+
+      switch (s.type)
+      {
+        case SEGMENT_HOLD:
+          setpoint.pump = s.pump;
+          setpoint.pump_forecast = s.pump;
+          break;
+        case SEGMENT_RAMP:
+          if (s.duration_ms == 0)
+            setpoint.pump = s.pump_end;
+          else
+            setpoint.pump = s.pump + ((int32_t)s.pump_end - s.pump) * (int32_t)t / (int32_t)s.duration_ms;
+          setpoint.pump_forecast = s.pump_end;
+          break;
+        case SEGMENT_PULSE:
+          setpoint.pump = (t % (s.pulse_on_ms + s.pulse_off_ms) < s.pulse_on_ms) ? s.pump : 0;
+          // the heater sees the average of the pulses
+          setpoint.pump_forecast = s.pump * s.pulse_on_ms / (s.pulse_on_ms + s.pulse_off_ms);
+          break;
+        default:
+          setpoint.pump = 0;
+          setpoint.pump_forecast = 0;
+          break;
+      }
+      return;
+    }
+    start += s.duration_ms;
+  }
+
+  // done
+  setpoint.segment = profile.count;
+  setpoint.segment_start_ms = start;
+  setpoint.pump = 0;
+  setpoint.pump_forecast = 0;
+  setpoint.ff_gain = -1.0f;
+  setpoint.temp = 0.0f;
+}
+
+uint32_t shot_profile_clock_start(const ShotProfile_t &profile)
+{
+  uint32_t start = 0;
+
+  for (uint32_t n = 0; n < profile.count; n++)
+  {
+    if (profile.segments[n].flags & SEGMENT_FLAG_CLOCK)
+      return start;
+    start += profile.segments[n].duration_ms;
+  }
+  return 0;
+}
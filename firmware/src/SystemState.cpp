@@ -0,0 +1,50 @@
+#include "SystemState.hpp"
+#include <atomic>
+#include "helpers.hpp"
+
+static std::atomic<uint32_t> sequence(0);  // odd while a write is in progress
+static SystemSnapshot_t current;
+
+void SystemState::publish(const SystemSnapshot_t &snapshot)
+{
+  uint32_t seq = sequence.load(std::memory_order_relaxed);
+
+  sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  current = snapshot;
+  current.seq = (seq + 2) / 2;
+  current.time_ms = systime_ms();
+
+  std::atomic_thread_fence(std::memory_order_release);
+  sequence.store(seq + 2, std::memory_order_relaxed);
+}
+
+bool SystemState::read(SystemSnapshot_t &snapshot)
+{
+  uint32_t seq_before, seq_after;
+  uint32_t retries = 0;
+
+  do
+  {
+    // the writer might be preempted on this core - give it time to finish
+    if (retries++ > 10)
+      vTaskDelay(1);
+
+    seq_before = sequence.load(std::memory_order_acquire);
+    if (seq_before & 1)
+      continue;
+
+    snapshot = current;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    seq_after = sequence.load(std::memory_order_relaxed);
+  } while ((seq_before & 1) || seq_before != seq_after);
+
+  return seq_before != 0;
+}
+
+uint32_t SystemState::getSequence()
+{
+  return sequence.load(std::memory_order_acquire) / 2;
+}
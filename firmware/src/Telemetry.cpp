@@ -0,0 +1,264 @@
+#include "Telemetry.hpp"
+#include <math.h>
+
+TelemetryRing::TelemetryRing(TelemetryPoint_t *points, uint32_t capacity) :
+  points_(points),
+  capacity_(capacity),
+  write_seq_(0),
+  read_seq_(0),
+  dropped_(0)
+{
+}
+
+void TelemetryRing::push(const TelemetryPoint_t &point)
+{
+  points_[write_seq_ % capacity_] = point;
+  write_seq_++;
+  if (write_seq_ - read_seq_ > capacity_)
+  {
+    read_seq_++;
+    dropped_++;
+  }
+}
+
+bool TelemetryRing::get(uint32_t seq, TelemetryPoint_t &point)
+{
+  // unsigned differences - valid across the wrap-around of the sequence
+  if (seq - read_seq_ >= write_seq_ - read_seq_)
+    return false;
+  point = points_[seq % capacity_];
+  return true;
+}
+
+void TelemetryRing::release(uint32_t seq_end)
+{
+  // points already dropped by push were released with them
+  if (seq_end - read_seq_ <= write_seq_ - read_seq_)
+    read_seq_ = seq_end;
+}
+
+int16_t telemetry_temp(float value)
+{
+  value = roundf(value * 100.0f);
+  // false for NaN as well
+  if (!(value > INT16_MIN && value <= INT16_MAX))
+    return TELEMETRY_INVALID;
+  return value;
+}
+
+int32_t telemetry_fixed32(float value)
+{
+  if (isnan(value))
+    return 0;
+  value = roundf(value * 100.0f);
+  // largest floats that convert without overflow
+  if (value > 2147483520.0f)
+    return 2147483520;
+  if (value < -2147483520.0f)
+    return -2147483520;
+  return value;
+}
+
+// 0.01 units as decimal
+static void append_fixed(ResponseWriter &writer, int32_t value)
+{
+  char fraction[3];
+  uint32_t magnitude = (value < 0) ? 0u - (uint32_t)value : value;
+
+  if (value < 0)
+    writer.append("-", 1);
+  writer.appendUInt(magnitude / 100);
+  fraction[0] = '.';
+  fraction[1] = '0' + magnitude / 10 % 10;
+  fraction[2] = '0' + magnitude % 10;
+  writer.append(fraction, 3);
+}
+
+static void append_uint64(ResponseWriter &writer, uint64_t value)
+{
+  char digits[20];
+  uint32_t n = sizeof(digits);
+
+  do
+  {
+    digits[--n] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  writer.append(digits + n, sizeof(digits) - n);
+}
+
+static void append_field(ResponseWriter &writer, bool &first, const char *name)
+{
+  writer.append(first ? " " : ",");
+  writer.append(name);
+  writer.append("=");
+  first = false;
+}
+
+// one row per point and measurement: "temperature top=93.27,side=91.50 <timestamp>"
+static void format_fields(const TelemetryPoint_t &point, ResponseWriter &ts, ResponseWriter &writer)
+{
+  static const char *const temp_names[TELEMETRY_TEMPS] = {"top", "side", "brewhead", "avg", "water"};
+  static const char *const share_names[TELEMETRY_SHARES] = {"p", "i", "d", "ff"};
+  bool first;
+
+  // fields without a reading are left out, a row needs at least one
+  first = true;
+  for (uint32_t n = 0; n < TELEMETRY_TEMPS; n++)
+  {
+    if (point.temp[n] == TELEMETRY_INVALID)
+      continue;
+    if (first)
+      writer.append("temperature");
+    append_field(writer, first, temp_names[n]);
+    append_fixed(writer, point.temp[n]);
+  }
+  if (!first)
+    writer.append(ts.c_str(), ts.length());
+
+  writer.append("power heater=");
+  writer.appendUInt(point.heater);
+  writer.append("i,pump=");
+  writer.appendUInt(point.pump);
+  writer.append("i");
+  writer.append(ts.c_str(), ts.length());
+
+  writer.append("pid");
+  first = true;
+  for (uint32_t n = 0; n < TELEMETRY_SHARES; n++)
+  {
+    append_field(writer, first, share_names[n]);
+    append_fixed(writer, point.share[n]);
+  }
+  append_field(writer, first, "u");
+  append_fixed(writer, point.u);
+  append_field(writer, first, "regime");
+  writer.appendUInt(point.regime);
+  writer.append("i,water_state=");
+  writer.appendUInt(point.water_state);
+  writer.append("i");
+  writer.append(ts.c_str(), ts.length());
+}
+
+// start of a row "<measurement>,<tag>=<name> value=<value> <timestamp>"
+static void append_series(ResponseWriter &writer, const char *series)
+{
+  writer.append(series);
+  writer.append(" value=", 7);
+}
+
+// one row per value: "temperature,pos=top value=93.27 <timestamp>"
+static void format_series(const TelemetryPoint_t &point, ResponseWriter &ts, ResponseWriter &writer)
+{
+  static const char *const temp_series[TELEMETRY_TEMPS] = {"temperature,pos=top", "temperature,pos=side",
+    "temperature,pos=brewhead", "temperature,pos=avg", "temperature,pos=water"};
+  static const char *const share_series[TELEMETRY_SHARES] = {"pid,part=p", "pid,part=i", "pid,part=d", "pid,part=ff"};
+
+  // temperatures without a reading are left out
+  for (uint32_t n = 0; n < TELEMETRY_TEMPS; n++)
+  {
+    if (point.temp[n] == TELEMETRY_INVALID)
+      continue;
+    append_series(writer, temp_series[n]);
+    append_fixed(writer, point.temp[n]);
+    writer.append(ts.c_str(), ts.length());
+  }
+
+  // integers without the i suffix - the series were always written as float
+  append_series(writer, "power,device=heater");
+  writer.appendUInt(point.heater);
+  writer.append(ts.c_str(), ts.length());
+  append_series(writer, "power,device=pump");
+  writer.appendUInt(point.pump);
+  writer.append(ts.c_str(), ts.length());
+
+  for (uint32_t n = 0; n < TELEMETRY_SHARES; n++)
+  {
+    append_series(writer, share_series[n]);
+    append_fixed(writer, point.share[n]);
+    writer.append(ts.c_str(), ts.length());
+  }
+  append_series(writer, "pid,part=regime");
+  writer.appendUInt(point.regime);
+  writer.append(ts.c_str(), ts.length());
+  append_series(writer, "pid,part=u");
+  append_fixed(writer, point.u);
+  writer.append(ts.c_str(), ts.length());
+
+  append_series(writer, "water,part=state");
+  writer.appendUInt(point.water_state);
+  writer.append(ts.c_str(), ts.length());
+}
+
+void telemetry_format(const TelemetryPoint_t &point, uint32_t now_ms, uint64_t unix_now_ms,
+                      TELEMETRY_Layout_t layout, ResponseWriter &writer)
+{
+  char timestamp[24];
+
+  // unsigned difference - valid across the wrap-around of the systime
+  ResponseWriter ts(timestamp, sizeof(timestamp));
+  ts.append(" ");
+  append_uint64(ts, unix_now_ms - (uint32_t)(now_ms - point.time_ms));
+  ts.append("\n");
+
+  if (layout == TELEMETRY_LAYOUT_FIELDS)
+    format_fields(point, ts, writer);
+  else
+    format_series(point, ts, writer);
+}
+
+TelemetryBatch::TelemetryBatch(char *buffer, size_t size, TELEMETRY_Layout_t layout,
+                               uint32_t flush_ms, uint32_t drain_ms, uint32_t backoff_max_ms) :
+  writer_(buffer, size),
+  size_(size),
+  layout_(layout),
+  flush_ms_(flush_ms),
+  drain_ms_(drain_ms),
+  backoff_max_ms_(backoff_max_ms),
+  backoff_ms_(flush_ms),
+  first_(0),
+  end_(0),
+  full_(false)
+{
+}
+
+void TelemetryBatch::begin(uint32_t first)
+{
+  writer_.clear();
+  first_ = first;
+  end_ = first;
+  full_ = false;
+}
+
+bool TelemetryBatch::add(const TelemetryPoint_t &point, uint32_t now_ms, uint64_t unix_now_ms)
+{
+  ResponseWriter rows(rows_, sizeof(rows_));
+
+  telemetry_format(point, now_ms, unix_now_ms, layout_, rows);
+  if (writer_.length() + rows.length() >= size_)
+  {
+    full_ = true;
+    return false;
+  }
+  writer_.append(rows.c_str(), rows.length());
+  end_++;
+  return true;
+}
+
+uint32_t TelemetryBatch::sent(bool accepted, uint32_t duration_ms)
+{
+  if (!accepted)
+  {
+    // back off while the server is unreachable
+    uint32_t delay_ms = backoff_ms_;
+    backoff_ms_ = (backoff_ms_ > backoff_max_ms_ / 2) ? backoff_max_ms_ : 2 * backoff_ms_;
+    return delay_ms;
+  }
+  backoff_ms_ = flush_ms_;
+
+  // catching up after an outage: next batch right away, but leave the
+  // server at least as much time as the last request took
+  if (full_)
+    return (duration_ms > drain_ms_) ? duration_ms : drain_ms_;
+  return flush_ms_;
+}
@@ -5,7 +5,7 @@
 #include "SSRPump.hpp"
 #include "SSR.hpp"
 #include "Pins.hpp"
-#include "Timers.hpp"
+#include "SSRScheduler.hpp"
 #include "Shot.hpp"
 #include "Preheat.hpp"
 #include "PIDHeater.hpp"
@@ -18,6 +18,7 @@ static WaterControl *instance = nullptr;
 
 WaterControl::WaterControl() :
   state_(WATERCTRL_OFF),
+  brew_temp_(BREW_TEMP),
   pump_override_percent_(0),
   pump_override_total_ms_(0),
   pump_override_active_ms_(0)
@@ -29,9 +30,11 @@ WaterControl::WaterControl() :
     return;
   }
 
-  pump_ = new SSRPump(Pins::ssr_pump, Timers::timer_pump, 20000);
+  pump_ = new SSRPump(Pins::ssr_pump);
   pid_boiler_ = new PIDHeater(this);
   valve_ = new SSR(Pins::ssr_valve);
+  SSRScheduler::getInstance()->setPump(pump_);
+  SSRScheduler::getInstance()->setValve(valve_);
   shot_ = new Shot(this);
   preheat_ = new Preheat(this);
 
@@ -61,6 +64,27 @@ void WaterControl::disable()
   valve_->disable();
 }
 
+bool WaterControl::setBrewTemp(float temp)
+{
+  if (!(temp >= BREW_TEMP_MIN && temp <= BREW_TEMP_MAX))
+    return false;
+
+  brew_temp_ = temp;
+  // steam keeps its target, a shot profile may set its own per segment
+  if (state_ != WATERCTRL_STEAM)
+    pid_boiler_->setTarget(brew_temp_, PID_MODE_WATER);
+  return true;
+}
+
+const char *WaterControl::getStateName(WATERCTRL_State_t state)
+{
+  static const char *names[] = {"off", "water", "water-valve", "shot", "preheat", "steam"};
+
+  if (state > WATERCTRL_STEAM)
+    return "unknown";
+  return names[state];
+}
+
 void WaterControl::startPump(uint8_t percent, bool valve)
 {
   if (valve)
@@ -96,7 +120,7 @@ void WaterControl::startShot()
   // keep pump and valve on, if already running
   stop(100, true, WATERCTRL_SHOT);
 
-  shot_->start(SHOT_T_INITWATER, SHOT_T_RAMP, SHOT_T_PAUSE, SHOT_RAMP_MIN, SHOT_RAMP_MAX);  // init-100p-t, ramp-t, pause-t, min-%, max-%
+  shot_->start();  // selected profile
 }
 
 uint32_t WaterControl::getShotTime()
@@ -132,8 +156,6 @@ void WaterControl::startSteam(uint8_t pump_percent, bool new_state_valve)
 
 void WaterControl::stop(uint8_t new_pump_percent, bool new_state_valve, WATERCTRL_State_t new_state)
 {
-  pid_boiler_->setTarget(BREW_TEMP, PID_MODE_WATER);
-
   if (pump_override_total_ms_ > pump_override_active_ms_)
   {
     pump_->setPWM(pump_override_percent_);
@@ -147,6 +169,9 @@ void WaterControl::stop(uint8_t new_pump_percent, bool new_state_valve, WATERCTR
     pump_->setPWM(new_pump_percent);
   }
 
+  // after the shot stopped - its task may have set a segment temperature until then
+  pid_boiler_->setTarget(brew_temp_, PID_MODE_WATER);
+
   if (new_state_valve)
     valve_->on();
   else
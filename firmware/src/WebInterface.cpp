@@ -11,27 +11,109 @@
 #include "SSRPump.hpp"
 #include "HWInterface.hpp"
 #include "PIDHeater.hpp"
+#include "SystemState.hpp"
+#include "History.hpp"
+#include "RelayAutotune.hpp"
+#include "ZeroCross.hpp"
+#include "SSRScheduler.hpp"
+#include "Shot.hpp"
+#include "ResponseWriter.hpp"
+#include "Json.hpp"
+#include "Telemetry.hpp"
 #include <cstring>
+#include <memory>
+#include <esp_heap_caps.h>
+#include <sys/time.h>
 #include "Pins.hpp"
 #include "helpers.hpp"
 
-// from https://techtutorialsx.com/2017/12/16/esp32-arduino-async-http-server-serving-a-html-page-from-flash-memory/
-// HTML compressor: https://htmlcompressor.com/compressor/ or https://www.willpeavy.com/minifier/
-// text to C converter: http://tomeko.net/online_tools/cpp_text_escape.php?lang=en
-static const char HTML_CODE[] = "<!DOCTYPE html><html><head><title>Silvia</title><meta name=viewport content=\"width=device-width, initial-scale=1\"><link rel=icon href=data:,><link rel=stylesheet type=text/css href=style.css><script>function DisplayCurrentTime(){var b=new Date();var a=b.getHours()<10?\"0\"+b.getHours():b.getHours();var c=b.getMinutes()<10?\"0\"+b.getMinutes():b.getMinutes();var e=b.getSeconds()<10?\"0\"+b.getSeconds():b.getSeconds();time=a+\":\"+c+\":\"+e;var d=document.getElementById(\"currentTime\");d.innerHTML=time}function GetReadings(){var a=new XMLHttpRequest();a.onreadystatechange=function(){if(this.status==200){if(this.responseXML!=null){var c;var b=this.responseXML.getElementsByTagName(\"rd\").length;for(c=0;c<b;c++){document.getElementsByClassName(\"rd\")[c].innerHTML=this.responseXML.getElementsByTagName(\"rd\")[c].childNodes[0].nodeValue}b=this.responseXML.getElementsByTagName(\"pwr\").length;for(c=0;c<b;c++){document.getElementsByClassName(\"pwr\")[c].innerHTML=this.responseXML.getElementsByTagName(\"pwr\")[c].childNodes[0].nodeValue}DisplayCurrentTime()}}};a.open(\"GET\",\"/update_readings\",true);a.send(null);setTimeout(\"GetReadings()\",1000)}function powerOnButtonFunction(){var a=new XMLHttpRequest();a.open(\"POST\",\"/on\",true);a.send(null)}function powerOffButtonFunction(){var a=new XMLHttpRequest();a.open(\"POST\",\"/off\",true);a.send(null)}function resetButtonFunction(){var a=new XMLHttpRequest();a.open(\"POST\",\"/reset\",true);a.send(null)}function waterfillButtonFunction(){var a=new XMLHttpRequest();a.open(\"POST\",\"/waterfill\",true);a.send(null)}document.addEventListener(\"DOMContentLoaded\",function(){GetReadings()},false);</script></head><body><h1>Silvia</h1><h3>Last update: <span id=currentTime></span></h3><p>Status: <span class=pwr>...</span></p><table><tr><th width=150px>SENSOR</th><th width=100px>VALUE</th></tr><tr><td><span class=sensor>Top</span></td><td><span class=rd>...</span> &deg;C</td></tr><tr><td><span class=sensor>Side</span></td><td><span class=rd>...</span> &deg;C</td></tr><tr><td><span class=sensor>Average (%TARGETTEMP_BOILER%)</span></td><td><span class=rd>...</span> &deg;C</td></tr><tr><td><span class=sensor>Brewhead (%TARGETTEMP_BREWHEAD%)</span></td><td><span class=rd>...</span> &deg;C</td></tr><tr><td><span class=sensor>Heater</span></td><td><span class=rd>...</span> &#37;</td></tr><tr><td><span class=sensor>Shot Time</span></td><td><span class=rd>...</span> s</td></tr></table><button onclick=powerOnButtonFunction()>Power On</button><button onclick=powerOffButtonFunction()>Power Off</button><button onclick=waterfillButtonFunction()>Fill</button><button onclick=resetButtonFunction()>Reset</button></body></html>";
-static const char CSS_CODE[] = "body{text-align:center;font-family:\"Trebuchet MS\",Arial}table{border-collapse:collapse;margin-left:auto;margin-right:auto}th{padding:16px;background-color:#0043af;color:white}tr{border:1px solid #ddd;padding:16px}td{border:0;padding:16px}.sensor{color:white;font-weight:bold;background-color:#bcbcbc;padding:8px}.button{display:inline-block;background-color:#008cba;border:0;border-radius:4px;color:white;padding:16px 40px;text-decoration:none;font-size:12px;margin:2px;cursor:pointer}.button2{background-color:#f44336}";
+// page and style sheet are generated from data/ by embed_assets.py
+#include "WebAssets.hpp"
+
 static const char XML_CODE[] = "<?xml version = \"1.0\"?>\n<inputs>\n<rd>\n%TEMP_TOP%\n</rd>\n<rd>\n%TEMP_SIDE%\n</rd>\n<rd>\n%TEMP_AVG%\n</rd>\n<rd>\n%TEMP_BREWHEAD%\n</rd>\n<rd>\n%PERC_HEATER%\n</rd>\n<rd>\n%SHOT_TIME%\n</rd>\n<pwr>\n%POWERSTATE%\n</pwr>\n</inputs>\n";
 
-static const char INFLUX_URL[] = "http://" PRIVATE_INFLUXDB_HOST_IP "/write?db=" PRIVATE_INFLUXDB_NAME;
+// placeholders of XML_CODE, resolved once at startup
+typedef enum {
+  XML_TEMP_TOP = 0,
+  XML_TEMP_SIDE,
+  XML_TEMP_AVG,
+  XML_TEMP_BREWHEAD,
+  XML_PERC_HEATER,
+  XML_SHOT_TIME,
+  XML_POWERSTATE,
+  XML_FIELD_COUNT
+} XML_Field_t;
+static const char *const xml_fields[XML_FIELD_COUNT] = {"TEMP_TOP", "TEMP_SIDE", "TEMP_AVG", "TEMP_BREWHEAD", "PERC_HEATER", "SHOT_TIME", "POWERSTATE"};
+static const ResponseTemplate xml_template(XML_CODE, xml_fields, XML_FIELD_COUNT);
+
+// bodies of the small data responses. send_P sends straight from the buffer,
+// also long after the handler returned - every response owns its buffer until
+// the request is gone. with all of them in use the request gets a 503.
+static constexpr uint32_t RESPONSE_BUFFERS = 4;
+static constexpr size_t RESPONSE_BUFFER_SIZE = 768;
+static char response_buffers[RESPONSE_BUFFERS][RESPONSE_BUFFER_SIZE];
+static ResponsePool response_pool(response_buffers[0], RESPONSE_BUFFER_SIZE, RESPONSE_BUFFERS);
+static uint32_t response_busy = 0;  // requests refused without a free buffer, for /metrics
+
+// text pages with a line per regime, profile, event etc. - up to ~1 kB
+static constexpr uint32_t PAGE_BUFFERS = 2;
+static constexpr size_t PAGE_BUFFER_SIZE = 1536;
+static char page_buffers[PAGE_BUFFERS][PAGE_BUFFER_SIZE];
+static ResponsePool page_pool(page_buffers[0], PAGE_BUFFER_SIZE, PAGE_BUFFERS);
+
+// handlers and disconnect callbacks all run in the async_tcp task.
+// nullptr: the 503 was sent
+static char *response_buffer(AsyncWebServerRequest *request, ResponsePool &pool)
+{
+  char *buffer = pool.acquire();
+  if (buffer == nullptr)
+  {
+    response_busy++;
+    request->send(503);
+    return nullptr;
+  }
+  request->onDisconnect([&pool, buffer]() {pool.release(buffer);});
+  return buffer;
+}
+
+// sends a page rendered into a page_pool buffer
+static void send_page(AsyncWebServerRequest *request, ResponseWriter &writer)
+{
+  if (writer.overflow())
+  {
+    Serial.println("WebInterface ERROR page buffer too small");
+    request->send(500);
+    return;
+  }
+  request->send_P(200, "text/plain", (const uint8_t *)writer.c_str(), writer.length());
+}
+
+static const char INFLUX_URL[] = "http://" PRIVATE_INFLUXDB_HOST_IP "/write?db=" PRIVATE_INFLUXDB_NAME "&precision=ms";
 
 static WebInterface *instance = nullptr;
+static portMUX_TYPE ws_mux = portMUX_INITIALIZER_UNLOCKED;  // client table, shared with the async_tcp task
+
+// telemetry points, written by the control task and read by task_influx
+static TelemetryPoint_t telemetry_points[TELEMETRY_RING_POINTS];
+static TelemetryRing telemetry(telemetry_points, TELEMETRY_RING_POINTS);
+static portMUX_TYPE telemetry_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t telemetry_sent = 0;
+static char telemetry_batch[TELEMETRY_BATCH_SIZE];
+static constexpr time_t UNIX_TIME_VALID = 1577836800;  // 2020-01-01 - anything before means no SNTP time yet
 
 WebInterface::WebInterface() :
-  influx_sem_update(nullptr),
   server_(80),
+  ws_("/ws"),
+  push_period_ms_(WS_PUSH_PERIOD_MS),
+  pushed_(0),
+  dropped_(0),
+  wifi_reconnects_(0),
+  influx_errors_(0),
+  not_found_(0),
   task_handle_http_(nullptr),
   task_handle_influx_(nullptr),
-  task_handle_ota_(nullptr)
+  task_handle_ota_(nullptr),
+  task_handle_push_(nullptr)
 {
   if (instance)
   {
@@ -41,6 +123,9 @@ WebInterface::WebInterface() :
   }
 
   Serial.println(INFLUX_URL);
+  if (!xml_template.isValid())
+    Serial.println("WebInterface ERROR xml template");
+  memset(ws_clients_, 0, sizeof(ws_clients_));
 
   // // initialize SPIFFS
   // if (!SPIFFS.begin(true))
@@ -57,6 +142,7 @@ WebInterface::WebInterface() :
 
 void WebInterface::wifiReconnect()
 {
+  wifi_reconnects_++;
   WiFi.disconnect();
   vTaskDelay(pdMS_TO_TICKS(1000));
   WiFi.enableSTA(true);
@@ -90,40 +176,323 @@ void WebInterface::wifiCheckConnectionOrReconnect()
   Serial.println("WIFI up again!");
 }
 
-// replaces placeholder with values in static html
-static String processor_static(const String& var)
+// values of the xml placeholders
+static void fill_xml(uint32_t field, ResponseWriter &writer, const void *arg)
 {
-  if (var == "TARGETTEMP_BOILER")
+  const SystemSnapshot_t &state = *static_cast<const SystemSnapshot_t *>(arg);
+
+  switch (field)
   {
-    char str[6];
-    snprintf(str, sizeof(str), "%.1f", WaterControl::getInstance()->getBoilerPID()->getTarget());
-    return String(str);
+    case XML_TEMP_TOP:
+      writer.appendFloat(state.temp_top, 2);
+      break;
+    case XML_TEMP_SIDE:
+      writer.appendFloat(state.temp_side, 2);
+      break;
+    case XML_TEMP_AVG:
+      writer.appendFloat(state.temp_avg, 2);
+      break;
+    case XML_TEMP_BREWHEAD:
+      writer.appendFloat(state.temp_brewhead, 2);
+      break;
+    case XML_PERC_HEATER:
+      writer.appendUInt(state.heater_percent);
+      break;
+    case XML_SHOT_TIME:
+      writer.appendFloat(state.shot_time_ms / 1000.0f, 2);
+      break;
+    case XML_POWERSTATE:
+      writer.append(state.power ? "ON" : "OFF");
+      break;
   }
-  else if (var == "TARGETTEMP_BREWHEAD")
-    return String(BREWHEAD_TEMP);
-  
-  return String();
 }
 
-// replaces placeholder with values in xml file
-static String processor_xml(const String& var)
+// the snapshot is published with the control tick - temperatures and shot time are fresher
+static void refresh_state(SystemSnapshot_t &state)
+{
+  state.temp_top = SensorsHandler::getTempBoilerTop();
+  state.temp_side = SensorsHandler::getTempBoilerSide();
+  state.temp_avg = (state.temp_top + state.temp_side) / 2;
+  state.temp_brewhead = SensorsHandler::getTempBrewhead();
+  state.shot_time_ms = WaterControl::getInstance()->getShotTime();
+}
+
+// machine readable state for /api/state and the websocket clients
+static void write_state_json(JsonWriter &json, const SystemSnapshot_t &state)
+{
+  WaterControl *water_control = WaterControl::getInstance();
+  Shot *shot = water_control->getShot();
+
+  json.beginObject();
+  json.addUInt("seq", state.seq);
+  json.addUInt("time_ms", state.time_ms);
+  json.addBool("power", state.power);
+  json.addBool("remote", HWInterface::getInstance()->isRemote());
+
+  json.beginObject("temp");
+  json.addFloat("top", state.temp_top, 2);
+  json.addFloat("side", state.temp_side, 2);
+  json.addFloat("avg", state.temp_avg, 2);
+  json.addFloat("brewhead", state.temp_brewhead, 2);
+  json.addFloat("water", state.temp_water, 2);
+  json.endObject();
+
+  json.beginObject("pid");
+  json.addFloat("target", state.target, 1);
+  json.addFloat("brew_temp", water_control->getBrewTemp(), 1);
+  json.addFloat("brewhead_target", BREWHEAD_TEMP, 1);
+  json.addString("regime", PIDHeater::getRegimeName((PID_Regime_t)state.regime));
+  json.addFloat("p", state.p_share, 3);
+  json.addFloat("i", state.i_share, 3);
+  json.addFloat("d", state.d_share, 3);
+  json.addFloat("ff", state.ff_share, 3);
+  json.addFloat("u", state.u, 3);
+  json.addUInt("sample_age_us", state.sample_age_us);
+  json.endObject();
+
+  json.beginObject("actuators");
+  json.addUInt("heater", state.heater_percent);
+  json.addUInt("pump", state.pump_percent);
+  json.endObject();
+
+  json.addString("water", WaterControl::getStateName(state.water_state));
+
+  ShotProfile_t profile;
+  uint32_t slot = shot->getSelectedProfile();
+  json.beginObject("shot");
+  json.addUInt("time_ms", state.shot_time_ms);
+  json.addUInt("profile", slot);
+  json.addString("name", shot->getProfile(slot, profile) ? profile.name : "");
+  json.endObject();
+
+  json.endObject();
+}
+
+// collects a POST body in the request, freed with it
+static constexpr size_t BODY_SIZE_MAX = 2048;
+static void collect_body(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+  if (total >= BODY_SIZE_MAX)
+    return;
+  if (index == 0)
+    request->_tempObject = calloc(1, total + 1);
+  if (request->_tempObject)
+    memcpy((char *)request->_tempObject + index, data, len);
+}
+
+static uint32_t api_rejected = 0;  // api requests answered with an error, for /metrics
+static void send_json_result(AsyncWebServerRequest *request, int code, const char *error)
 {
-  if (var == "TEMP_TOP")
-    return String(SensorsHandler::getTempBoilerTop());
-  else if (var == "TEMP_SIDE")
-    return String(SensorsHandler::getTempBoilerSide());
-  else if (var == "TEMP_AVG")
-    return String(SensorsHandler::getTempBoilerAvg());
-  else if (var == "TEMP_BREWHEAD")
-    return String(SensorsHandler::getTempBrewhead());
-  else if (var == "PERC_HEATER" && SSRHeater::getInstance())
-    return String(SSRHeater::getInstance()->getPWM());
-  else if (var == "SHOT_TIME" && WaterControl::getInstance())
-    return String(WaterControl::getInstance()->getShotTime()/1000.0f);
-  else if (var == "POWERSTATE" && HWInterface::getInstance())
-    return String((HWInterface::getInstance()->isActive()) ? "ON" : "OFF");
-
-  return String();
+  char *buffer = response_buffer(request, response_pool);
+  if (buffer == nullptr)
+    return;
+  ResponseWriter writer(buffer, RESPONSE_BUFFER_SIZE);
+  JsonWriter json(writer);
+  json.beginObject();
+  if (error)
+    api_rejected++;
+  json.addBool("ok", error == nullptr);
+  if (error)
+    json.addString("error", error);
+  json.endObject();
+  request->send_P(code, "application/json", (const uint8_t *)writer.c_str(), writer.length());
+}
+
+// /metrics, OpenMetrics text format. rendered from the current state on every
+// scrape - nothing is kept or computed between scrapes.
+static constexpr size_t METRICS_BUFFER_SIZE = 5120;  // ~3.7 kB rendered
+static char metrics_buffer[METRICS_BUFFER_SIZE];
+static ResponsePool metrics_pool(metrics_buffer, METRICS_BUFFER_SIZE, 1);  // a second scrape in flight gets a 503
+static const char *const metrics_tasks[] = {"task_pid", "task_shot", "task_sensor", "task_http", "task_influx",
+                                            "task_push", "task_ota", "async_tcp", "loopTask"};
+
+static void metric_family(ResponseWriter &writer, const char *name, const char *type, const char *help)
+{
+  writer.append("# TYPE ");
+  writer.append(name);
+  writer.append(" ");
+  writer.append(type);
+  writer.append("\n# HELP ");
+  writer.append(name);
+  writer.append(" ");
+  writer.append(help);
+  writer.append("\n");
+}
+
+// name{label="value"} - label may be null
+static void metric_sample(ResponseWriter &writer, const char *name, const char *label, const char *value)
+{
+  writer.append(name);
+  if (label)
+  {
+    writer.append("{");
+    writer.append(label);
+    writer.append("=\"");
+    writer.append(value);
+    writer.append("\"}");
+  }
+  writer.append(" ");
+}
+
+static void metric_float(ResponseWriter &writer, float value, uint32_t decimals)
+{
+  if (isnan(value))
+    writer.append("NaN");
+  else
+    writer.appendFloat(value, decimals);
+  writer.append("\n");
+}
+
+static void metric_uint(ResponseWriter &writer, uint32_t value)
+{
+  writer.appendUInt(value);
+  writer.append("\n");
+}
+
+void WebInterface::writeMetrics(ResponseWriter &writer)
+{
+  SystemSnapshot_t state;
+  SystemState::read(state);
+  WaterControl *water_control = WaterControl::getInstance();
+
+  metric_family(writer, "silvia_power", "gauge", "Machine switched on.");
+  metric_sample(writer, "silvia_power", nullptr, nullptr);
+  metric_uint(writer, state.power ? 1 : 0);
+
+  metric_family(writer, "silvia_temperature_celsius", "gauge", "Temperatures, water is the observer estimate.");
+  metric_sample(writer, "silvia_temperature_celsius", "sensor", "top");
+  metric_float(writer, SensorsHandler::getTempBoilerTop(), 2);
+  metric_sample(writer, "silvia_temperature_celsius", "sensor", "side");
+  metric_float(writer, SensorsHandler::getTempBoilerSide(), 2);
+  metric_sample(writer, "silvia_temperature_celsius", "sensor", "brewhead");
+  metric_float(writer, SensorsHandler::getTempBrewhead(), 2);
+  metric_sample(writer, "silvia_temperature_celsius", "sensor", "water");
+  metric_float(writer, state.temp_water, 2);
+
+  metric_family(writer, "silvia_target_celsius", "gauge", "PID setpoint.");
+  metric_sample(writer, "silvia_target_celsius", nullptr, nullptr);
+  metric_float(writer, state.target, 1);
+
+  metric_family(writer, "silvia_pid_share", "gauge", "Heater share of the PID terms in percent.");
+  metric_sample(writer, "silvia_pid_share", "term", "p");
+  metric_float(writer, state.p_share, 3);
+  metric_sample(writer, "silvia_pid_share", "term", "i");
+  metric_float(writer, state.i_share, 3);
+  metric_sample(writer, "silvia_pid_share", "term", "d");
+  metric_float(writer, state.d_share, 3);
+  metric_sample(writer, "silvia_pid_share", "term", "ff");
+  metric_float(writer, state.ff_share, 3);
+
+  metric_family(writer, "silvia_pid_regime", "stateset", "Active regime of the gain schedule.");
+  for (uint32_t n = 0; n < PID_REGIME_COUNT; n++)
+  {
+    metric_sample(writer, "silvia_pid_regime", "silvia_pid_regime", PIDHeater::getRegimeName((PID_Regime_t)n));
+    metric_uint(writer, state.regime == n ? 1 : 0);
+  }
+
+  metric_family(writer, "silvia_water_state", "stateset", "Water control state.");
+  for (uint32_t n = WATERCTRL_OFF; n <= WATERCTRL_STEAM; n++)
+  {
+    metric_sample(writer, "silvia_water_state", "silvia_water_state", WaterControl::getStateName((WATERCTRL_State_t)n));
+    metric_uint(writer, state.water_state == n ? 1 : 0);
+  }
+
+  metric_family(writer, "silvia_duty_percent", "gauge", "SSR duty.");
+  metric_sample(writer, "silvia_duty_percent", "ssr", "heater");
+  metric_uint(writer, state.heater_percent);
+  metric_sample(writer, "silvia_duty_percent", "ssr", "pump");
+  metric_uint(writer, state.pump_percent);
+
+  if (water_control != nullptr)
+  {
+    ShotTiming_t timing;
+    water_control->getShot()->getTiming(timing);
+
+    metric_family(writer, "silvia_shot_seconds", "gauge", "Time of the running or last shot.");
+    metric_sample(writer, "silvia_shot_seconds", nullptr, nullptr);
+    metric_float(writer, water_control->getShotTime() / 1000.0f, 3);
+
+    metric_family(writer, "silvia_shots", "counter", "Shots since boot.");
+    metric_sample(writer, "silvia_shots_total", nullptr, nullptr);
+    metric_uint(writer, timing.shots);
+
+    metric_family(writer, "silvia_pid_steps", "counter", "PID steps since boot.");
+    metric_sample(writer, "silvia_pid_steps_total", nullptr, nullptr);
+    metric_uint(writer, water_control->getBoilerPID()->getSteps());
+  }
+
+  if (SSRScheduler::getInstance() != nullptr)
+  {
+    SSRScheduler *ssr = SSRScheduler::getInstance();
+
+    metric_family(writer, "silvia_half_cycles", "counter", "Mains half-cycles scheduled since boot.");
+    metric_sample(writer, "silvia_half_cycles_total", nullptr, nullptr);
+    metric_uint(writer, ssr->getHalfCycles());
+
+    metric_family(writer, "silvia_heater_half_cycles", "counter", "Half-cycles with the heater on since boot.");
+    metric_sample(writer, "silvia_heater_half_cycles_total", nullptr, nullptr);
+    metric_uint(writer, ssr->getHeaterHalfCycles());
+  }
+
+  metric_family(writer, "silvia_wifi_reconnects", "counter", "WiFi reconnect attempts.");
+  metric_sample(writer, "silvia_wifi_reconnects_total", nullptr, nullptr);
+  metric_uint(writer, wifi_reconnects_);
+
+  metric_family(writer, "silvia_http_errors", "counter", "Failed HTTP requests, sent and received.");
+  metric_sample(writer, "silvia_http_errors_total", "kind", "influx");
+  metric_uint(writer, influx_errors_);
+  metric_sample(writer, "silvia_http_errors_total", "kind", "not_found");
+  metric_uint(writer, not_found_);
+  metric_sample(writer, "silvia_http_errors_total", "kind", "rejected");
+  metric_uint(writer, api_rejected);
+  metric_sample(writer, "silvia_http_errors_total", "kind", "busy");
+  metric_uint(writer, response_busy);
+
+  uint32_t buffered, sent, dropped;
+  portENTER_CRITICAL(&telemetry_mux);
+  buffered = telemetry.getCount();
+  sent = telemetry_sent;
+  dropped = telemetry.getDropped();
+  portEXIT_CRITICAL(&telemetry_mux);
+
+  metric_family(writer, "silvia_telemetry_buffered_points", "gauge", "Telemetry points waiting to be sent.");
+  metric_sample(writer, "silvia_telemetry_buffered_points", nullptr, nullptr);
+  metric_uint(writer, buffered);
+
+  metric_family(writer, "silvia_telemetry_points", "counter", "Telemetry points sent or dropped with a full ring.");
+  metric_sample(writer, "silvia_telemetry_points_total", "result", "sent");
+  metric_uint(writer, sent);
+  metric_sample(writer, "silvia_telemetry_points_total", "result", "dropped");
+  metric_uint(writer, dropped);
+
+  metric_family(writer, "silvia_ws_messages", "counter", "Live state messages pushed to the page.");
+  metric_sample(writer, "silvia_ws_messages_total", "result", "sent");
+  metric_uint(writer, pushed_);
+  metric_sample(writer, "silvia_ws_messages_total", "result", "dropped");
+  metric_uint(writer, dropped_);
+
+  metric_family(writer, "silvia_heap_free_bytes", "gauge", "Free heap.");
+  metric_sample(writer, "silvia_heap_free_bytes", "block", "total");
+  metric_uint(writer, ESP.getFreeHeap());
+  metric_sample(writer, "silvia_heap_free_bytes", "block", "largest");
+  metric_uint(writer, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+  // stack units are bytes on the ESP32
+  metric_family(writer, "silvia_task_stack_free_bytes", "gauge", "Lowest free stack of each task since its start.");
+  for (uint32_t n = 0; n < sizeof(metrics_tasks) / sizeof(metrics_tasks[0]); n++)
+  {
+    TaskHandle_t task = xTaskGetHandle(metrics_tasks[n]);
+    if (task == nullptr)
+      continue;
+    metric_sample(writer, "silvia_task_stack_free_bytes", "task", metrics_tasks[n]);
+    metric_uint(writer, uxTaskGetStackHighWaterMark(task));
+  }
+
+  metric_family(writer, "silvia_uptime_seconds", "gauge", "Time since boot.");
+  metric_sample(writer, "silvia_uptime_seconds", nullptr, nullptr);
+  metric_uint(writer, millis() / 1000);
+
+  writer.append("# EOF\n");
 }
 
 void WebInterface::task_http_wrapper(void *arg)
@@ -148,34 +517,164 @@ void WebInterface::task_http()
   Serial.println("IP address: ");
   Serial.println(WiFi.localIP());
 
-  // FIXME: this crashes?? SPIFFS seems to conflict with hardware timers!
-  // server_.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html").setTemplateProcessor(processor_static);
-  // this alternative just crashes less/same :(
-  // route for root / web page
-  // server_.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-  //   request->send(SPIFFS, "/index.html", String(), false, processor_static);
-  // });
-  // it works with the html in flash
-  server_.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send_P(200, "text/html", HTML_CODE, processor_static);
-  });
-  
-  // route to load style.css file
-  // server_.on("/style.css", HTTP_GET, [](AsyncWebServerRequest *request) {
-  //   request->send(SPIFFS, "/style.css", "text/css");
-  // });
-  server_.on("/style.css", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send_P(200, "text/css", CSS_CODE);
-  });
+  // unix time for the telemetry timestamps, kept in sync in the background
+  configTime(0, 0, TELEMETRY_NTP_SERVER);
+
+  // static page and style sheet: pre-compressed in flash, revalidated with their ETag.
+  // all values are filled in by the page from /ws, so nothing is rendered per request.
+  for (const WebAsset_t &asset : web_assets)
+  {
+    const WebAsset_t *a = &asset;
+    server_.on(a->path, HTTP_GET, [a](AsyncWebServerRequest *request) {
+      if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == a->etag)
+      {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", a->etag);
+        response->addHeader("Cache-Control", a->cache);
+        request->send(response);
+        return;
+      }
+      // every browser accepts gzip
+      AsyncWebServerResponse *response = request->beginResponse_P(200, a->type, a->data, a->length);
+      response->addHeader("Content-Encoding", "gzip");
+      response->addHeader("ETag", a->etag);
+      response->addHeader("Cache-Control", a->cache);
+      request->send(response);
+    });
+  }
 
   // route to update values
   // server_.on("/update_readings", HTTP_GET, [](AsyncWebServerRequest *request) {
   //   request->send(SPIFFS, "/readings.xml", "text/xml", false, processor_xml);
   // });
   server_.on("/update_readings", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send_P(200, "text/xml", XML_CODE, processor_xml);
+    // one snapshot for all placeholders of this response
+    SystemSnapshot_t state;
+    SystemState::read(state);
+    char *buffer = response_buffer(request, response_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, RESPONSE_BUFFER_SIZE);
+    xml_template.render(writer, fill_xml, &state);
+    request->send_P(200, "text/xml", (const uint8_t *)writer.c_str(), writer.length());
+  });
+
+  // live state push, replaces polling /update_readings
+  ws_.onEvent(&WebInterface::wsEvent);
+  server_.addHandler(&ws_);
+
+  // push period of the live state, e.g. /ws/period?ms=100
+  server_.on("/ws/period", HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (!request->hasParam("ms"))
+    {
+      request->send(400, "text/plain", "ms missing");
+      return;
+    }
+    uint32_t period = request->getParam("ms")->value().toInt();
+    if (period < SENSORS_PERIOD_ACTIVE_MS || period > 10000)
+    {
+      request->send(400, "text/plain", "period out of range");
+      return;
+    }
+    instance->push_period_ms_ = period;
+    request->send(200);
   });
 
+  // machine readable state, e.g. for monitoring
+  server_.on("/api/state", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char *buffer = response_buffer(request, response_pool);
+    if (buffer == nullptr)
+      return;
+    SystemSnapshot_t state;
+    SystemState::read(state);
+    refresh_state(state);
+    ResponseWriter writer(buffer, RESPONSE_BUFFER_SIZE);
+    JsonWriter json(writer);
+    write_state_json(json, state);
+    if (writer.overflow())
+    {
+      request->send(500);
+      return;
+    }
+    request->send_P(200, "application/json", (const uint8_t *)writer.c_str(), writer.length());
+  });
+
+  // brew temperature, e.g. {"temp": 93.5}
+  server_.on("/api/setpoint", HTTP_POST, [](AsyncWebServerRequest *request) {
+    const char *body = (const char *)request->_tempObject;
+    float temp;
+    if (body == nullptr || !json_get_float(body, "temp", temp))
+      send_json_result(request, 400, "temp missing");
+    else if (!WaterControl::getInstance()->setBrewTemp(temp))
+      send_json_result(request, 400, "temp out of range");
+    else
+      send_json_result(request, 200, nullptr);
+  }, nullptr, collect_body);
+
+  // water mode like the switches, e.g. {"mode": "steam"} - holds until a switch is moved
+  server_.on("/api/mode", HTTP_POST, [](AsyncWebServerRequest *request) {
+    const char *body = (const char *)request->_tempObject;
+    char name[16];
+    if (body == nullptr || !json_get_string(body, "mode", name, sizeof(name)))
+    {
+      send_json_result(request, 400, "mode missing");
+      return;
+    }
+    uint32_t mode;
+    for (mode = WATERCTRL_OFF; mode <= WATERCTRL_STEAM; mode++)
+      if (strcmp(name, WaterControl::getStateName((WATERCTRL_State_t)mode)) == 0)
+        break;
+    if (mode > WATERCTRL_STEAM)
+      send_json_result(request, 400, "unknown mode");
+    else if (!HWInterface::getInstance()->setRemoteMode((WATERCTRL_State_t)mode))
+      send_json_result(request, 409, "powered off");
+    else
+      send_json_result(request, 200, nullptr);
+  }, nullptr, collect_body);
+
+  // shot profile upload and selection, e.g. {"slot": 1, "profile": "hold 100 200\n...", "select": true}
+  // without a profile the slot is selected
+  server_.on("/api/profile", HTTP_POST, [](AsyncWebServerRequest *request) {
+    const char *body = (const char *)request->_tempObject;
+    Shot *shot = WaterControl::getInstance()->getShot();
+    char text[SHOT_SEGMENTS_MAX * 64];
+    uint32_t slot;
+    bool select = true;
+    if (body == nullptr || !json_get_uint(body, "slot", slot))
+    {
+      send_json_result(request, 400, "slot missing");
+      return;
+    }
+    if (slot >= SHOT_PROFILE_SLOTS)
+    {
+      send_json_result(request, 400, "invalid slot");
+      return;
+    }
+
+    if (json_get_string(body, "profile", text, sizeof(text)))
+    {
+      ShotProfile_t profile;
+      const char *error = "";
+      if (!shot_profile_parse(text, profile, &error))
+      {
+        send_json_result(request, 400, error);
+        return;
+      }
+      if (!shot->setProfile(slot, profile))
+      {
+        send_json_result(request, 400, "invalid slot");
+        return;
+      }
+      select = false;
+      json_get_bool(body, "select", select);
+    }
+
+    if (select && !shot->selectProfile(slot))
+      send_json_result(request, 400, "invalid or empty slot");
+    else
+      send_json_result(request, 200, nullptr);
+  }, nullptr, collect_body);
+
   // route to power on machine
   server_.on("/on", HTTP_POST, [](AsyncWebServerRequest *request) {
     HWInterface::getInstance()->powerOn();
@@ -200,9 +699,474 @@ void WebInterface::task_http()
     WaterControl::getInstance()->overridePump(100, PUMP_OVERRIDE_MS);
   });
 
+  // stream the compressed history as CSV, optional range: /history?from=<ms>&to=<ms>
+  server_.on("/history", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (History::getInstance() == nullptr)
+    {
+      request->send(503);
+      return;
+    }
+
+    uint32_t from_ms = 0;
+    uint32_t to_ms = UINT32_MAX;
+    if (request->hasParam("from"))
+      from_ms = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+    if (request->hasParam("to"))
+      to_ms = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+
+    // decoded chunk by chunk - the history is never unpacked into RAM
+    std::shared_ptr<History::Cursor_t> cursor = std::make_shared<History::Cursor_t>();
+    History::getInstance()->beginCursor(*cursor, from_ms, to_ms);
+    request->send(request->beginChunkedResponse("text/csv", [cursor](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      if (max_len < History::LINE_MAX)
+        return RESPONSE_TRY_AGAIN;
+      return History::getInstance()->read(*cursor, buffer, max_len);
+    }));
+  });
+
+  // relay autotune around the setpoint, optional: /autotune/start?setpoint=<deg-C>
+  server_.on("/autotune/start", HTTP_POST, [](AsyncWebServerRequest *request) {
+    float setpoint = WaterControl::getInstance()->getBrewTemp();
+    if (request->hasParam("setpoint"))
+      setpoint = request->getParam("setpoint")->value().toFloat();
+
+    if (WaterControl::getInstance()->getBoilerPID()->startAutotune(setpoint))
+      request->send(200);
+    else
+      request->send(409, "text/plain", "autotune needs the heater running and a valid setpoint");
+  });
+
+  server_.on("/autotune/stop", HTTP_POST, [](AsyncWebServerRequest *request) {
+    WaterControl::getInstance()->getBoilerPID()->stopAutotune();
+    request->send(200);
+  });
+
+  // state and candidate gains of the last autotune run
+  server_.on("/autotune", HTTP_GET, [](AsyncWebServerRequest *request) {
+    static const char *state_names[] = {"idle", "heat-up", "relay", "done", "aborted"};
+    static const char *abort_names[] = {"none", "user", "overtemperature", "sensor", "timeout", "no switch", "disturbance"};
+    RelayAutotune *autotune = WaterControl::getInstance()->getBoilerPID()->getAutotune();
+    char *buffer = response_buffer(request, page_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, PAGE_BUFFER_SIZE);
+
+    writer.append("state: ");
+    writer.append(state_names[autotune->getState()]);
+    writer.append("\n");
+    if (autotune->getState() == AUTOTUNE_ABORTED)
+    {
+      writer.append("abort reason: ");
+      writer.append(abort_names[autotune->getAbortReason()]);
+      writer.append("\n");
+    }
+    writer.append("setpoint: ");
+    writer.appendFloat(autotune->getConfig().setpoint, 2);
+    writer.append(" deg-C\ncycles: ");
+    writer.appendUInt(autotune->getCycles());
+    writer.append("\n");
+
+    if (autotune->getState() == AUTOTUNE_DONE)
+    {
+      const AutotuneResult_t &result = autotune->getResult();
+      writer.append("Ku: ");
+      writer.appendFloat(result.ku, 2);
+      writer.append(" %/deg-C\nPu: ");
+      writer.appendFloat(result.pu, 2);
+      writer.append(" s\nturn time: ");
+      writer.appendFloat(result.turn_time, 2);
+      writer.append(" s\namplitude: ");
+      writer.appendFloat(result.amplitude, 2);
+      writer.append(" deg-C\nclassic PID:      P ");
+      writer.appendFloat(result.classic.p, 2);
+      writer.append(" I ");
+      writer.appendFloat(result.classic.i, 2);
+      writer.append(" D ");
+      writer.appendFloat(result.classic.d, 2);
+      writer.append("\nno overshoot PID: P ");
+      writer.appendFloat(result.no_overshoot.p, 2);
+      writer.append(" I ");
+      writer.appendFloat(result.no_overshoot.i, 2);
+      writer.append(" D ");
+      writer.appendFloat(result.no_overshoot.d, 2);
+      writer.append("\nPI:               P ");
+      writer.appendFloat(result.pi.p, 2);
+      writer.append(" I ");
+      writer.appendFloat(result.pi.i, 2);
+      writer.append("\n");
+    }
+    send_page(request, writer);
+  });
+
+  // gain schedule: one line per regime
+  server_.on("/pid/gains", HTTP_GET, [](AsyncWebServerRequest *request) {
+    PIDHeater *pid = WaterControl::getInstance()->getBoilerPID();
+    char *buffer = response_buffer(request, page_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, PAGE_BUFFER_SIZE);
+
+    writer.append("active: ");
+    writer.append(PIDHeater::getRegimeName(pid->getRegime()));
+    writer.append("\n");
+    for (uint32_t r = 0; r < PID_REGIME_COUNT; r++)
+    {
+      PIDGains_t gains;
+      pid->getRegimeGains((PID_Regime_t)r, gains);
+      writer.append(PIDHeater::getRegimeName((PID_Regime_t)r));
+      writer.append(": P+ = ");
+      writer.appendFloat(gains.p_pos, 2);
+      writer.append(" P- = ");
+      writer.appendFloat(gains.p_neg, 2);
+      writer.append(" I = ");
+      writer.appendFloat(gains.i, 2);
+      writer.append(" D = ");
+      writer.appendFloat(gains.d, 2);
+      writer.append(" min = ");
+      writer.appendFloat(gains.out_min, 2);
+      writer.append(" max = ");
+      writer.appendFloat(gains.out_max, 2);
+      writer.append("\n");
+    }
+    send_page(request, writer);
+  });
+
+  // load gains of one regime, e.g. /pid/gains?regime=steam&p_pos=40&i=1.5 - missing values are kept
+  server_.on("/pid/gains", HTTP_POST, [](AsyncWebServerRequest *request) {
+    PIDHeater *pid = WaterControl::getInstance()->getBoilerPID();
+    if (!request->hasParam("regime"))
+    {
+      request->send(400, "text/plain", "regime missing");
+      return;
+    }
+
+    String name = request->getParam("regime")->value();
+    uint32_t r;
+    for (r = 0; r < PID_REGIME_COUNT; r++)
+      if (name == PIDHeater::getRegimeName((PID_Regime_t)r))
+        break;
+    if (r == PID_REGIME_COUNT)
+    {
+      request->send(400, "text/plain", "unknown regime");
+      return;
+    }
+
+    PIDGains_t gains;
+    pid->getRegimeGains((PID_Regime_t)r, gains);
+    if (request->hasParam("p_pos"))
+      gains.p_pos = request->getParam("p_pos")->value().toFloat();
+    if (request->hasParam("p_neg"))
+      gains.p_neg = request->getParam("p_neg")->value().toFloat();
+    if (request->hasParam("i"))
+      gains.i = request->getParam("i")->value().toFloat();
+    if (request->hasParam("d"))
+      gains.d = request->getParam("d")->value().toFloat();
+    if (request->hasParam("min"))
+      gains.out_min = request->getParam("min")->value().toFloat();
+    if (request->hasParam("max"))
+      gains.out_max = request->getParam("max")->value().toFloat();
+
+    if (pid->setRegimeGains((PID_Regime_t)r, gains))
+      request->send(200);
+    else
+      request->send(400, "text/plain", "invalid gains or limits");
+  });
+
+  // last regime switches, newest first
+  server_.on("/pid/regimes", HTTP_GET, [](AsyncWebServerRequest *request) {
+    PIDRegimeSwitch_t log[PID_SWITCH_LOG_SIZE];
+    uint32_t count = WaterControl::getInstance()->getBoilerPID()->getSwitchLog(log, PID_SWITCH_LOG_SIZE);
+    char *buffer = response_buffer(request, page_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, PAGE_BUFFER_SIZE);
+
+    for (uint32_t n = 0; n < count; n++)
+    {
+      writer.appendUInt(log[n].time_ms);
+      writer.append(" ms: ");
+      writer.append(PIDHeater::getRegimeName(log[n].from));
+      writer.append(" -> ");
+      writer.append(PIDHeater::getRegimeName(log[n].to));
+      writer.append(" at ");
+      writer.appendFloat(log[n].pv, 2);
+      writer.append(" deg-C, u = ");
+      writer.appendFloat(log[n].u, 2);
+      writer.append("\n");
+    }
+    send_page(request, writer);
+  });
+
+  // sub-paths first - a handler also takes the paths below its own
+  // text form of one profile, e.g. /profiles/get?slot=1
+  server_.on("/profiles/get", HTTP_GET, [](AsyncWebServerRequest *request) {
+    ShotProfile_t profile;
+    uint32_t slot = request->hasParam("slot") ? request->getParam("slot")->value().toInt() : 0;
+    if (!WaterControl::getInstance()->getShot()->getProfile(slot, profile))
+    {
+      request->send(404, "text/plain", "empty slot");
+      return;
+    }
+    char *buffer = response_buffer(request, page_pool);
+    if (buffer == nullptr)
+      return;
+    size_t length = shot_profile_format(profile, buffer, PAGE_BUFFER_SIZE);
+    if (length >= PAGE_BUFFER_SIZE)
+    {
+      Serial.println("WebInterface ERROR page buffer too small");
+      request->send(500);
+      return;
+    }
+    request->send_P(200, "text/plain", (const uint8_t *)buffer, length);
+  });
+
+  // profile of the next shot, e.g. /profiles/select?slot=1
+  server_.on("/profiles/select", HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (request->hasParam("slot") && WaterControl::getInstance()->getShot()->selectProfile(request->getParam("slot")->value().toInt()))
+      request->send(200);
+    else
+      request->send(400, "text/plain", "invalid or empty slot");
+  });
+
+  // shot profiles, the selected one and the timing of the last shot
+  server_.on("/profiles", HTTP_GET, [](AsyncWebServerRequest *request) {
+    Shot *shot = WaterControl::getInstance()->getShot();
+    char *buffer = response_buffer(request, page_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, PAGE_BUFFER_SIZE);
+
+    writer.append("selected: ");
+    writer.appendUInt(shot->getSelectedProfile());
+    writer.append("\n");
+    for (uint32_t slot = 0; slot < SHOT_PROFILE_SLOTS; slot++)
+    {
+      ShotProfile_t profile;
+      writer.appendUInt(slot);
+      if (shot->getProfile(slot, profile))
+      {
+        writer.append(": ");
+        writer.append(profile.name);
+        writer.append(", ");
+        writer.appendUInt(profile.count);
+        writer.append(" segments\n");
+      }
+      else
+        writer.append(": empty\n");
+    }
+
+    ShotTiming_t timing;
+    shot->getTiming(timing);
+    writer.append("shots: ");
+    writer.appendUInt(timing.shots);
+    writer.append(" max segment start error: ");
+    writer.appendUInt(timing.error_max_us);
+    writer.append(" us\ntask latency max: ");
+    writer.appendUInt(timing.latency_max_us);
+    writer.append(" us, late: ");
+    writer.appendUInt(timing.late);
+    writer.append(", timeouts: ");
+    writer.appendUInt(timing.timeouts);
+    writer.append("\n");
+    send_page(request, writer);
+  });
+
+  // upload a profile in text form, e.g. /profiles?slot=1 with form field profile
+  server_.on("/profiles", HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (!request->hasParam("slot") || !request->hasParam("profile", true))
+    {
+      request->send(400, "text/plain", "slot or profile missing");
+      return;
+    }
+
+    ShotProfile_t profile;
+    const char *error = "";
+    if (!shot_profile_parse(request->getParam("profile", true)->value().c_str(), profile, &error))
+    {
+      request->send(400, "text/plain", error);
+      return;
+    }
+    if (WaterControl::getInstance()->getShot()->setProfile(request->getParam("slot")->value().toInt(), profile))
+      request->send(200);
+    else
+      request->send(400, "text/plain", "invalid slot");
+  });
+
+  // events of the last shot with us timestamps
+  server_.on("/shot/timeline", HTTP_GET, [](AsyncWebServerRequest *request) {
+    static const char *names[] = {"start", "segment", "done", "stop"};
+    ShotEvent_t events[SHOT_EVENTS_MAX];
+    uint32_t count = WaterControl::getInstance()->getShot()->getTimeline(events, SHOT_EVENTS_MAX);
+    char *buffer = response_buffer(request, page_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, PAGE_BUFFER_SIZE);
+
+    for (uint32_t n = 0; n < count; n++)
+    {
+      writer.appendUInt(events[n].time_us);
+      writer.append(" us: ");
+      writer.append(names[events[n].type]);
+      if (events[n].type == SHOT_EVENT_SEGMENT)
+      {
+        writer.append(" ");
+        writer.appendUInt(events[n].segment);
+        writer.append(" error ");
+        writer.appendInt(events[n].error_us);
+        writer.append(" us");
+      }
+      writer.append(" pump ");
+      writer.appendUInt(events[n].pump);
+      writer.append("%\n");
+    }
+    send_page(request, writer);
+  });
+
+  // sensor sampling statistics
+  server_.on("/stats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    SensorsHandler *sensors = SensorsHandler::getInstance();
+    if (sensors == nullptr)
+    {
+      request->send(503);
+      return;
+    }
+
+    static const char *rate_names[SENSORS_RATE_COUNT] = {"active", "idle", "off"};
+    SensorsStats_t stats;
+    sensors->getStats(stats);
+    uint32_t cycles_per_ms = ESP.getCpuFreqMHz() * 1000;
+
+    char *buffer = response_buffer(request, page_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, PAGE_BUFFER_SIZE);
+
+    writer.append("sensor rate: ");
+    writer.append(rate_names[sensors->getRate()]);
+    writer.append(" (");
+    writer.appendUInt(SensorsHandler::getPeriodMs(sensors->getRate()));
+    writer.append(" ms)\n");
+    for (uint32_t i = 0; i < SENSORS_RATE_COUNT; i++)
+    {
+      writer.append(rate_names[i]);
+      writer.append(": ");
+      writer.appendUInt(stats.time_ms[i] / 1000);
+      writer.append(" s, ");
+      writer.appendUInt(stats.wakeups[i]);
+      writer.append(" wakeups, ");
+      writer.appendUInt((uint32_t)(stats.busy_cycles[i] / cycles_per_ms));
+      writer.append(" ms busy\n");
+    }
+    writer.append("rate changes: ");
+    writer.appendUInt(stats.rate_changes);
+    writer.append("\nsaved vs. full rate: ");
+    writer.appendUInt(stats.wakeups_saved);
+    writer.append(" wakeups, ");
+    writer.appendUInt((uint32_t)(stats.cycles_saved / cycles_per_ms));
+    writer.append(" ms cpu\n");
+
+    if (WaterControl::getInstance() != nullptr)
+    {
+      PIDHeater *pid = WaterControl::getInstance()->getBoilerPID();
+      writer.append("pid steps: ");
+      writer.appendUInt(pid->getSteps());
+      writer.append(", sample age ");
+      writer.appendUInt(pid->getSampleAgeUs());
+      writer.append(" us (max ");
+      writer.appendUInt(pid->getSampleAgeMaxUs());
+      writer.append(" us)\n");
+    }
+
+    if (ZeroCross::getInstance() != nullptr)
+    {
+      ZeroCross *zc = ZeroCross::getInstance();
+      MainsStats_t mains;
+      zc->getStats(mains);
+      writer.append("mains: ");
+      writer.append(zc->isDetached() ? "input detached, " : zc->isLocked() ? "locked, " : "free-running, ");
+      writer.appendUInt(zc->getFrequency());
+      writer.append(" Hz, half-cycle ");
+      writer.appendUInt(zc->getHalfPeriodUs());
+      writer.append(" us\nzero-cross edges: ");
+      writer.appendUInt(mains.edges);
+      writer.append(", outliers ");
+      writer.appendUInt(mains.outliers);
+      writer.append(", missed ");
+      writer.appendUInt(mains.missed);
+      writer.append(", locks ");
+      writer.appendUInt(mains.locks);
+      writer.append(", losses ");
+      writer.appendUInt(mains.losses);
+      writer.append("\n");
+    }
+
+    if (SSRScheduler::getInstance() != nullptr)
+    {
+      SchedulerStats_t ssr;
+      SSRScheduler::getInstance()->getStats(ssr);
+      writer.append("ssr ticks: ");
+      writer.appendUInt(ssr.ticks);
+      writer.append(", isr avg ");
+      writer.appendUInt(ssr.ticks ? (uint32_t)(ssr.cycles_sum / ssr.ticks) : 0);
+      writer.append(" cycles max ");
+      writer.appendUInt(ssr.cycles_max);
+      writer.append(" cycles, jitter max ");
+      writer.appendUInt(ssr.jitter_max_us);
+      writer.append(" us, syncs ");
+      writer.appendUInt(ssr.syncs);
+      writer.append("\n");
+    }
+
+    writer.append("ws clients: ");
+    writer.appendUInt(instance->ws_.count());
+    writer.append(", period ");
+    writer.appendUInt(instance->push_period_ms_);
+    writer.append(" ms, pushed ");
+    writer.appendUInt(instance->pushed_);
+    writer.append(", dropped ");
+    writer.appendUInt(instance->dropped_);
+    writer.append("\n");
+    send_page(request, writer);
+  });
+
+  server_.on("/stats/reset", HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (SSRScheduler::getInstance() != nullptr)
+      SSRScheduler::getInstance()->resetStats();
+    request->send(200);
+  });
+
+  // pull based monitoring, e.g. for Prometheus
+  server_.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char *buffer = response_buffer(request, metrics_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, METRICS_BUFFER_SIZE);
+    instance->writeMetrics(writer);
+    if (writer.overflow())
+    {
+      Serial.println("WebInterface ERROR metrics buffer too small");
+      request->send(500);
+      return;
+    }
+    request->send_P(200, "application/openmetrics-text; version=1.0.0; charset=utf-8", (const uint8_t *)writer.c_str(), writer.length());
+  });
+
   // respond to GET requests on URL /heap
   server_.on("/heap", HTTP_GET, [](AsyncWebServerRequest *request){
-    request->send(200, "text/plain", "Free heap: " + String(ESP.getFreeHeap()));
+    char *buffer = response_buffer(request, response_pool);
+    if (buffer == nullptr)
+      return;
+    ResponseWriter writer(buffer, RESPONSE_BUFFER_SIZE);
+    writer.append("Free heap: ");
+    writer.appendUInt(ESP.getFreeHeap());
+    writer.append(", largest block: ");
+    writer.appendUInt(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    request->send_P(200, "text/plain", (const uint8_t *)writer.c_str(), writer.length());
+  });
+
+  server_.onNotFound([](AsyncWebServerRequest *request) {
+    instance->not_found_++;
+    request->send(404);
   });
 
   // start webserver
@@ -212,6 +1176,10 @@ void WebInterface::task_http()
   if (task_handle_influx_ == nullptr)
     xTaskCreate(task_influx_wrapper, "task_influx", TaskConfig::WiFi_influx_stacksize, this, TaskConfig::WiFi_influx_priority, &task_handle_influx_);
   
+  // start live state push when WIFI is available
+  if (task_handle_push_ == nullptr)
+    xTaskCreate(task_push_wrapper, "task_push", TaskConfig::WiFi_push_stacksize, this, TaskConfig::WiFi_push_priority, &task_handle_push_);
+
   // start OTA task when WIFI is available
   if (task_handle_ota_ == nullptr)
     xTaskCreate(task_ota_wrapper, "task_ota", TaskConfig::WiFi_ota_stacksize, this, TaskConfig::WiFi_ota_priority, &task_handle_ota_);
@@ -231,97 +1199,201 @@ void WebInterface::task_influx_wrapper(void *arg)
 }
 void WebInterface::task_influx()
 {
-  esp_err_t err = ESP_FAIL;
-  int response_code = 0;
+  static TelemetryBatch batch(telemetry_batch, TELEMETRY_BATCH_SIZE, TELEMETRY_LAYOUT,
+                              TELEMETRY_FLUSH_MS, TELEMETRY_DRAIN_MS, TELEMETRY_BACKOFF_MAX_MS);
+  uint32_t delay_ms = TELEMETRY_FLUSH_MS;
+  TelemetryPoint_t point;
 
-  // sync semaphore
-  if (influx_sem_update == nullptr)
-    influx_sem_update = xSemaphoreCreateBinary();
-  
-  if (influx_sem_update == nullptr)
+  // make sure the config struct is zeroed out
+  std::memset(&http_client_config_, 0, sizeof(http_client_config_));
+
+  // one client for all batches - the connection is kept alive between requests
+  http_client_config_.url = INFLUX_URL;
+  http_client_config_.port = 8086;
+  http_client_config_.method = HTTP_METHOD_POST;
+  http_client_config_.timeout_ms = TELEMETRY_TIMEOUT_MS;
+  http_client_ = esp_http_client_init(&http_client_config_);
+  if (http_client_ == nullptr)
   {
-    Serial.println("influx_sem_update creation failed!!");
+    Serial.println("INFLUX ERROR client init failed");
     return;
   }
+  esp_http_client_set_header(http_client_, "Content-Type", "text/plain");
 
   while(1)
   {
-    // if we had an error or start for the first time, re-init client
-    if (err != ESP_OK || response_code != 204)
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    delay_ms = TELEMETRY_FLUSH_MS;
+
+    // points stay in the ring until the network and the clock are back
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    uint32_t now_ms = systime_ms();
+    if (!WiFi.isConnected() || now.tv_sec < UNIX_TIME_VALID)
+      continue;
+    uint64_t unix_now_ms = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+
+    // as many of the oldest points as fit into one request
+    portENTER_CRITICAL(&telemetry_mux);
+    batch.begin(telemetry.getFirst());
+    portEXIT_CRITICAL(&telemetry_mux);
+
+    while (1)
+    {
+      portENTER_CRITICAL(&telemetry_mux);
+      bool valid = telemetry.get(batch.getEnd(), point);
+      portEXIT_CRITICAL(&telemetry_mux);
+      if (!valid || !batch.add(point, now_ms, unix_now_ms))
+        break;
+    }
+    if (batch.getCount() == 0)
+      continue;
+
+    uint32_t httpclient_start_ms = systime_ms();
+    esp_http_client_set_post_field(http_client_, batch.c_str(), batch.length());
+    esp_err_t err = esp_http_client_perform(http_client_);
+    int response_code = (err == ESP_OK) ? esp_http_client_get_status_code(http_client_) : 0;
+    uint32_t duration_ms = systime_ms() - httpclient_start_ms;
+    delay_ms = batch.sent(response_code == 204, duration_ms);
+
+    if (response_code != 204)
     {
-      // make sure the config struct is zeroed out
-      std::memset(&http_client_config_, 0, sizeof(http_client_config_));
+      if (err != ESP_OK)
+        Serial.println("INFLUX HTTP esp_http_client_perform issue: " + String(esp_err_to_name(err)));
+      else
+        Serial.println("INFLUX HTTP ERROR - response was: " + String(response_code));
+      influx_errors_++;
 
-      // set config for client init
-      http_client_config_.url = INFLUX_URL;
-      http_client_config_.port = 8086;
-      http_client_config_.method = HTTP_METHOD_POST;
-      http_client_config_.timeout_ms = 500;
-      http_client_ = esp_http_client_init(&http_client_config_);
+      // reconnect with the next attempt
+      esp_http_client_close(http_client_);
+      continue;
     }
 
-    if (xSemaphoreTake(influx_sem_update, portMAX_DELAY) == pdTRUE)
+    portENTER_CRITICAL(&telemetry_mux);
+    telemetry.release(batch.getEnd());
+    telemetry_sent += batch.getCount();
+    portEXIT_CRITICAL(&telemetry_mux);
+
+    if (!batch.isFull() && duration_ms > TELEMETRY_TIMEOUT_MS / 2)
+      Serial.println("INFLUX duration longer than expected: " + String(duration_ms));
+  }
+  esp_http_client_cleanup(http_client_);
+}
+
+void WebInterface::sampleTelemetry()
+{
+  static uint32_t last_ms = 0;
+  static bool sampled = false;
+  SystemSnapshot_t state;
+  TelemetryPoint_t point;
+
+  if (!SystemState::read(state))
+    return;
+  // called once per PID step - half a step of jitter is still the next point
+  if (sampled && state.time_ms - last_ms + PID_TS / 2 < TELEMETRY_SAMPLE_MS)
+    return;
+  last_ms = state.time_ms;
+  sampled = true;
+
+  point.time_ms = state.time_ms;
+  point.temp[0] = telemetry_temp(state.temp_top);
+  point.temp[1] = telemetry_temp(state.temp_side);
+  point.temp[2] = telemetry_temp(state.temp_brewhead);
+  point.temp[3] = telemetry_temp(state.temp_avg);
+  point.temp[4] = telemetry_temp(state.temp_water);
+  point.share[0] = telemetry_fixed32(state.p_share);
+  point.share[1] = telemetry_fixed32(state.i_share);
+  point.share[2] = telemetry_fixed32(state.d_share);
+  point.share[3] = telemetry_fixed32(state.ff_share);
+  point.u = telemetry_fixed32(state.u);
+  point.heater = state.heater_percent;
+  point.pump = state.pump_percent;
+  point.regime = state.regime;
+  point.water_state = state.water_state;
+
+  portENTER_CRITICAL(&telemetry_mux);
+  telemetry.push(point);
+  portEXIT_CRITICAL(&telemetry_mux);
+}
+
+// runs in the async_tcp task
+void WebInterface::wsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  if (type == WS_EVT_CONNECT)
+  {
+    bool added = false;
+
+    portENTER_CRITICAL(&ws_mux);
+    for (uint32_t n = 0; n < WS_CLIENTS_MAX && !added; n++)
     {
-      if (WiFi.isConnected())
+      if (instance->ws_clients_[n] == 0)
       {
-        uint32_t httpclient_start_ms = systime_ms();
-
-        // re-set client for next request
-        esp_http_client_set_url(http_client_, INFLUX_URL);
-        esp_http_client_set_method(http_client_, HTTP_METHOD_POST);
-        esp_http_client_set_header(http_client_, "Content-Type", "application/json");
-
-        String data = "";
-        data += "temperature,pos=top value=" + String(SensorsHandler::getTempBoilerTop()) + "\n";
-        data += "temperature,pos=side value=" + String(SensorsHandler::getTempBoilerSide()) + "\n";
-        data += "temperature,pos=brewhead value=" + String(SensorsHandler::getTempBrewhead()) + "\n";
-        data += "temperature,pos=avg value=" + String(SensorsHandler::getTempBoilerAvg()) + "\n";
-
-        data += "power,device=heater value=" + String(SSRHeater::getInstance()->getPWM()) + "\n";
-        data += "power,device=pump value=" + String(SSRPump::getInstance()->getPWM()) + "\n";
-
-        data += "pid,part=p value=" + String(WaterControl::getInstance()->getBoilerPID()->getPShare()) + "\n";
-        data += "pid,part=i value=" + String(WaterControl::getInstance()->getBoilerPID()->getIShare()) + "\n";
-        data += "pid,part=d value=" + String(WaterControl::getInstance()->getBoilerPID()->getDShare()) + "\n";
-        data += "pid,part=u value=" + String(WaterControl::getInstance()->getBoilerPID()->getUncorrectedOutput());
-
-        err = esp_http_client_set_post_field(http_client_, data.c_str(), data.length());
-        if (err != ESP_OK)
-        {
-          Serial.println("INFLUX HTTP esp_http_client_set_post_field issue: " + String(esp_err_to_name(err)));
-          esp_http_client_cleanup(http_client_);
-          continue;
-        }
-
-        err = esp_http_client_perform(http_client_);
-        if (err != ESP_OK)
-        {
-          Serial.println("INFLUX HTTP esp_http_client_perform issue: " + String(esp_err_to_name(err)));
-          esp_http_client_cleanup(http_client_);
-          continue;
-        }
-
-        response_code = esp_http_client_get_status_code(http_client_);
-        if (response_code != 204)
-        {
-          Serial.println("INFLUX HTTP ERROR - response was: " + String(response_code));
-          esp_http_client_cleanup(http_client_);
-          continue;
-        }
-
-        // signal, if the operation took longer than expected
-        if (systime_ms() - httpclient_start_ms > 500)
-          Serial.println("INFLUX duration longer than expected: " + String(systime_ms() - httpclient_start_ms));
+        instance->ws_clients_[n] = client->id();
+        added = true;
       }
     }
+    portEXIT_CRITICAL(&ws_mux);
+
+    if (!added)
+      client->close();
+  }
+  else if (type == WS_EVT_DISCONNECT)
+  {
+    portENTER_CRITICAL(&ws_mux);
+    for (uint32_t n = 0; n < WS_CLIENTS_MAX; n++)
+      if (instance->ws_clients_[n] == client->id())
+        instance->ws_clients_[n] = 0;
+    portEXIT_CRITICAL(&ws_mux);
   }
-  esp_http_client_cleanup(http_client_);
 }
 
-void WebInterface::updateInfluxDB()
+void WebInterface::task_push_wrapper(void *arg)
 {
-  if (instance && instance->influx_sem_update)
-    xSemaphoreGive(instance->influx_sem_update);
+  static_cast<WebInterface *>(arg)->task_push();
+}
+// one message buffer shared by all clients, only used by task_push
+static char push_buffer[RESPONSE_BUFFER_SIZE];
+
+void WebInterface::task_push()
+{
+  SystemSnapshot_t state;
+  TickType_t last_wake = xTaskGetTickCount();
+
+  while (1)
+  {
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(push_period_ms_));
+
+    if (ws_.count() == 0 || !SystemState::read(state))
+      continue;
+
+    refresh_state(state);
+
+    // a client that can't keep up would pile up messages in the heap - drop it
+    for (uint32_t n = 0; n < WS_CLIENTS_MAX; n++)
+    {
+      uint32_t id;
+      portENTER_CRITICAL(&ws_mux);
+      id = ws_clients_[n];
+      portEXIT_CRITICAL(&ws_mux);
+
+      if (id != 0 && !ws_.availableForWrite(id))
+      {
+        ws_.close(id);
+        dropped_++;
+      }
+    }
+    ws_.cleanupClients(WS_CLIENTS_MAX);
+
+    // same document as /api/state
+    ResponseWriter writer(push_buffer, sizeof(push_buffer));
+    JsonWriter json(writer);
+    write_state_json(json, state);
+    if (!writer.overflow())
+    {
+      ws_.textAll(writer.c_str(), writer.length());
+      pushed_++;
+    }
+  }
 }
 
 void WebInterface::task_ota_wrapper(void *arg)
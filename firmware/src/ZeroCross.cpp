@@ -0,0 +1,102 @@
+#include "ZeroCross.hpp"
+#include "SSRScheduler.hpp"
+#include "coffee_config.hpp"
+
+static void zerocross_isr(void);
+
+static ZeroCross *instance = nullptr;
+static portMUX_TYPE mains_mux = portMUX_INITIALIZER_UNLOCKED;
+
+ZeroCross::ZeroCross(uint8_t pin, SSRScheduler *scheduler) :
+  pll_(MAINS_FREQUENCY),
+  scheduler_(scheduler),
+  pin_(pin),
+  detached_(false),
+  last_edges_(0),
+  was_locked_(false),
+  timer_supervision_(nullptr)
+{
+  if (instance)
+  {
+    Serial.println("ERROR: more than one ZeroCross generated");
+    ESP.restart();
+    return;
+  }
+  instance = this;
+
+  timer_supervision_ = xTimerCreate("tmr_mains", pdMS_TO_TICKS(100), pdTRUE, this, &ZeroCross::timer_cb_wrapper);
+  if (timer_supervision_ == NULL || xTimerStart(timer_supervision_, portMAX_DELAY) != pdPASS)
+    Serial.println("ZeroCross ERROR init failed");
+
+  pinMode(pin, INPUT);
+  attachInterrupt(pin, &zerocross_isr, RISING);
+}
+
+ZeroCross* ZeroCross::getInstance()
+{
+  return instance;
+}
+
+void ZeroCross::getStats(MainsStats_t &stats)
+{
+  portENTER_CRITICAL(&mains_mux);
+  pll_.getStats(stats);
+  portEXIT_CRITICAL(&mains_mux);
+}
+
+void IRAM_ATTR ZeroCross::edge()
+{
+  uint32_t now = (uint32_t)esp_timer_get_time();
+
+  portENTER_CRITICAL_ISR(&mains_mux);
+  pll_.edge(now);
+  if (pll_.isLocked())
+  {
+    // the scheduler ticks ZEROCROSS_LEAD_US ahead of the zero-cross
+    int32_t since_us = (int32_t)(now - pll_.getPhaseUs()) + ZEROCROSS_LEAD_US;
+    scheduler_->syncMains(since_us, pll_.getHalfPeriodUs());
+  }
+  portEXIT_CRITICAL_ISR(&mains_mux);
+}
+
+void ZeroCross::timer_cb_wrapper(TimerHandle_t arg)
+{
+  static_cast<ZeroCross *>(pvTimerGetTimerID(arg))->timer_cb();
+}
+void ZeroCross::timer_cb()
+{
+  bool locked;
+  uint32_t half_us;
+  MainsStats_t stats;
+
+  portENTER_CRITICAL(&mains_mux);
+  pll_.getStats(stats);
+  pll_.poll((uint32_t)esp_timer_get_time());
+  locked = pll_.isLocked();
+  half_us = pll_.getHalfPeriodUs();
+  if (!locked && was_locked_)
+  {
+    // no edges - free-running at the nominal rate
+    scheduler_->freeRun(half_us);
+  }
+  portEXIT_CRITICAL(&mains_mux);
+
+  // an interrupt storm from a floating input - stop listening, the PLL unlocks
+  if (!detached_ && stats.edges - last_edges_ > ZEROCROSS_EDGES_MAX)
+  {
+    detachInterrupt(pin_);
+    detached_ = true;
+    Serial.println("ZeroCross ERROR too many edges, input detached");
+  }
+  last_edges_ = stats.edges;
+
+  if (locked != was_locked_)
+    Serial.println(locked ? "ZeroCross: locked to " + String(pll_.getFrequency()) + " Hz" : String("ZeroCross: lost mains, free-running"));
+  was_locked_ = locked;
+}
+
+static void IRAM_ATTR zerocross_isr(void)
+{
+  if (instance)
+    instance->edge();
+}
@@ -3,15 +3,23 @@
 #include "HWInterface.hpp"
 #include "WaterControl.hpp"
 #include "WebInterface.hpp"
+#include "History.hpp"
+#include "ZeroCross.hpp"
+#include "SSRScheduler.hpp"
+#include "Timers.hpp"
 #include "Pins.hpp"
 #include "helpers.hpp"
+#include "coffee_config.hpp"
 
 #define CORE_DEBUG_LEVEL 5
 
 HWInterface *hw_interface;
 WaterControl *water_control;
 SensorsHandler *sensors_handler;
+History *history;
 WebInterface *web_interface;
+ZeroCross *zero_cross;
+SSRScheduler *ssr_scheduler;
 
 void setup()
 {
@@ -26,8 +34,12 @@ void setup()
 
   Serial.println("Hi there! Booting now..");
 
+  history = new History();
   sensors_handler = new SensorsHandler();
+  ssr_scheduler = new SSRScheduler(Timers::timer_ssr, MAINS_HALF_PERIOD_US);
   water_control = new WaterControl();
+  if (ZEROCROSS_INPUT)
+    zero_cross = new ZeroCross(Pins::mains_zerocross, ssr_scheduler);
   hw_interface = new HWInterface(water_control);
   web_interface = new WebInterface();
   
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// host benchmark helpers: cpu cycles where the host has a cycle counter,
+// nanoseconds otherwise. the numbers compare implementations on the same
+// host - they are not ESP32 cycles.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_UNIT "cycles"
+static inline uint64_t bench_now()
+{
+  return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t bench_now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+// keeps the compiler from dropping benchmarked results
+static inline void bench_keep(double value)
+{
+  __asm__ volatile("" : : "g"(value) : "memory");
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "coffee_config.hpp"
+#include "PIDKernel.hpp"
+
+// boiler of simulation/python_pid/silvi_sim.py for the host tests, with its
+// constants and hacks: the element ramps up linearly over the dead time and
+// cools down 2.3x faster, the loss term is quartic, a shot draws 0.3 deg-C/s.
+// additions for the firmware side:
+//   - the heater switches per mains half-cycle instead of 0.1 s steps
+//   - top and side probe lag behind the water, silvi_sim reads the water
+//   - probe noise after SensorFilter, deterministic. silvi_sim adds +-0.1 deg-C
+//     to the raw reading, the filter leaves about a fifth of it
+class SilviBoiler
+{
+public:
+  static constexpr double STEP_S = 0.01;          // s - one half-cycle at 50 Hz
+  static constexpr uint32_t STEPS_PER_S = 100;
+  static constexpr double HEATER_POWER = 750.0;   // W
+  static constexpr double HEATER_DEAD = 50.0;     // s
+  static constexpr double CAPACITY = 4182.0 * 0.3;  // J/K
+  static constexpr double LOSS_R = 0.000000000004;
+  static constexpr double TEMP_ENV = 27.0;        // deg-C
+  static constexpr double SHOT_DRAW = 0.3;        // deg-C/s
+  static constexpr double TAU_TOP = 8.0;          // s - OBSERVER_TAU_TOP
+  static constexpr double TAU_SIDE = 5.0;         // s - OBSERVER_TAU_SIDE
+  static constexpr float PROBE_NOISE = 0.02f;     // deg-C - uniform +-
+
+  explicit SilviBoiler(double temp) :
+    water_(temp), element_(0.0), top_(temp), side_(temp), rng_(12345)
+  {
+  }
+
+  // one half-cycle, draw is the share of SHOT_DRAW (pump duty)
+  void step(bool heater_on, double draw)
+  {
+    if (heater_on)
+      element_ = fmin(1.0, element_ + STEP_S / HEATER_DEAD);
+    else
+      element_ = fmax(0.0, element_ - element_ * STEP_S / HEATER_DEAD * 2.3);
+
+    water_ += HEATER_POWER * STEP_S * element_ / CAPACITY;
+    water_ -= LOSS_R * (pow(water_, 4) - pow(TEMP_ENV, 4)) * water_ * STEP_S;
+    water_ -= SHOT_DRAW * draw * STEP_S;
+
+    top_ += (water_ - top_) * STEP_S / TAU_TOP;
+    side_ += (water_ - side_) * STEP_S / TAU_SIDE;
+  }
+
+  double getWater() {return water_;};
+  double getElement() {return element_;};
+  float readTop() {return top_ + noise();};
+  float readSide() {return side_ + noise();};
+  float readWater() {return water_ + noise();};  // what a perfect observer would see
+
+  // heater duty of the controller period, in whole half-cycles at the start of the period
+  static bool heaterOn(float duty_percent, uint32_t step_in_period)
+  {
+    return step_in_period < (uint32_t)lroundf(duty_percent * STEPS_PER_S / 100.0f);
+  }
+
+private:
+  float noise()
+  {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return (rng_ / 4294967296.0f - 0.5f) * 2.0f * PROBE_NOISE;
+  }
+
+  double water_;
+  double element_;
+  double top_;
+  double side_;
+  uint32_t rng_;
+};
+
+
+// the PID type C path of PIDHeater::task with the default gains and its
+// heuristics: fast heat-up override, 5% limit with the pump off, feed-forward
+// and minimum output
+class PIDLoop
+{
+public:
+  PIDLoop(float pv)
+  {
+    kernel_.setGains(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+    kernel_.reset(q16_from_float(pv), 0);
+  }
+
+  // pump in %, returns the heater duty in %
+  float step(float target, float pv, float pump)
+  {
+    float u = q16_to_float(kernel_.step(q16_from_float(target), q16_from_float(pv)));
+    if (target - pv > PID_OVERRIDE_TEMP_ERR)
+      u = PID_OVERRIDE_TEMP;
+    if (pump == 0.0f && u > 5 && pv >= target + 0.5f)
+      u = 5;
+    u = fminf(fmaxf(u, 0.0f), 100.0f);
+    float ff = PID_FF_PUMP * pump;
+    u = fminf(fmaxf(u + ff, 0.0f), 100.0f);
+    kernel_.commit(q16_from_float(pv), q16_from_float(u - ff));
+
+    if (u > 0.0f && u < PID_MIN_OUTPUT)
+      u = PID_MIN_OUTPUT;
+    return u;
+  }
+
+private:
+  PIDKernel kernel_;
+};
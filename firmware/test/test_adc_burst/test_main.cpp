@@ -0,0 +1,215 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <initializer_list>
+#include "ADCSource.hpp"
+#include "../bench.hpp"
+
+// synthetic ADC: every channel is a sine (a slowly changing temperature)
+// plus gaussian noise, sampled at the time of each conversion.
+// calibration is linear, calls are counted.
+class SyntheticADC : public ADCSource
+{
+public:
+  static constexpr uint32_t CHANNELS = 3;
+  static constexpr float CONVERSION_US = 10.0f;  // time per conversion
+
+  SyntheticADC(float noise_counts) :
+    noise_counts_(noise_counts),
+    time_us_(0.0),
+    reads_(0),
+    calibrations_(0),
+    fail_at_(-1),
+    rng_(0x2545f491u)
+  {
+  }
+
+  // noise free value of a channel at a time
+  float ideal(uint32_t channel, double time_us)
+  {
+    return 2000.0f + 300.0f * sinf((float)(time_us * 1e-4) + channel);
+  }
+
+  int32_t readRaw(uint32_t channel) override
+  {
+    if ((int32_t)reads_ == fail_at_)
+      return -1;
+    float raw = ideal(channel, time_us_) + noise_counts_ * gaussian();
+    time_us_ += CONVERSION_US;
+    reads_++;
+    return (int32_t)lrintf(raw);
+  }
+
+  float rawToMillivolts(float raw) override
+  {
+    calibrations_++;
+    return raw * 0.8f + 100.0f;
+  }
+
+  float noise_counts_;
+  double time_us_;  // a float stops counting 10 us steps after ~2 min
+  uint32_t reads_;
+  uint32_t calibrations_;
+  int32_t fail_at_;  // conversion that fails, -1 = none
+
+private:
+  float uniform()
+  {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return (rng_ >> 8) * (1.0f / 16777216.0f);
+  }
+
+  float gaussian()
+  {
+    return sqrtf(-2.0f * logf(uniform() + 1e-7f)) * cosf(6.2831853f * uniform());
+  }
+
+  uint32_t rng_;
+};
+
+static const uint32_t channels[3] = {0, 1, 2};
+
+// variance of the burst results around the ideal value at the burst center
+static float burst_variance(uint32_t oversampling)
+{
+  SyntheticADC adc(8.0f);
+  ADCBurst<3> burst(&adc, channels);
+  float mv[3];
+  double sum_sq = 0.0;
+  uint32_t count = 0;
+
+  for (uint32_t n = 0; n < 5000; n++)
+  {
+    double start = adc.time_us_;
+    TEST_ASSERT_TRUE(burst.acquire(oversampling, mv));
+    double center = (start + adc.time_us_ - SyntheticADC::CONVERSION_US) / 2;
+    for (uint32_t ch = 0; ch < 3; ch++)
+    {
+      float error = mv[ch] - adc.rawToMillivolts(adc.ideal(ch, center));
+      sum_sq += error * error;
+      count++;
+    }
+    adc.time_us_ += 29000.0;  // next sample
+  }
+  return sum_sq / count;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_noise_reduction()
+{
+  float single = burst_variance(1);
+  char text[96];
+
+  for (uint32_t oversampling : {4u, 8u, 16u})
+  {
+    float variance = burst_variance(oversampling);
+    snprintf(text, sizeof(text), "oversampling %u: variance %.2f mV^2, %.1fx less than single conversions",
+             (unsigned)oversampling, variance, single / variance);
+    TEST_MESSAGE(text);
+    // 1/n for white noise, some slack for the rounding to counts
+    TEST_ASSERT_GREATER_OR_EQUAL(0.8f * oversampling, single / variance);
+  }
+}
+
+// channels are interleaved, so all channels describe the same moment
+void test_time_aligned()
+{
+  SyntheticADC adc(0.0f);
+  ADCBurst<3> burst(&adc, channels);
+  float mv[3];
+
+  adc.time_us_ = 12345.0;
+  double start = adc.time_us_;
+  TEST_ASSERT_TRUE(burst.acquire(8, mv));
+  double end = adc.time_us_;
+
+  // the burst average of a smooth signal is its value at the center of the
+  // conversions of that channel - the centers differ by one conversion only
+  for (uint32_t ch = 0; ch < 3; ch++)
+  {
+    double center = (start + end - SyntheticADC::CONVERSION_US * 3) / 2 + ch * SyntheticADC::CONVERSION_US;
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, adc.rawToMillivolts(adc.ideal(ch, center)), mv[ch]);
+  }
+}
+
+void test_calibration_once_per_burst()
+{
+  SyntheticADC adc(4.0f);
+  ADCBurst<3> burst(&adc, channels);
+  float mv[3];
+
+  TEST_ASSERT_TRUE(burst.acquire(16, mv));
+  TEST_ASSERT_EQUAL_UINT32(16 * 3, adc.reads_);
+  TEST_ASSERT_EQUAL_UINT32(3, adc.calibrations_);
+}
+
+void test_failed_conversion()
+{
+  SyntheticADC adc(4.0f);
+  ADCBurst<3> burst(&adc, channels);
+  float mv[3] = {1.0f, 2.0f, 3.0f};
+
+  adc.fail_at_ = 5;
+  TEST_ASSERT_FALSE(burst.acquire(8, mv));
+  // the previous values stay
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, mv[0]);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, mv[1]);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, mv[2]);
+  TEST_ASSERT_EQUAL_UINT32(0, adc.calibrations_);
+}
+
+// cost of the burst itself - the synthetic conversions are measured alone
+// and taken out. both variants alternate over several rounds and the fastest
+// round of each is used, a single difference of two timings is mostly noise
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 5000;
+  static constexpr uint32_t ROUNDS = 25;
+  SyntheticADC adc(4.0f);
+  ADCBurst<3> burst(&adc, channels);
+  float mv[3];
+  double sum = 0.0;
+  uint64_t reads_time = UINT64_MAX, burst_time = UINT64_MAX;
+
+  for (uint32_t round = 0; round < ROUNDS; round++)
+  {
+    uint64_t start = bench_now();
+    for (uint32_t n = 0; n < COUNT * 8 * 3; n++)
+      sum += adc.readRaw(n % 3);
+    uint64_t time = bench_now() - start;
+    if (time < reads_time)
+      reads_time = time;
+
+    start = bench_now();
+    for (uint32_t n = 0; n < COUNT; n++)
+    {
+      burst.acquire(8, mv);
+      sum += mv[0];
+    }
+    time = bench_now() - start;
+    if (time < burst_time)
+      burst_time = time;
+  }
+  bench_keep(sum);
+
+  char text[128];
+  snprintf(text, sizeof(text), "burst of 8x3, min of %u: %.1f " BENCH_UNIT ", conversions alone %.1f, overhead %.1f",
+           (unsigned)ROUNDS, (double)burst_time / COUNT, (double)reads_time / COUNT,
+           ((double)burst_time - reads_time) / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_noise_reduction);
+  RUN_TEST(test_time_aligned);
+  RUN_TEST(test_calibration_once_per_burst);
+  RUN_TEST(test_failed_conversion);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "coffee_config.hpp"
+#include "BoilerObserver.hpp"
+#include "../boiler_sim.hpp"
+
+// closed loop on the silvi_sim.py boiler: warm-up from 80 deg-C, a 30 s shot
+// at 460 s and the cleaning flush 15 s after it - the scenario of silvi_sim.py.
+// the PID step mirrors PIDHeater::task, only the process value differs.
+static constexpr float TARGET = 100.0f;
+static constexpr uint32_t SHOT_START_S = 460;
+static constexpr uint32_t SHOT_END_S = 490;
+static constexpr uint32_t RUN_S = 900;
+static constexpr float SETTLED = 0.5f;  // deg-C - recovered within target +- settled
+
+static const BoilerModel_t model = {
+  OBSERVER_HEATER_POWER,
+  OBSERVER_HEATER_TAU,
+  OBSERVER_CAPACITY,
+  OBSERVER_LOSS,
+  OBSERVER_PUMP_FLOW,
+  OBSERVER_TEMP_AMBIENT,
+  OBSERVER_TEMP_INLET,
+  OBSERVER_TAU_TOP,
+  OBSERVER_TAU_SIDE
+};
+
+typedef struct Result {
+  float warmup_overshoot;  // deg-C above target before the shot
+  float shot_drop;         // deg-C below target
+  float shot_overshoot;    // deg-C above target after the shot
+  float recovery_s;        // after the shot until the water stays within target +- SETTLED
+  float estimate_error;    // deg-C - largest |pv - water| after warm-up
+} Result_t;
+
+static Result_t run(bool observer_pv)
+{
+  static constexpr float TS = PID_TS / 1000.0f;
+  SilviBoiler boiler(80.0);
+  BoilerObserver observer(model, TS);
+  Result_t result = {-100.0f, 0.0f, -100.0f, 0.0f, 0.0f};
+  float heater = 0.0f;
+  float pump = 0.0f;
+
+  float top = boiler.readTop();
+  float side = boiler.readSide();
+  observer.reset((top + side) / 2);
+  PIDLoop pid((top + side) / 2);
+
+  for (uint32_t s = 0; s < RUN_S; s++)
+  {
+    // heater and pump as applied during the last period
+    top = boiler.readTop();
+    side = boiler.readSide();
+    observer.update(heater / 100.0f, pump / 100.0f, top, side);
+
+    float pv;
+    if (observer_pv)
+      pv = observer.getWaterTemp();
+    else if (side > top)
+      pv = side;
+    else
+      pv = (top + side) / 2;
+
+    bool shot = s >= SHOT_START_S && s < SHOT_END_S;
+    bool flush = s >= SHOT_END_S + 15 && s < SHOT_END_S + 25 && boiler.getWater() > TARGET;
+    pump = (shot || flush) ? 100.0f : 0.0f;
+
+    heater = pid.step(TARGET, pv, pump);
+
+    if (s > 200)
+      result.estimate_error = fmaxf(result.estimate_error, fabsf(pv - (float)boiler.getWater()));
+
+    for (uint32_t n = 0; n < SilviBoiler::STEPS_PER_S; n++)
+    {
+      boiler.step(SilviBoiler::heaterOn(heater, n), pump / 100.0f);
+      float water = boiler.getWater();
+      if (s < SHOT_START_S)
+        result.warmup_overshoot = fmaxf(result.warmup_overshoot, water - TARGET);
+      else
+        result.shot_drop = fmaxf(result.shot_drop, TARGET - water);
+      if (s >= SHOT_END_S)
+      {
+        result.shot_overshoot = fmaxf(result.shot_overshoot, water - TARGET);
+        if (fabsf(water - TARGET) > SETTLED)
+          result.recovery_s = s + (n + 1) * SilviBoiler::STEP_S - SHOT_END_S;
+      }
+    }
+  }
+  return result;
+}
+
+static void report(const char *name, const Result_t &r)
+{
+  char text[200];
+  snprintf(text, sizeof(text), "%-8s warm-up overshoot %.2f, shot drop %.2f, after shot overshoot %.2f deg-C, recovery %.0f s, pv error %.2f deg-C",
+           name, r.warmup_overshoot, r.shot_drop, r.shot_overshoot, r.recovery_s, r.estimate_error);
+  TEST_MESSAGE(text);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_tracks_water()
+{
+  SilviBoiler boiler(25.0);
+  BoilerObserver observer(model, 1.0f);
+  float worst_probe = 0.0f;
+  float worst_observer = 0.0f;
+
+  // open loop heat-up at 40%, then a shot - probes lag, the model leads
+  observer.reset(25.0f);
+  for (uint32_t s = 0; s < 600; s++)
+  {
+    float pump = (s >= 400 && s < 430) ? 1.0f : 0.0f;
+    float top = boiler.readTop();
+    float side = boiler.readSide();
+    observer.update(s == 0 ? 0.0f : 0.4f, pump, top, side);
+    if (s > 120)
+    {
+      worst_probe = fmaxf(worst_probe, fabsf((top + side) / 2 - (float)boiler.getWater()));
+      worst_observer = fmaxf(worst_observer, fabsf(observer.getWaterTemp() - (float)boiler.getWater()));
+    }
+    for (uint32_t n = 0; n < SilviBoiler::STEPS_PER_S; n++)
+      boiler.step(SilviBoiler::heaterOn(40.0f, n), pump);
+  }
+
+  char text[96];
+  snprintf(text, sizeof(text), "largest error: probe average %.2f, observer %.2f deg-C", worst_probe, worst_observer);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_LESS_THAN(worst_probe, worst_observer);
+}
+
+void test_invalid_probe()
+{
+  BoilerObserver observer(model, 1.0f);
+
+  // a failed probe (999) is left out, the other one keeps the estimate
+  observer.reset(90.0f);
+  for (uint32_t s = 0; s < 60; s++)
+    observer.update(0.3f, 0.0f, 999.0f, 92.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 92.0f, observer.getWaterTemp());
+}
+
+void test_closed_loop()
+{
+  Result_t probes = run(false);
+  Result_t estimate = run(true);
+
+  report("probes", probes);
+  report("observer", estimate);
+
+  // the estimate leads the probe lag - less overshoot, faster back at the target
+  TEST_ASSERT_LESS_THAN(probes.warmup_overshoot, estimate.warmup_overshoot);
+  TEST_ASSERT_LESS_THAN(probes.shot_overshoot, estimate.shot_overshoot);
+  TEST_ASSERT_LESS_THAN(probes.recovery_s, estimate.recovery_s);
+  TEST_ASSERT_LESS_THAN(probes.estimate_error, estimate.estimate_error);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_tracks_water);
+  RUN_TEST(test_invalid_probe);
+  RUN_TEST(test_closed_loop);
+  return UNITY_END();
+}
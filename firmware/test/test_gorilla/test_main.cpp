@@ -0,0 +1,221 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "Gorilla.hpp"
+#include "../bench.hpp"
+
+// history records (History.hpp): top, side, brewhead, heater, pump
+static constexpr uint32_t CHANNELS = 5;
+static constexpr uint32_t BLOCK_SIZE = 1024;
+static constexpr float TEMP_RESOLUTION = 16.0f;
+
+static uint32_t rng_state = 1;
+
+static uint32_t xorshift()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static float gaussian()
+{
+  float u1 = (xorshift() + 1.0f) / 4294967296.0f;
+  float u2 = xorshift() / 4294967296.0f;
+  return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+// boiler at temperature, sensor noise in deg-C, heater pulses now and then
+static void idle_sample(float noise, float (&values)[CHANNELS])
+{
+  values[0] = roundf((95.0f + noise * gaussian()) * TEMP_RESOLUTION) / TEMP_RESOLUTION;
+  values[1] = roundf((92.0f + noise * gaussian()) * TEMP_RESOLUTION) / TEMP_RESOLUTION;
+  values[2] = roundf((75.0f + noise * gaussian()) * TEMP_RESOLUTION) / TEMP_RESOLUTION;
+  values[3] = (xorshift() % 8 == 0) ? 30.0f : 0.0f;
+  values[4] = 0.0f;
+}
+
+// records per block and the round trip of all of them
+static uint32_t fill_block(float noise, uint32_t period_ms, bool check)
+{
+  static uint8_t block[BLOCK_SIZE];
+  static float expected[BLOCK_SIZE * 8][CHANNELS];
+  GorillaEncoder<CHANNELS> encoder;
+  GorillaDecoder<CHANNELS> decoder;
+  uint32_t count = 0;
+  uint32_t time_ms = 123456;
+
+  encoder.begin(block, BLOCK_SIZE);
+  while (true)
+  {
+    idle_sample(noise, expected[count]);
+    if (!encoder.append(time_ms + count * period_ms, expected[count]))
+      break;
+    count++;
+  }
+  TEST_ASSERT_EQUAL(count, encoder.getCount());
+
+  if (check)
+  {
+    decoder.begin(block);
+    for (uint32_t n = 0; n < count; n++)
+    {
+      uint32_t t;
+      float values[CHANNELS];
+      decoder.next(t, values);
+      TEST_ASSERT_EQUAL(time_ms + n * period_ms, t);
+      TEST_ASSERT_EQUAL_MEMORY(expected[n], values, sizeof(values));
+    }
+  }
+  return count;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_round_trip_exact()
+{
+  static uint8_t block[BLOCK_SIZE];
+  static float expected[512][CHANNELS];
+  static uint32_t times[512];
+  GorillaEncoder<CHANNELS> encoder;
+  GorillaDecoder<CHANNELS> decoder;
+  uint32_t count = 0;
+  uint32_t time_ms = 0xFFFFF000;  // wraps around
+
+  // arbitrary floats and jittered timestamps - nothing quantized
+  encoder.begin(block, BLOCK_SIZE);
+  for (; count < 512; count++)
+  {
+    for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      expected[count][ch] = (ch < 3) ? 100.0f * gaussian() : (float)(xorshift() % 101);
+    time_ms += 20 + xorshift() % 20;
+    times[count] = time_ms;
+    if (!encoder.append(times[count], expected[count]))
+      break;
+  }
+  TEST_ASSERT_GREATER_THAN(10, count);
+
+  decoder.begin(block);
+  for (uint32_t n = 0; n < count; n++)
+  {
+    uint32_t t;
+    float values[CHANNELS];
+    decoder.next(t, values);
+    TEST_ASSERT_EQUAL(times[n], t);
+    TEST_ASSERT_EQUAL_MEMORY(expected[n], values, sizeof(values));
+  }
+}
+
+void test_full_block_rollback()
+{
+  static uint8_t block[64];
+  static float expected[64][CHANNELS];
+  GorillaEncoder<CHANNELS> encoder;
+  GorillaDecoder<CHANNELS> decoder;
+  uint32_t count = 0;
+
+  encoder.begin(block, sizeof(block));
+  while (true)
+  {
+    for (uint32_t ch = 0; ch < CHANNELS; ch++)
+      expected[count][ch] = 100.0f * gaussian();
+    if (!encoder.append(1000 + 37 * count, expected[count]))
+      break;
+    count++;
+  }
+  TEST_ASSERT_EQUAL(count, encoder.getCount());
+
+  // the rejected record did not change the stored ones
+  decoder.begin(block);
+  for (uint32_t n = 0; n < count; n++)
+  {
+    uint32_t t;
+    float values[CHANNELS];
+    decoder.next(t, values);
+    TEST_ASSERT_EQUAL(1000 + 37 * n, t);
+    TEST_ASSERT_EQUAL_MEMORY(expected[n], values, sizeof(values));
+  }
+}
+
+// History.hpp sizing: full rate samples and averaged 1 s archive records
+void test_compression_ratio()
+{
+  static const float noises[] = {0.05f, 0.15f, 0.3f};
+  static constexpr uint32_t RAW = 4 + CHANNELS * 4;  // bytes of an uncompressed record
+
+  for (float noise : noises)
+  {
+    uint32_t active = fill_block(noise, 29, true);
+    uint32_t idle = fill_block(noise, 100, true);
+    // archive: mean of 10 idle samples, the noise drops by sqrt(10)
+    uint32_t archive = fill_block(noise / sqrtf(10.0f), 1000, true);
+
+    char text[160];
+    snprintf(text, sizeof(text), "noise %.2f deg-C: records per 1 KB block: 29 ms %u (%.1fx), 100 ms %u (%.1fx), archive %u (%.1fx) = %.1f min",
+             noise, active, (float)active * RAW / BLOCK_SIZE, idle, (float)idle * RAW / BLOCK_SIZE,
+             archive, (float)archive * RAW / BLOCK_SIZE, archive / 60.0f);
+    TEST_MESSAGE(text);
+    TEST_ASSERT_GREATER_THAN(4 * BLOCK_SIZE, active * RAW);
+    // 40 archive blocks hold several hours
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * 3600, archive * 40);
+  }
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t ROUNDS = 200;
+  static uint8_t block[BLOCK_SIZE];
+  GorillaEncoder<CHANNELS> encoder;
+  GorillaDecoder<CHANNELS> decoder;
+  float values[CHANNELS];
+  uint64_t encode_time = 0;
+  uint64_t decode_time = 0;
+  uint32_t records = 0;
+  double sum = 0.0;
+
+  for (uint32_t r = 0; r < ROUNDS; r++)
+  {
+    uint32_t count = 0;
+    uint64_t start = bench_now();
+    encoder.begin(block, BLOCK_SIZE);
+    while (true)
+    {
+      idle_sample(0.15f, values);
+      if (!encoder.append(1000 + count * 29, values))
+        break;
+      count++;
+    }
+    encode_time += bench_now() - start;
+
+    start = bench_now();
+    decoder.begin(block);
+    for (uint32_t n = 0; n < count; n++)
+    {
+      uint32_t t;
+      decoder.next(t, values);
+      sum += values[0];
+    }
+    decode_time += bench_now() - start;
+    records += count;
+  }
+  bench_keep(sum);
+
+  // the encode time includes the sample generation
+  char text[96];
+  snprintf(text, sizeof(text), "per record: encode %.0f, decode %.0f " BENCH_UNIT,
+           (double)encode_time / records, (double)decode_time / records);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_exact);
+  RUN_TEST(test_full_block_rollback);
+  RUN_TEST(test_compression_ratio);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
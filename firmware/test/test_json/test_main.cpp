@@ -0,0 +1,174 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Json.hpp"
+#include "../bench.hpp"
+
+// the layout of /api/state
+static void write_state(JsonWriter &json, float top)
+{
+  json.beginObject();
+  json.addUInt("seq", 1234);
+  json.addBool("power", true);
+  json.beginObject("temp");
+  json.addFloat("top", top, 2);
+  json.addFloat("side", 91.5f, 2);
+  json.addFloat("water", NAN, 2);
+  json.endObject();
+  json.beginObject("pid");
+  json.addString("regime", "hold");
+  json.addFloat("p", -0.125f, 3);
+  json.addInt("age", -5);
+  json.endObject();
+  json.beginArray("points");
+  json.addUInt(nullptr, 1);
+  json.addUInt(nullptr, 2);
+  json.endArray();
+  json.endObject();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_writer()
+{
+  char buffer[256];
+  ResponseWriter writer(buffer, sizeof(buffer));
+  JsonWriter json(writer);
+
+  write_state(json, 93.27f);
+  TEST_ASSERT_EQUAL_STRING("{\"seq\":1234,\"power\":true,\"temp\":{\"top\":93.27,\"side\":91.50,\"water\":null},"
+                           "\"pid\":{\"regime\":\"hold\",\"p\":-0.125,\"age\":-5},\"points\":[1,2]}", writer.c_str());
+  TEST_ASSERT_FALSE(writer.overflow());
+}
+
+void test_escape()
+{
+  char buffer[64];
+  ResponseWriter writer(buffer, sizeof(buffer));
+  JsonWriter json(writer);
+
+  json.beginObject();
+  json.addString("name", "a\"b\\c\nd\x01");
+  json.endObject();
+  TEST_ASSERT_EQUAL_STRING("{\"name\":\"a\\\"b\\\\c\\nd\\u0001\"}", writer.c_str());
+
+  // and back
+  char text[16];
+  TEST_ASSERT_TRUE(json_get_string(writer.c_str(), "name", text, sizeof(text)));
+  TEST_ASSERT_EQUAL_STRING("a\"b\\c\nd\x01", text);
+}
+
+void test_lookups()
+{
+  const char *body = " { \"temp\" : 93.5, \"nested\": {\"slot\": 7, \"s\": \"}\"}, \"list\": [1, [2]],"
+                     " \"slot\": 2, \"select\": false, \"mode\": \"steam\" } ";
+  float temp;
+  uint32_t slot;
+  bool select = true;
+  char mode[8];
+
+  TEST_ASSERT_TRUE(json_get_float(body, "temp", temp));
+  TEST_ASSERT_EQUAL_FLOAT(93.5f, temp);
+  TEST_ASSERT_TRUE(json_get_uint(body, "slot", slot));
+  TEST_ASSERT_EQUAL(2, slot);
+  TEST_ASSERT_TRUE(json_get_bool(body, "select", select));
+  TEST_ASSERT_FALSE(select);
+  TEST_ASSERT_TRUE(json_get_string(body, "mode", mode, sizeof(mode)));
+  TEST_ASSERT_EQUAL_STRING("steam", mode);
+
+  // missing or of another type
+  TEST_ASSERT_FALSE(json_get_float(body, "missing", temp));
+  TEST_ASSERT_FALSE(json_get_float(body, "mode", temp));
+  TEST_ASSERT_FALSE(json_get_bool(body, "temp", select));
+  TEST_ASSERT_FALSE(json_get_string(body, "temp", mode, sizeof(mode)));
+  TEST_ASSERT_FALSE(json_get_string(body, "mode", mode, 5));
+}
+
+void test_uint()
+{
+  uint32_t value = 99;
+
+  TEST_ASSERT_TRUE(json_get_uint("{\"n\": 4294967295}", "n", value));
+  TEST_ASSERT_EQUAL(4294967295u, value);
+  TEST_ASSERT_TRUE(json_get_uint("{\"n\":0}", "n", value));
+  TEST_ASSERT_EQUAL(0, value);
+
+  // no sign, fraction, exponent or overflow
+  TEST_ASSERT_FALSE(json_get_uint("{\"n\": -1}", "n", value));
+  TEST_ASSERT_FALSE(json_get_uint("{\"n\": 1.5}", "n", value));
+  TEST_ASSERT_FALSE(json_get_uint("{\"n\": 1e3}", "n", value));
+  TEST_ASSERT_FALSE(json_get_uint("{\"n\": 4294967296}", "n", value));
+  TEST_ASSERT_FALSE(json_get_uint("{\"n\": 99999999999999999999}", "n", value));
+  TEST_ASSERT_FALSE(json_get_uint("{\"n\": \"1\"}", "n", value));
+  TEST_ASSERT_EQUAL(0, value);
+}
+
+void test_malformed()
+{
+  static const char *const bodies[] = {
+    "", "[]", "{", "{\"slot\"", "{\"slot\" 1}", "{\"a\": 1 \"slot\": 1}", "{\"a\": \"x, \"slot\": 1}",
+    "{\"a\": [1, \"slot\": 1}", "{\"slot\": }", "{'slot': 1}",
+  };
+  uint32_t slot;
+  float temp;
+
+  for (uint32_t n = 0; n < sizeof(bodies) / sizeof(bodies[0]); n++)
+  {
+    TEST_ASSERT_FALSE_MESSAGE(json_get_uint(bodies[n], "slot", slot), bodies[n]);
+    TEST_ASSERT_FALSE_MESSAGE(json_get_float(bodies[n], "slot", temp), bodies[n]);
+  }
+
+  // unterminated string value, \u beyond ASCII
+  char text[8];
+  TEST_ASSERT_FALSE(json_get_string("{\"s\": \"abc}", "s", text, sizeof(text)));
+  TEST_ASSERT_FALSE(json_get_string("{\"s\": \"\\u00e9\"}", "s", text, sizeof(text)));
+  TEST_ASSERT_FALSE(json_get_string("{\"s\": \"\\u00", "s", text, sizeof(text)));
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 100000;
+  const char *body = "{\"slot\": 1, \"profile\": \"hold 100 200\\nramp 60 90 25000\", \"select\": true}";
+  char buffer[256];
+  uint64_t bytes = 0, found = 0;
+
+  uint64_t start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+  {
+    ResponseWriter writer(buffer, sizeof(buffer));
+    JsonWriter json(writer);
+    write_state(json, 90.0f + (n & 255) * 0.01f);
+    bytes += writer.length();
+  }
+  uint64_t write_time = bench_now() - start;
+
+  start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+  {
+    uint32_t slot;
+    bool select;
+    found += json_get_uint(body, "slot", slot) + json_get_bool(body, "select", select);
+  }
+  uint64_t lookup_time = bench_now() - start;
+  bench_keep(bytes);
+  bench_keep(found);
+
+  char text[128];
+  snprintf(text, sizeof(text), "per state document: %.0f " BENCH_UNIT " (%.0f bytes), per /api/profile lookups: %.0f " BENCH_UNIT,
+           (double)write_time / COUNT, (double)bytes / COUNT, (double)lookup_time / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_writer);
+  RUN_TEST(test_escape);
+  RUN_TEST(test_lookups);
+  RUN_TEST(test_uint);
+  RUN_TEST(test_malformed);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+#include <unity.h>
+#include <stdio.h>
+#include "MainsPLL.hpp"
+
+// zero-cross edge stream: interval in 1/256 us, jitter in +-us, times from
+// close to the wrap-around of the 32 bit us timer
+typedef struct Mains {
+  uint64_t time_q8;
+  uint32_t interval_q8;
+  uint32_t jitter_us;
+  uint32_t rng;
+} Mains_t;
+
+static Mains_t mains_make(double interval_us, uint32_t jitter_us)
+{
+  Mains_t mains = {(uint64_t)(0xFFFFFFFFu - 50000u) << 8, (uint32_t)(interval_us * 256 + 0.5), jitter_us, 12345};
+  return mains;
+}
+
+// true time of the next zero-cross
+static uint32_t mains_next(Mains_t &mains)
+{
+  mains.time_q8 += mains.interval_q8;
+  return (uint32_t)(mains.time_q8 >> 8);
+}
+
+// as seen by the edge ISR
+static uint32_t mains_jitter(Mains_t &mains, uint32_t time_us)
+{
+  if (mains.jitter_us == 0)
+    return time_us;
+  mains.rng ^= mains.rng << 13;
+  mains.rng ^= mains.rng >> 17;
+  mains.rng ^= mains.rng << 5;
+  return time_us + mains.rng % (2 * mains.jitter_us + 1) - mains.jitter_us;
+}
+
+static void feed(MainsPLL &pll, Mains_t &mains, uint32_t edges)
+{
+  for (uint32_t n = 0; n < edges; n++)
+  {
+    uint32_t time = mains_next(mains);
+    pll.edge(mains_jitter(mains, time));
+    pll.poll(time);
+  }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_lock_50hz()
+{
+  MainsPLL pll(50);
+  Mains_t mains = mains_make(10000.0, 50);
+
+  // the first edge has no interval, then LOCK_EDGES intervals
+  feed(pll, mains, MainsPLL::LOCK_EDGES);
+  TEST_ASSERT_FALSE(pll.isLocked());
+  TEST_ASSERT_EQUAL(10000, pll.getHalfPeriodUs());
+  feed(pll, mains, 1);
+  TEST_ASSERT_TRUE(pll.isLocked());
+  TEST_ASSERT_EQUAL(50, pll.getFrequency());
+  TEST_ASSERT_UINT_WITHIN(20, 10000, pll.getHalfPeriodUs());
+}
+
+void test_lock_60hz_full_cycle()
+{
+  // one edge per sine period, e.g. an opto-coupler without a bridge
+  MainsPLL pll(50);
+  Mains_t mains = mains_make(16666.67, 20);
+
+  TEST_ASSERT_EQUAL(10000, pll.getHalfPeriodUs());
+  feed(pll, mains, 200);
+  TEST_ASSERT_TRUE(pll.isLocked());
+  TEST_ASSERT_EQUAL(60, pll.getFrequency());
+  TEST_ASSERT_UINT_WITHIN(1, 8333, pll.getHalfPeriodUs());
+}
+
+void test_tracks_frequency_and_phase()
+{
+  // 49.8 Hz, off by 0.4% from the nominal interval
+  MainsPLL pll(50);
+  Mains_t mains = mains_make(1000000.0 / 49.8 / 2, 20);
+  uint32_t worst = 0;
+
+  feed(pll, mains, 500);
+  for (uint32_t n = 0; n < 1000; n++)
+  {
+    uint32_t time = mains_next(mains);
+    pll.edge(mains_jitter(mains, time));
+    int32_t err = (int32_t)(pll.getPhaseUs() - time);
+    uint32_t magnitude = (err < 0) ? -err : err;
+    if (magnitude > worst)
+      worst = magnitude;
+  }
+
+  char text[80];
+  snprintf(text, sizeof(text), "49.8 Hz, +-20 us jitter: half period %u us, phase error %u us",
+           pll.getHalfPeriodUs(), worst);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_TRUE(pll.isLocked());
+  TEST_ASSERT_UINT_WITHIN(2, 10040, pll.getHalfPeriodUs());
+  TEST_ASSERT_LESS_THAN(20, worst);
+}
+
+void test_holdover_missing_edges()
+{
+  MainsPLL pll(50);
+  Mains_t mains = mains_make(10000.0, 10);
+  MainsStats_t stats;
+
+  feed(pll, mains, 100);
+  TEST_ASSERT_TRUE(pll.isLocked());
+
+  // a few edges lost - bridged, the phase keeps running
+  for (uint32_t n = 0; n < MainsPLL::LOST_PERIODS - 1; n++)
+    pll.poll(mains_next(mains));
+  uint32_t time = mains_next(mains);
+  pll.edge(mains_jitter(mains, time));
+  TEST_ASSERT_TRUE(pll.isLocked());
+  TEST_ASSERT_UINT_WITHIN(15, time, pll.getPhaseUs());
+  pll.getStats(stats);
+  TEST_ASSERT_EQUAL(MainsPLL::LOST_PERIODS - 1, stats.missed);
+  TEST_ASSERT_EQUAL(0, stats.losses);
+}
+
+void test_holdover_noise()
+{
+  MainsPLL pll(50);
+  Mains_t mains = mains_make(10000.0, 10);
+  MainsStats_t stats;
+
+  feed(pll, mains, 100);
+
+  // spikes between the zero-crosses are ignored
+  for (uint32_t n = 0; n < 100; n++)
+  {
+    uint32_t time = mains_next(mains);
+    pll.edge(time - 3000);
+    pll.edge(mains_jitter(mains, time));
+  }
+  TEST_ASSERT_TRUE(pll.isLocked());
+  TEST_ASSERT_UINT_WITHIN(2, 10000, pll.getHalfPeriodUs());
+  pll.getStats(stats);
+  TEST_ASSERT_EQUAL(100, stats.outliers);
+
+  // only noise - unlocks
+  for (uint32_t n = 0; n <= MainsPLL::MAX_OUTLIERS; n++)
+    pll.edge(mains_next(mains) - 3000);
+  TEST_ASSERT_FALSE(pll.isLocked());
+}
+
+void test_lost_and_relock()
+{
+  MainsPLL pll(50);
+  Mains_t mains = mains_make(8333.33, 10);
+  MainsStats_t stats;
+
+  feed(pll, mains, 100);
+  TEST_ASSERT_EQUAL(60, pll.getFrequency());
+
+  // mains detector gone: unlocked after LOST_PERIODS, nominal rate of the last lock
+  for (uint32_t n = 0; n < MainsPLL::LOST_PERIODS - 1; n++)
+    pll.poll(mains_next(mains));
+  TEST_ASSERT_TRUE(pll.isLocked());
+  pll.poll(mains_next(mains) + 100);
+  TEST_ASSERT_FALSE(pll.isLocked());
+  TEST_ASSERT_EQUAL(8333, pll.getHalfPeriodUs());
+
+  // edges again
+  feed(pll, mains, MainsPLL::LOCK_EDGES + 1);
+  TEST_ASSERT_TRUE(pll.isLocked());
+  pll.getStats(stats);
+  TEST_ASSERT_EQUAL(2, stats.locks);
+  TEST_ASSERT_EQUAL(1, stats.losses);
+}
+
+void test_rejects_wrong_rate()
+{
+  // 40 Hz fits no case
+  MainsPLL pll(50);
+  Mains_t mains = mains_make(12500.0, 0);
+
+  feed(pll, mains, 100);
+  TEST_ASSERT_FALSE(pll.isLocked());
+  TEST_ASSERT_EQUAL(50, pll.getFrequency());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_lock_50hz);
+  RUN_TEST(test_lock_60hz_full_cycle);
+  RUN_TEST(test_tracks_frequency_and_phase);
+  RUN_TEST(test_holdover_missing_edges);
+  RUN_TEST(test_holdover_noise);
+  RUN_TEST(test_lost_and_relock);
+  RUN_TEST(test_rejects_wrong_rate);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "coffee_config.hpp"
+#include "MPCController.hpp"
+#include "../boiler_sim.hpp"
+
+// the table of PIDHeater.cpp
+static constexpr MPCTable table({
+  MPC_HEATER_POWER,
+  MPC_HEATER_LAG / 1000.0,
+  MPC_CAPACITY,
+  MPC_LOSS_R,
+  MPC_TEMP_AMBIENT,
+  MPC_DRAW_FADE / 1000.0,
+  PID_TS / 1000.0,
+  MPC_DEAD_TIME / PID_TS,
+  MPC_HORIZON,
+  MPC_CLTR
+});
+
+// closed loop of simulation/python_pid/mpc_sim.py: cold start at 25 deg-C,
+// a 30 s shot at 700 s, the process value is the water temperature with noise
+static constexpr uint32_t SHOT_START_S = 700;
+static constexpr uint32_t SHOT_END_S = 730;
+static constexpr uint32_t RUN_S = 900;
+static constexpr float SETTLED = 0.5f;  // deg-C
+
+typedef struct Result {
+  float settle_s;       // from then on within target +- SETTLED until the shot, < 0 = never
+  float overshoot;      // deg-C above target before the shot
+  float droop;          // deg-C below target during and up to 60 s after the shot
+  float shot_overshoot; // deg-C above target after the shot
+} Result_t;
+
+static Result_t run(bool mpc_on, float target)
+{
+  SilviBoiler boiler(25.0);
+  PIDLoop pid(boiler.readWater());
+  MPCController mpc(&table, MPC_DIST_GAIN);
+  Result_t result = {-1.0f, -100.0f, -100.0f, -100.0f};
+  bool settled = false;
+
+  for (uint32_t s = 0; s < RUN_S; s++)
+  {
+    float pump = (s >= SHOT_START_S && s < SHOT_END_S) ? 100.0f : 0.0f;
+    float pv = boiler.readWater();
+    float heater;
+
+    if (mpc_on)
+    {
+      // as PIDHeater::task: the feed-forward is the known disturbance
+      float ff = PID_FF_PUMP * pump;
+      heater = fminf(fmaxf(mpc.update(target, pv, ff), 0.0f), 100.0f);
+      mpc.setApplied(heater);
+    }
+    else
+      heater = pid.step(target, pv, pump);
+
+    for (uint32_t n = 0; n < SilviBoiler::STEPS_PER_S; n++)
+    {
+      boiler.step(SilviBoiler::heaterOn(heater, n), pump / 100.0f);
+      float water = boiler.getWater();
+      float t = s + n * SilviBoiler::STEP_S;
+      if (s < SHOT_START_S)
+      {
+        result.overshoot = fmaxf(result.overshoot, water - target);
+        if (fabsf(water - target) > SETTLED)
+          settled = false;
+        else if (!settled)
+        {
+          settled = true;
+          result.settle_s = t;
+        }
+      }
+      else if (s < SHOT_END_S + 60)
+        result.droop = fmaxf(result.droop, target - water);
+      if (s >= SHOT_END_S)
+        result.shot_overshoot = fmaxf(result.shot_overshoot, water - target);
+    }
+  }
+  if (!settled)
+    result.settle_s = -1.0f;
+  return result;
+}
+
+static void compare(float target)
+{
+  Result_t pid = run(false, target);
+  Result_t mpc = run(true, target);
+  char text[160];
+
+  snprintf(text, sizeof(text), "target %.0f PID: settled %.0f s, overshoot %.2f, droop %.2f, after shot %.2f deg-C",
+           target, pid.settle_s, pid.overshoot, pid.droop, pid.shot_overshoot);
+  TEST_MESSAGE(text);
+  snprintf(text, sizeof(text), "target %.0f MPC: settled %.0f s, overshoot %.2f, droop %.2f, after shot %.2f deg-C",
+           target, mpc.settle_s, mpc.overshoot, mpc.droop, mpc.shot_overshoot);
+  TEST_MESSAGE(text);
+
+  // settles (the PID never stays within the band) and beats the PID around the shot
+  TEST_ASSERT_GREATER_THAN(0.0f, mpc.settle_s);
+  TEST_ASSERT_TRUE(pid.settle_s < 0.0f || mpc.settle_s < pid.settle_s);
+  TEST_ASSERT_LESS_THAN(1.0f, mpc.overshoot);
+  TEST_ASSERT_LESS_THAN(pid.droop, mpc.droop);
+  TEST_ASSERT_LESS_OR_EQUAL(pid.shot_overshoot, mpc.shot_overshoot);
+  TEST_ASSERT_LESS_THAN(1.0f, mpc.shot_overshoot);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_table_hold()
+{
+  // the hold output balances the loss of the silvi_sim.py boiler
+  for (float temp = 30.0f; temp <= 130.0f; temp += 10.0f)
+  {
+    double loss = SilviBoiler::LOSS_R * (pow(temp, 4) - pow(SilviBoiler::TEMP_ENV, 4)) * temp;
+    double hold = loss * SilviBoiler::CAPACITY / SilviBoiler::HEATER_POWER * 100.0;
+    TEST_ASSERT_FLOAT_WITHIN(0.01, hold, table.lookup(temp).u_hold);
+  }
+  TEST_ASSERT_EQUAL(1, table.getDeadSteps());
+}
+
+void test_steady_state_offset_free()
+{
+  // linear plant with the model element, but 30% more loss than modelled
+  MPCController mpc(&table, MPC_DIST_GAIN);
+  MPCTable::Point_t point = table.lookup(92.0f);
+  float ae = table.getElementPole();
+  float y = -2.0f;
+  float h = 0.0f;
+
+  for (uint32_t s = 0; s < 1200; s++)
+  {
+    float u = fminf(fmaxf(mpc.update(92.0f, 92.0f + y, 0.0f), 0.0f), 100.0f);
+    mpc.setApplied(u);
+    y = point.a * y + point.b * (h - point.u_hold - 0.3f * point.u_hold);
+    h = ae * h + (1.0f - ae) * u;
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, y);
+}
+
+void test_closed_loop_brew()
+{
+  compare(BREW_TEMP);
+}
+
+void test_closed_loop_steam()
+{
+  compare(112.0f);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_table_hold);
+  RUN_TEST(test_steady_state_offset_free);
+  RUN_TEST(test_closed_loop_brew);
+  RUN_TEST(test_closed_loop_steam);
+  return UNITY_END();
+}
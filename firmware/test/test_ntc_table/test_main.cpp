@@ -0,0 +1,88 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "NTCTable.hpp"
+#include "../bench.hpp"
+
+// curve of the boiler probes (Sensors.cpp)
+static constexpr NTCCurve_t curve = {13.582, 0.00433, 2230.8, 30.0};
+static constexpr NTCTable table(curve);
+
+// the conversion in Sensor::update before the table
+static double original(double value)
+{
+  return (13.582 - sqrt(13.582 * 13.582 + 4 * 0.00433 * (2230.8 - value) ) ) / (2 * -0.00433) + 30;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_error_bound()
+{
+  double max_error = 0.0;
+
+  // 1/16 mV steps, the burst average is fractional
+  for (float mv = NTCTable::MV_MIN; mv < NTCTable::MV_MAX; mv += 1.0f / 16)
+    max_error = fmax(max_error, fabs(table.convert(mv) - original(mv)));
+
+  char text[64];
+  snprintf(text, sizeof(text), "max error %.5f deg-C", max_error);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_LESS_OR_EQUAL(0.005, max_error);
+  // the compile time check agrees
+  TEST_ASSERT_LESS_OR_EQUAL(0.005, table.maxError(curve));
+}
+
+void test_formula_matches_original()
+{
+  for (uint32_t mv = NTCTable::MV_MIN; mv < NTCTable::MV_MAX; mv++)
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, original(mv), ntc_formula(curve, mv));
+}
+
+void test_out_of_range()
+{
+  TEST_ASSERT_EQUAL_FLOAT(999.0f, table.convert(NTCTable::MV_MIN - 0.5f));
+  TEST_ASSERT_EQUAL_FLOAT(999.0f, table.convert(NTCTable::MV_MAX));
+  TEST_ASSERT_EQUAL_FLOAT(999.0f, table.convert(NAN));
+  TEST_ASSERT_FLOAT_WITHIN(0.005, original(NTCTable::MV_MIN), table.convert(NTCTable::MV_MIN));
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 1000000;
+  float inputs[256];
+  uint64_t start;
+  float sum_table = 0.0f;
+  double sum_original = 0.0;
+
+  for (uint32_t i = 0; i < 256; i++)
+    inputs[i] = 900.0f + i * 5.3f;
+
+  start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+    sum_table += table.convert(inputs[n & 255]);
+  uint64_t table_time = bench_now() - start;
+
+  start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+    sum_original += original(inputs[n & 255]);
+  uint64_t original_time = bench_now() - start;
+
+  bench_keep(sum_table);
+  bench_keep(sum_original);
+
+  char text[96];
+  snprintf(text, sizeof(text), "per conversion: table %.1f, original %.1f " BENCH_UNIT,
+           (double)table_time / COUNT, (double)original_time / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_error_bound);
+  RUN_TEST(test_formula_matches_original);
+  RUN_TEST(test_out_of_range);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "coffee_config.hpp"
+#include "PIDKernel.hpp"
+#include "../bench.hpp"
+#include "../boiler_sim.hpp"
+
+// the float formula PIDHeater::task used before the kernel
+class FloatPID
+{
+public:
+  FloatPID(float p_pos, float p_neg, float i, float d, float ts_s) :
+    p_pos_(p_pos), p_neg_(p_neg), i_(i), d_(d), ts_s_(ts_s), pv1_(0), pv2_(0), u1_(0)
+  {
+  }
+
+  void reset(float pv, float u1)
+  {
+    pv1_ = pv;
+    pv2_ = pv;
+    u1_ = u1;
+  }
+
+  float step(float target, float pv)
+  {
+    float p = ((pv1_ - pv) > 0 ? p_pos_ : p_neg_) * (pv1_ - pv);
+    float i = i_ * ts_s_ * (target - pv);
+    float d = (d_ * (2 * pv1_ - pv - pv2_)) / ts_s_;
+    return u1_ + p + i + d;
+  }
+
+  void commit(float pv, float u)
+  {
+    pv2_ = pv1_;
+    pv1_ = pv;
+    u1_ = u;
+  }
+
+private:
+  float p_pos_, p_neg_, i_, d_, ts_s_;
+  float pv1_, pv2_, u1_;
+};
+
+// the limits of PIDLoop, applied to either implementation
+static float limit(float u, float target, float pv, float pump)
+{
+  if (target - pv > PID_OVERRIDE_TEMP_ERR)
+    u = PID_OVERRIDE_TEMP;
+  if (pump == 0.0f && u > 5 && pv >= target + 0.5f)
+    u = 5;
+  return fminf(fmaxf(u, 0.0f), 100.0f);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_q16()
+{
+  TEST_ASSERT_EQUAL(Q16_ONE, q16_from_float(1.0f));
+  TEST_ASSERT_EQUAL(-Q16_ONE / 2, q16_from_float(-0.5f));
+  TEST_ASSERT_EQUAL(Q16_MAX, q16_from_float(40000.0f));
+  TEST_ASSERT_EQUAL(Q16_MIN, q16_from_float(-40000.0f));
+  TEST_ASSERT_EQUAL(Q16_MAX, q16_from_float(INFINITY));
+  TEST_ASSERT_EQUAL(Q16_MIN, q16_from_float(-INFINITY));
+  TEST_ASSERT_EQUAL(0, q16_from_float(NAN));
+  TEST_ASSERT_EQUAL_FLOAT(92.25f, q16_to_float(q16_from_float(92.25f)));
+
+  // saturating, no wrap-around
+  TEST_ASSERT_EQUAL(Q16_MAX, q16_add(Q16_MAX, 1));
+  TEST_ASSERT_EQUAL(Q16_MIN, q16_sub(Q16_MIN, 1));
+  TEST_ASSERT_EQUAL(Q16_MAX, q16_mul(q16_from_float(30000.0f), q16_from_float(2.0f)));
+  TEST_ASSERT_EQUAL(Q16_MIN, q16_mul(q16_from_float(30000.0f), q16_from_float(-2.0f)));
+
+  // rounded to nearest in both directions
+  TEST_ASSERT_EQUAL(1, q16_mul(1, Q16_ONE / 2));
+  TEST_ASSERT_EQUAL(0, q16_mul(-1, Q16_ONE / 2));
+  TEST_ASSERT_EQUAL(q16_from_float(-1.5f), q16_mul(q16_from_float(3.0f), q16_from_float(-0.5f)));
+}
+
+void test_step_matches_float()
+{
+  PIDKernel kernel;
+  FloatPID reference(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  const float pvs[] = {80.0f, 80.5f, 81.5f, 82.0f, 81.8f, 81.0f};
+
+  kernel.setGains(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  kernel.reset(q16_from_float(80.0f), q16_from_float(10.0f));
+  reference.reset(80.0f, 10.0f);
+
+  // rising and falling, Kp- and Kp+
+  for (uint32_t n = 0; n < sizeof(pvs) / sizeof(pvs[0]); n++)
+  {
+    float u = q16_to_float(kernel.step(q16_from_float(BREW_TEMP), q16_from_float(pvs[n])));
+    float expected = reference.step(BREW_TEMP, pvs[n]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, expected, u);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, u - 10.0f,
+                             q16_to_float(kernel.getPShare() + kernel.getIShare() + kernel.getDShare()));
+    kernel.commit(q16_from_float(pvs[n]), q16_from_float(10.0f));
+    reference.commit(pvs[n], 10.0f);
+  }
+}
+
+void test_bumpless_gains()
+{
+  PIDKernel kernel;
+  q16_t pv = q16_from_float(BREW_TEMP);
+
+  kernel.setGains(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  kernel.reset(pv, q16_from_float(12.5f));
+  kernel.setGains(10 * PID_P_POS, 10 * PID_P_NEG, 10 * PID_I, 10 * PID_D, PID_TS / 1000.0f);
+  TEST_ASSERT_EQUAL(q16_from_float(12.5f), kernel.step(pv, pv));
+}
+
+void test_saturates()
+{
+  PIDKernel kernel;
+
+  kernel.setGains(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  kernel.reset(q16_from_float(-30000.0f), q16_from_float(30000.0f));
+  TEST_ASSERT_EQUAL(Q16_MAX, kernel.step(q16_from_float(30000.0f), q16_from_float(-30000.0f)));
+  kernel.reset(q16_from_float(30000.0f), q16_from_float(-30000.0f));
+  TEST_ASSERT_EQUAL(Q16_MIN, kernel.step(q16_from_float(-30000.0f), q16_from_float(30000.0f)));
+}
+
+// both implementations on the process value trace of a warm-up and a shot
+// every 5 min on the simulated boiler, each with its own applied output as u1
+void test_trace_tolerance()
+{
+  static constexpr uint32_t STEPS = 20000;
+  SilviBoiler boiler(25.0);
+  PIDKernel kernel;
+  FloatPID reference(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  float pv = boiler.readWater();
+  float largest = 0.0f;
+  uint32_t percent_differs = 0;
+
+  kernel.setGains(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  kernel.reset(q16_from_float(pv), 0);
+  reference.reset(pv, 0.0f);
+
+  for (uint32_t s = 0; s < STEPS; s++)
+  {
+    float pump = (s >= 600 && s % 300 < 30) ? 100.0f : 0.0f;
+    float ff = PID_FF_PUMP * pump;
+    pv = boiler.readWater();
+
+    float u_kernel = q16_to_float(kernel.step(q16_from_float(BREW_TEMP), q16_from_float(pv)));
+    float u_float = reference.step(BREW_TEMP, pv);
+    largest = fmaxf(largest, fabsf(u_kernel - u_float));
+
+    u_kernel = fminf(limit(u_kernel, BREW_TEMP, pv, pump) + ff, 100.0f);
+    u_float = fminf(limit(u_float, BREW_TEMP, pv, pump) + ff, 100.0f);
+    if (lroundf(u_kernel) != lroundf(u_float))
+      percent_differs++;
+    kernel.commit(q16_from_float(pv), q16_from_float(u_kernel - ff));
+    reference.commit(pv, u_float - ff);
+
+    for (uint32_t n = 0; n < SilviBoiler::STEPS_PER_S; n++)
+      boiler.step(SilviBoiler::heaterOn(u_kernel, n), pump / 100.0f);
+  }
+
+  char text[96];
+  snprintf(text, sizeof(text), "%u steps: largest difference %.4f %%, %u outputs round differently",
+           STEPS, largest, percent_differs);
+  TEST_MESSAGE(text);
+
+  // the tolerance documented in PIDKernel.hpp
+  TEST_ASSERT_LESS_THAN(0.01f, largest);
+  TEST_ASSERT_LESS_THAN(STEPS / 1000, percent_differs);
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 1000000;
+  PIDKernel kernel;
+  FloatPID reference(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  q16_t pvs_q16[256];
+  float pvs[256];
+  uint64_t start;
+  double sum_kernel = 0.0, sum_float = 0.0;
+
+  for (uint32_t i = 0; i < 256; i++)
+  {
+    pvs[i] = BREW_TEMP + sinf(i * 0.1f);
+    pvs_q16[i] = q16_from_float(pvs[i]);
+  }
+  kernel.setGains(PID_P_POS, PID_P_NEG, PID_I, PID_D, PID_TS / 1000.0f);
+  kernel.reset(pvs_q16[0], 0);
+  reference.reset(pvs[0], 0.0f);
+
+  start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+  {
+    q16_t u = kernel.step(q16_from_float(BREW_TEMP), pvs_q16[n & 255]);
+    kernel.commit(pvs_q16[n & 255], u >> 1);
+    sum_kernel += u;
+  }
+  uint64_t kernel_time = bench_now() - start;
+
+  start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+  {
+    float u = reference.step(BREW_TEMP, pvs[n & 255]);
+    reference.commit(pvs[n & 255], u / 2);
+    sum_float += u;
+  }
+  uint64_t float_time = bench_now() - start;
+
+  bench_keep(sum_kernel);
+  bench_keep(sum_float);
+
+  char text[96];
+  snprintf(text, sizeof(text), "per step: kernel %.1f, float %.1f " BENCH_UNIT,
+           (double)kernel_time / COUNT, (double)float_time / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_q16);
+  RUN_TEST(test_step_matches_float);
+  RUN_TEST(test_bumpless_gains);
+  RUN_TEST(test_saturates);
+  RUN_TEST(test_trace_tolerance);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+#include <unity.h>
+#include <stdio.h>
+#include "PumpPatterns.hpp"
+#include "../bench.hpp"
+
+static constexpr PumpPatterns patterns;
+static constexpr uint32_t STEPS = PumpPatterns::STEPS;
+
+// longest run of periods in the given state, also across the wrap of the pattern
+static uint32_t longest_run(uint32_t duty, bool on)
+{
+  uint32_t longest = 0, run = 0;
+
+  for (uint32_t n = 0; n < 2 * STEPS; n++)
+  {
+    if (patterns.isOn(duty, n % STEPS) == on)
+      run++;
+    else
+      run = 0;
+    if (run > longest)
+      longest = run;
+  }
+  return (longest > STEPS) ? STEPS : longest;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_exact_duty()
+{
+  for (uint32_t duty = 0; duty <= STEPS; duty++)
+  {
+    uint32_t on = 0;
+    for (uint32_t n = 0; n < STEPS; n++)
+      on += patterns.isOn(duty, n);
+    TEST_ASSERT_EQUAL(duty, on);
+  }
+}
+
+void test_starts_on()
+{
+  TEST_ASSERT_FALSE(patterns.isOn(0, 0));
+  for (uint32_t duty = 1; duty <= STEPS; duty++)
+    TEST_ASSERT_TRUE(patterns.isOn(duty, 0));
+}
+
+void test_even_spread()
+{
+  for (uint32_t duty = 1; duty < STEPS; duty++)
+  {
+    uint32_t off = STEPS - duty;
+    TEST_ASSERT_EQUAL((duty + off - 1) / off, longest_run(duty, true));
+    TEST_ASSERT_EQUAL((off + duty - 1) / duty, longest_run(duty, false));
+  }
+}
+
+void test_size()
+{
+  TEST_ASSERT_EQUAL(1616, sizeof(PumpPatterns));
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 1000000;
+  uint32_t on = 0;
+
+  uint64_t start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+    on += patterns.isOn((n >> 7) % (STEPS + 1), n % STEPS);
+  uint64_t time = bench_now() - start;
+  bench_keep(on);
+
+  char text[64];
+  snprintf(text, sizeof(text), "per lookup: %.1f " BENCH_UNIT, (double)time / COUNT);
+  TEST_MESSAGE(text);
+}
+
+// the pattern code of SSRPump before the table: 10 % steps, one case per step
+static bool __attribute__((noinline)) switch_period(uint32_t percent, uint32_t &counter)
+{
+  bool on;
+
+  switch (percent)
+  {
+    case 0:
+      on = false;
+      counter = 0;
+      break;
+    case 10:
+      on = (counter == 0);
+      if (++counter >= 10)
+        counter = 0;
+      break;
+    case 20:
+      on = (counter == 0);
+      if (++counter >= 5)
+        counter = 0;
+      break;
+    case 30:
+      on = (counter == 0);
+      if (++counter >= 3)
+        counter = 0;
+      break;
+    case 40:
+      on = (counter == 0 || counter == 2);
+      if (++counter >= 5)
+        counter = 0;
+      break;
+    case 50:
+      on = (counter == 0);
+      if (++counter >= 2)
+        counter = 0;
+      break;
+    case 60:
+      on = (counter == 0 || counter == 1 || counter == 3);
+      if (++counter >= 5)
+        counter = 0;
+      break;
+    case 70:
+      on = !(counter == 3 || counter == 6 || counter == 9);
+      if (++counter >= 10)
+        counter = 0;
+      break;
+    case 80:
+      on = (counter < 4);
+      if (++counter >= 5)
+        counter = 0;
+      break;
+    case 90:
+      on = (counter < 9);
+      if (++counter >= 10)
+        counter = 0;
+      break;
+    case 100:
+      on = true;
+      counter = 0;
+      break;
+    default:
+      on = false;
+  }
+  return on;
+}
+
+// the same step through the table, as SSRPump::nextPeriod does it
+static bool __attribute__((noinline)) table_period(uint32_t duty, uint32_t &pos)
+{
+  bool on;
+
+  if (duty == 0)
+  {
+    pos = 0;
+    return false;
+  }
+  on = patterns.isOn(duty, pos);
+  if (++pos >= STEPS)
+    pos = 0;
+  return on;
+}
+
+// one isr call per period, the duty changes every 128 periods over the old 10 % steps.
+// timing only: the old 30 % case was 1 of 3 periods, so the on counts differ
+template <typename F> static uint64_t time_periods(F period, uint32_t count, uint32_t &on)
+{
+  uint32_t counter = 0;
+  uint64_t start = bench_now();
+  for (uint32_t n = 0; n < count; n++)
+    on += period(((n >> 7) % 11) * 10, counter);
+  return bench_now() - start;
+}
+
+void test_benchmark_switch()
+{
+  static constexpr uint32_t COUNT = 200000;
+  static constexpr uint32_t ROUNDS = 25;
+  uint64_t best_switch = UINT64_MAX, best_table = UINT64_MAX;
+  uint32_t on_switch = 0, on_table = 0;
+
+  // alternate the variants and keep the best round of each
+  for (uint32_t round = 0; round < ROUNDS; round++)
+  {
+    uint64_t time = time_periods(switch_period, COUNT, on_switch);
+    if (time < best_switch)
+      best_switch = time;
+    time = time_periods(table_period, COUNT, on_table);
+    if (time < best_table)
+      best_table = time;
+  }
+  bench_keep(on_switch);
+  bench_keep(on_table);
+
+  char text[96];
+  snprintf(text, sizeof(text), "per isr period, min of %u: switch %.1f, table %.1f " BENCH_UNIT,
+           (unsigned)ROUNDS, (double)best_switch / COUNT, (double)best_table / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_exact_duty);
+  RUN_TEST(test_starts_on);
+  RUN_TEST(test_even_spread);
+  RUN_TEST(test_size);
+  RUN_TEST(test_benchmark);
+  RUN_TEST(test_benchmark_switch);
+  return UNITY_END();
+}
@@ -0,0 +1,260 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "coffee_config.hpp"
+#include "RelayAutotune.hpp"
+#include "../boiler_sim.hpp"
+
+// PID_MIN_TEMP of PIDHeater.hpp, which needs Arduino
+static constexpr float MIN_TEMP = 10.0f;
+
+// the config of PIDHeater::startAutotune
+static AutotuneConfig_t make_config(float setpoint)
+{
+  AutotuneConfig_t config = {
+    setpoint,
+    AUTOTUNE_OUTPUT_HIGH,
+    AUTOTUNE_OUTPUT_LOW,
+    AUTOTUNE_HYSTERESIS,
+    AUTOTUNE_CYCLES,
+    AUTOTUNE_MAX_OVERSHOOT,
+    MIN_TEMP,
+    AUTOTUNE_TIMEOUT_MS,
+    AUTOTUNE_HALF_CYCLE_MS
+  };
+  return config;
+}
+
+// relay experiment on the silvi_sim.py boiler, one update per PID period.
+// the systime starts close to its wrap-around.
+typedef struct Run {
+  float period;     // s - mean of the settled cycles, from the water
+  float amplitude;  // deg-C - peak to peak / 2, from the water
+  uint32_t seconds; // until the autotune ended
+} Run_t;
+
+static Run_t run(RelayAutotune &autotune, float setpoint, double start_temp)
+{
+  static constexpr uint32_t START_MS = 0xFFFFFFFFu - 600000u;
+  SilviBoiler boiler(start_temp);
+  Run_t result = {0.0f, 0.0f, 0};
+  float high = -1000.0f, low = 1000.0f;
+  float last_rise = -1.0f, sum_period = 0.0f, sum_max = 0.0f, sum_min = 0.0f;
+  uint32_t rises = 0, count_max = 0, count_min = 0;
+  float last_u = AUTOTUNE_OUTPUT_HIGH;
+
+  autotune.start(make_config(setpoint), START_MS);
+  for (uint32_t s = 0; s < AUTOTUNE_TIMEOUT_MS / 1000 + 10 && autotune.isRunning(); s++)
+  {
+    float u = autotune.update(START_MS + s * PID_TS, boiler.readWater());
+
+    // the same statistics straight from the simulated water, first cycle dropped.
+    // the maximum comes while the relay is low, the minimum while it is high.
+    if (autotune.getState() == AUTOTUNE_RELAY && u != last_u)
+    {
+      if (u > last_u)
+      {
+        if (rises >= 2)
+        {
+          sum_period += s - last_rise;
+          sum_max += high;
+          count_max++;
+        }
+        last_rise = s;
+        rises++;
+        low = 1000.0f;
+      }
+      else
+      {
+        if (rises >= 2)
+        {
+          sum_min += low;
+          count_min++;
+        }
+        high = -1000.0f;
+      }
+    }
+    last_u = u;
+
+    for (uint32_t n = 0; n < SilviBoiler::STEPS_PER_S; n++)
+    {
+      boiler.step(SilviBoiler::heaterOn(u, n), 0.0);
+      high = fmaxf(high, boiler.getWater());
+      low = fminf(low, boiler.getWater());
+    }
+    result.seconds = s;
+  }
+
+  if (rises > 2)
+    result.period = sum_period / (rises - 2);
+  if (count_max > 0 && count_min > 0)
+    result.amplitude = (sum_max / count_max - sum_min / count_min) / 2;
+  return result;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_simulated_boiler()
+{
+  RelayAutotune autotune;
+  Run_t sim = run(autotune, BREW_TEMP, 25.0);
+  const AutotuneResult_t &result = autotune.getResult();
+  char text[160];
+
+  snprintf(text, sizeof(text), "%u s: Ku %.2f %%/deg-C, Pu %.1f s, turn time %.1f s, amplitude %.2f deg-C",
+           sim.seconds, result.ku, result.pu, result.turn_time, result.amplitude);
+  TEST_MESSAGE(text);
+  snprintf(text, sizeof(text), "water: period %.1f s, amplitude %.2f deg-C", sim.period, sim.amplitude);
+  TEST_MESSAGE(text);
+  snprintf(text, sizeof(text), "classic P %.2f I %.3f D %.1f, PI P %.2f I %.3f",
+           result.classic.p, result.classic.i, result.classic.d, result.pi.p, result.pi.i);
+  TEST_MESSAGE(text);
+
+  TEST_ASSERT_EQUAL(AUTOTUNE_DONE, autotune.getState());
+  TEST_ASSERT_EQUAL(AUTOTUNE_CYCLES + 1, autotune.getCycles());
+
+  // the relay sees the same limit cycle as the water
+  TEST_ASSERT_FLOAT_WITHIN(1.0f + 0.05f * sim.period, sim.period, result.pu);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f + 0.1f * sim.amplitude, sim.amplitude, result.amplitude);
+  TEST_ASSERT_GREATER_THAN(AUTOTUNE_HYSTERESIS, result.amplitude);
+
+  // describing function: Ku = 4 d / (pi sqrt(a^2 - h^2))
+  float d = (AUTOTUNE_OUTPUT_HIGH - AUTOTUNE_OUTPUT_LOW) / 2;
+  float a = result.amplitude, h = AUTOTUNE_HYSTERESIS;
+  TEST_ASSERT_FLOAT_WITHIN(0.001f * result.ku, 4 * d / ((float)M_PI * sqrtf(a * a - h * h)), result.ku);
+
+  // the element keeps heating for a while after a switch, but less than a half cycle
+  TEST_ASSERT_GREATER_THAN(5.0f, result.turn_time);
+  TEST_ASSERT_LESS_THAN(result.pu / 2, result.turn_time);
+
+  TEST_ASSERT_GREATER_THAN(0.0f, result.classic.p);
+  TEST_ASSERT_GREATER_THAN(0.0f, result.classic.i);
+  TEST_ASSERT_GREATER_THAN(0.0f, result.classic.d);
+  TEST_ASSERT_LESS_THAN(result.classic.p, result.no_overshoot.p);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, result.pi.d);
+
+  // done means off
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(0, BREW_TEMP));
+}
+
+void test_abort_overtemp()
+{
+  RelayAutotune autotune;
+  autotune.start(make_config(BREW_TEMP), 0);
+
+  TEST_ASSERT_EQUAL_FLOAT(AUTOTUNE_OUTPUT_HIGH, autotune.update(1000, BREW_TEMP - 10.0f));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(2000, BREW_TEMP + AUTOTUNE_MAX_OVERSHOOT + 0.1f));
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORTED, autotune.getState());
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_OVERTEMP, autotune.getAbortReason());
+
+  // stays off
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(3000, BREW_TEMP - 10.0f));
+}
+
+void test_abort_sensor()
+{
+  const float invalid[] = {999.0f, NAN, MIN_TEMP - 1.0f, 150.0f};
+  RelayAutotune autotune;
+
+  for (uint32_t n = 0; n < sizeof(invalid) / sizeof(invalid[0]); n++)
+  {
+    autotune.start(make_config(BREW_TEMP), 0);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(1000, invalid[n]));
+    TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_SENSOR, autotune.getAbortReason());
+  }
+}
+
+void test_abort_timeout()
+{
+  RelayAutotune autotune;
+  AutotuneConfig_t config = make_config(BREW_TEMP);
+  config.timeout_ms = 60000;
+
+  // never reaches the setpoint
+  autotune.start(config, 0xFFFFFFFFu - 30000u);
+  for (uint32_t ms = 0; ms <= config.timeout_ms; ms += PID_TS)
+    TEST_ASSERT_EQUAL_FLOAT(AUTOTUNE_OUTPUT_HIGH, autotune.update(0xFFFFFFFFu - 30000u + ms, 60.0f));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(0xFFFFFFFFu - 30000u + config.timeout_ms + PID_TS, 60.0f));
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_TIMEOUT, autotune.getAbortReason());
+}
+
+void test_abort_no_switch()
+{
+  RelayAutotune autotune;
+  AutotuneConfig_t config = make_config(BREW_TEMP);
+  config.half_cycle_ms = 30000;
+  uint32_t ms = 0;
+
+  // crosses once, then hangs above the lower switch point
+  autotune.start(config, ms);
+  autotune.update(ms += PID_TS, BREW_TEMP + AUTOTUNE_HYSTERESIS);
+  TEST_ASSERT_EQUAL(AUTOTUNE_RELAY, autotune.getState());
+  for (uint32_t n = 0; n < config.half_cycle_ms / PID_TS; n++)
+    TEST_ASSERT_EQUAL_FLOAT(AUTOTUNE_OUTPUT_LOW, autotune.update(ms += PID_TS, BREW_TEMP));
+  autotune.update(ms += PID_TS, BREW_TEMP);
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORTED, autotune.getState());
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_NO_SWITCH, autotune.getAbortReason());
+}
+
+void test_abort_no_amplitude()
+{
+  RelayAutotune autotune;
+  uint32_t ms = 0;
+
+  // switches, but the oscillation is no larger than the hysteresis
+  autotune.start(make_config(BREW_TEMP), ms);
+  for (uint32_t n = 0; n < 100 && autotune.isRunning(); n++)
+  {
+    autotune.update(ms += PID_TS, BREW_TEMP + AUTOTUNE_HYSTERESIS);
+    autotune.update(ms += PID_TS, BREW_TEMP - AUTOTUNE_HYSTERESIS);
+  }
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORTED, autotune.getState());
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_NO_SWITCH, autotune.getAbortReason());
+}
+
+void test_stop()
+{
+  RelayAutotune autotune;
+
+  // stop when idle keeps it idle
+  autotune.stop();
+  TEST_ASSERT_EQUAL(AUTOTUNE_IDLE, autotune.getState());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(0, BREW_TEMP));
+
+  autotune.start(make_config(BREW_TEMP), 0);
+  TEST_ASSERT_TRUE(autotune.isRunning());
+  autotune.stop();
+  TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_USER, autotune.getAbortReason());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(1000, BREW_TEMP - 10.0f));
+}
+
+void test_rejects_non_finite()
+{
+  RelayAutotune autotune;
+  AutotuneConfig_t config = make_config(NAN);
+
+  // e.g. /autotune/start?setpoint=nan - the overtemperature abort could never fire
+  TEST_ASSERT_FALSE(autotune.start(config, 0));
+  TEST_ASSERT_EQUAL(AUTOTUNE_IDLE, autotune.getState());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, autotune.update(1000, BREW_TEMP - 10.0f));
+
+  config = make_config(BREW_TEMP);
+  config.max_overshoot = INFINITY;
+  TEST_ASSERT_FALSE(autotune.start(config, 0));
+  TEST_ASSERT_TRUE(autotune.start(make_config(BREW_TEMP), 0));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_simulated_boiler);
+  RUN_TEST(test_abort_overtemp);
+  RUN_TEST(test_abort_sensor);
+  RUN_TEST(test_abort_timeout);
+  RUN_TEST(test_abort_no_switch);
+  RUN_TEST(test_abort_no_amplitude);
+  RUN_TEST(test_stop);
+  RUN_TEST(test_rejects_non_finite);
+  return UNITY_END();
+}
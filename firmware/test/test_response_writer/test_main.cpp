@@ -0,0 +1,219 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+#include "ResponseWriter.hpp"
+#include "../bench.hpp"
+
+// every heap allocation of the test binary
+static uint32_t allocations = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+// XML_CODE of WebInterface.cpp, /update_readings
+static const char XML[] = "<?xml version = \"1.0\"?>\n<inputs>\n<rd>\n%TEMP_TOP%\n</rd>\n<rd>\n%TEMP_SIDE%\n</rd>\n<rd>\n%TEMP_AVG%\n</rd>\n<rd>\n%TEMP_BREWHEAD%\n</rd>\n<rd>\n%PERC_HEATER%\n</rd>\n<rd>\n%SHOT_TIME%\n</rd>\n<pwr>\n%POWERSTATE%\n</pwr>\n</inputs>\n";
+static const char *const fields[] = {"TEMP_TOP", "TEMP_SIDE", "TEMP_AVG", "TEMP_BREWHEAD", "PERC_HEATER", "SHOT_TIME", "POWERSTATE"};
+static const float values[] = {93.27f, 91.5f, 92.385f, 85.0f, 42.0f, 17.0f, 1.0f};
+static const uint32_t decimals[] = {2, 2, 2, 2, 0, 0, 0};
+
+static void fill(uint32_t field, ResponseWriter &writer, const void *arg)
+{
+  const float *v = static_cast<const float *>(arg);
+  writer.appendFloat(v[field], decimals[field]);
+}
+
+// the same text with printf
+static void expected_xml(char *text, size_t size, const float *v)
+{
+  snprintf(text, size,
+           "<?xml version = \"1.0\"?>\n<inputs>\n<rd>\n%.2f\n</rd>\n<rd>\n%.2f\n</rd>\n<rd>\n%.2f\n</rd>\n"
+           "<rd>\n%.2f\n</rd>\n<rd>\n%.0f\n</rd>\n<rd>\n%.0f\n</rd>\n<pwr>\n%.0f\n</pwr>\n</inputs>\n",
+           v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_numbers()
+{
+  char buffer[64];
+  ResponseWriter writer(buffer, sizeof(buffer));
+
+  writer.appendUInt(0);
+  writer.append(" ");
+  writer.appendUInt(4294967295u);
+  writer.append(" ");
+  writer.appendInt(-2147483647 - 1);
+  writer.append(" ");
+  writer.appendFloat(-0.125f, 2);
+  writer.append(" ");
+  writer.appendFloat(9.9999f, 3);
+  TEST_ASSERT_EQUAL_STRING("0 4294967295 -2147483648 -0.13 10.000", writer.c_str());
+  TEST_ASSERT_FALSE(writer.overflow());
+}
+
+void test_float_matches_printf()
+{
+  char buffer[32], expected[32];
+  uint32_t rng = 12345;
+
+  for (uint32_t n = 0; n < 200000; n++)
+  {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    // readings with 0.01 resolution are what the endpoints send
+    float value = (int32_t)(rng % 2000000 - 1000000) / 100.0f;
+    uint32_t d = n % 3;
+
+    ResponseWriter writer(buffer, sizeof(buffer));
+    writer.appendFloat(value, d);
+    snprintf(expected, sizeof(expected), "%.*f", (int)d, value);
+    // printf rounds the exact binary value, half-way cases may round the other way
+    if (strcmp(expected, buffer) != 0)
+      TEST_ASSERT_FLOAT_WITHIN(1.001 / (d == 0 ? 1 : d == 1 ? 10 : 100), atof(expected), atof(buffer));
+  }
+}
+
+void test_overflow()
+{
+  char buffer[8];
+  ResponseWriter writer(buffer, sizeof(buffer));
+
+  writer.append("1234");
+  writer.appendUInt(56789);
+  TEST_ASSERT_TRUE(writer.overflow());
+  TEST_ASSERT_EQUAL(7, writer.length());
+  TEST_ASSERT_EQUAL_STRING("1234567", writer.c_str());
+
+  writer.clear();
+  TEST_ASSERT_FALSE(writer.overflow());
+  TEST_ASSERT_EQUAL_STRING("", writer.c_str());
+}
+
+void test_template()
+{
+  static const char *const known[] = {"A"};
+  char buffer[768], expected[768];
+  ResponseTemplate xml(XML, fields, sizeof(fields) / sizeof(fields[0]));
+  ResponseWriter writer(buffer, sizeof(buffer));
+
+  TEST_ASSERT_TRUE(xml.isValid());
+  xml.render(writer, fill, values);
+  expected_xml(expected, sizeof(expected), values);
+  TEST_ASSERT_EQUAL_STRING(expected, writer.c_str());
+
+  TEST_ASSERT_FALSE(ResponseTemplate("x %B% y", known, 1).isValid());
+  TEST_ASSERT_TRUE(ResponseTemplate("100% sure", known, 1).isValid());
+}
+
+void test_no_allocations()
+{
+  static char buffers[4][768];
+  ResponsePool pool(buffers[0], sizeof(buffers[0]), 4);
+  ResponseTemplate xml(XML, fields, sizeof(fields) / sizeof(fields[0]));
+
+  uint32_t before = allocations;
+  for (uint32_t n = 0; n < 1000; n++)
+  {
+    char *buffer = pool.acquire();
+    ResponseWriter writer(buffer, pool.getSize());
+    xml.render(writer, fill, values);
+    pool.release(buffer);
+  }
+  TEST_ASSERT_EQUAL(0, allocations - before);
+}
+
+void test_pool()
+{
+  static char buffers[3][16];
+  ResponsePool pool(buffers[0], sizeof(buffers[0]), 3);
+  char *taken[3];
+
+  // every response its own buffer, none when all are in use
+  for (uint32_t n = 0; n < 3; n++)
+  {
+    taken[n] = pool.acquire();
+    TEST_ASSERT_NOT_NULL(taken[n]);
+    for (uint32_t m = 0; m < n; m++)
+      TEST_ASSERT_TRUE(taken[n] != taken[m]);
+  }
+  TEST_ASSERT_EQUAL(3, pool.getUsed());
+  TEST_ASSERT_NULL(pool.acquire());
+
+  // released in any order
+  pool.release(taken[1]);
+  TEST_ASSERT_EQUAL(2, pool.getUsed());
+  TEST_ASSERT_EQUAL_PTR(taken[1], pool.acquire());
+  pool.release(taken[0]);
+  pool.release(taken[0]);
+  pool.release(nullptr);
+  TEST_ASSERT_EQUAL(2, pool.getUsed());
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 100000;
+  char buffer[768];
+  float v[7];
+  ResponseTemplate xml(XML, fields, sizeof(fields) / sizeof(fields[0]));
+  uint64_t bytes = 0, bytes_printf = 0;
+
+  memcpy(v, values, sizeof(v));
+  uint64_t start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+  {
+    ResponseWriter writer(buffer, sizeof(buffer));
+    v[0] = 90.0f + (n & 255) * 0.01f;
+    xml.render(writer, fill, v);
+    bytes += writer.length();
+  }
+  uint64_t time = bench_now() - start;
+
+  start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+  {
+    v[0] = 90.0f + (n & 255) * 0.01f;
+    expected_xml(buffer, sizeof(buffer), v);
+    bytes_printf += strlen(buffer);
+  }
+  uint64_t time_printf = bench_now() - start;
+  bench_keep(bytes);
+  bench_keep(bytes_printf);
+
+  char text[128];
+  snprintf(text, sizeof(text), "per /update_readings body: template %.0f, printf %.0f " BENCH_UNIT " (%.0f bytes)",
+           (double)time / COUNT, (double)time_printf / COUNT, (double)bytes / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_numbers);
+  RUN_TEST(test_float_matches_printf);
+  RUN_TEST(test_overflow);
+  RUN_TEST(test_template);
+  RUN_TEST(test_no_allocations);
+  RUN_TEST(test_pool);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
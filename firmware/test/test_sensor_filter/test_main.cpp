@@ -0,0 +1,199 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "SensorFilter.hpp"
+
+// probe traces in mV at the active sensor rate (29 ms): the shape of a
+// warm-up and a shot on the top probe, with the noise seen on the ADC.
+// generated with a fixed seed, so every run sees the same samples.
+static constexpr uint32_t TRACE_LENGTH = 20000;
+static constexpr float NOISE_MV = 3.0f;      // gaussian, per sample
+static constexpr float SPIKE_MV = 80.0f;     // single sample spikes
+static constexpr float SPIKE_RATE = 0.02f;
+
+static uint32_t rng_state;
+
+static float uniform()
+{
+  // xorshift32 - same numbers on every host
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return (rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+static float gaussian()
+{
+  float u1 = uniform() + 1e-7f;
+  float u2 = uniform();
+  return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+static float noise(bool spikes)
+{
+  float n = NOISE_MV * gaussian();
+  if (spikes && uniform() < SPIKE_RATE)
+    n += (uniform() < 0.5f) ? SPIKE_MV : -SPIKE_MV;
+  return n;
+}
+
+// probe voltage without noise: warm-up with the probe time constant of ~8 s,
+// then a shot pulling the boiler down and the recovery
+static float probe_mv(uint32_t n)
+{
+  const float tau = 275.0f;  // samples
+  float mv = 1400.0f + 400.0f * (1.0f - expf(-(float)n / tau));
+  if (n > 12000)
+    mv -= 60.0f * (1.0f - expf(-(float)(n - 12000) / tau)) * expf(-(float)(n - 12000) / 1000.0f);
+  return mv;
+}
+
+template<typename Chain>
+static float output_variance(bool spikes)
+{
+  Chain chain;
+  double sum = 0.0, sum_sq = 0.0;
+  uint32_t count = 0;
+
+  rng_state = 0x12345678u;
+  chain.reset(1500.0f);
+  for (uint32_t n = 0; n < 200000; n++)
+  {
+    float y = chain.process(1500.0f + noise(spikes));
+    if (n < 200)
+      continue;
+    sum += y;
+    sum_sq += (double)y * y;
+    count++;
+  }
+  double mean = sum / count;
+  return sum_sq / count - mean * mean;
+}
+
+// lag in samples on a ramp, after the chain settled
+template<typename Chain>
+static float ramp_lag()
+{
+  Chain chain;
+  const float slope = 0.05f;  // mV per sample
+  float y = 0.0f;
+
+  chain.reset(1000.0f);
+  for (uint32_t n = 0; n < 1000; n++)
+    y = chain.process(1000.0f + slope * n);
+  return (1000.0f + slope * 999 - y) / slope;
+}
+
+// mean absolute error against the noise free trace
+template<typename Chain>
+static float trace_error()
+{
+  Chain chain;
+  double error = 0.0;
+
+  rng_state = 0x9e3779b9u;
+  chain.reset(probe_mv(0));
+  for (uint32_t n = 0; n < TRACE_LENGTH; n++)
+    error += fabsf(chain.process(probe_mv(n) + noise(true)) - probe_mv(n));
+  return error / TRACE_LENGTH;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_noise_floor_gaussian()
+{
+  float boxcar = output_variance<SensorFilterBoxcar>(false);
+  float low_latency = output_variance<SensorFilterLowLatency>(false);
+  char text[96];
+  snprintf(text, sizeof(text), "gaussian variance: boxcar %.4f, low latency %.4f mV^2", boxcar, low_latency);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_LESS_OR_EQUAL(boxcar, low_latency);
+}
+
+void test_noise_floor_spikes()
+{
+  float boxcar = output_variance<SensorFilterBoxcar>(true);
+  float low_latency = output_variance<SensorFilterLowLatency>(true);
+  char text[96];
+  snprintf(text, sizeof(text), "variance with spikes: boxcar %.4f, low latency %.4f mV^2", boxcar, low_latency);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_LESS_OR_EQUAL(boxcar / 5.0f, low_latency);
+}
+
+void test_group_delay()
+{
+  float boxcar = ramp_lag<SensorFilterBoxcar>();
+  float low_latency = ramp_lag<SensorFilterLowLatency>();
+  char text[96];
+  snprintf(text, sizeof(text), "ramp lag: boxcar %.2f, low latency %.2f samples", boxcar, low_latency);
+  TEST_MESSAGE(text);
+  // the reported delay is the measured one
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, SensorFilterBoxcar().getGroupDelay(), boxcar);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, SensorFilterLowLatency().getGroupDelay(), low_latency);
+  TEST_ASSERT_LESS_OR_EQUAL(boxcar / 2.0f, low_latency);
+}
+
+void test_trace_error()
+{
+  float boxcar = trace_error<SensorFilterBoxcar>();
+  float low_latency = trace_error<SensorFilterLowLatency>();
+  char text[96];
+  snprintf(text, sizeof(text), "mean error on the probe trace: boxcar %.3f, low latency %.3f mV", boxcar, low_latency);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_LESS_THAN(boxcar, low_latency);
+}
+
+// the running sums give the same result as the full weighted sum
+void test_linear_fit_running_sums()
+{
+  static constexpr uint32_t N = 96;
+  static constexpr uint32_t D = 4;
+  LinearFit<N, D> fit;
+  float history[N];
+  float max_error = 0.0f;
+
+  rng_state = 0xdeadbeefu;
+  fit.reset(2000.0f);
+  for (uint32_t i = 0; i < N; i++)
+    history[i] = 2000.0f;
+
+  for (uint32_t n = 0; n < 50000; n++)
+  {
+    float x = probe_mv(n) + 500.0f + noise(true);
+    float y = fit.process(x);
+
+    for (uint32_t i = N - 1; i > 0; i--)
+      history[i] = history[i - 1];
+    history[0] = x;
+
+    double expected = 0.0;
+    const double mean_age = (N - 1) / 2.0;
+    const double age_variance = N * (N * N - 1) / 12.0;
+    for (uint32_t age = 0; age < N; age++)
+      expected += history[age] * (1.0 / N + (age - mean_age) * (D - mean_age) / age_variance);
+    max_error = fmaxf(max_error, fabs(expected - y));
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(0.01f, max_error);
+}
+
+void test_reset_is_settled()
+{
+  SensorFilterLowLatency chain;
+  chain.reset(1234.5f);
+  for (uint32_t n = 0; n < 300; n++)
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1234.5f, chain.process(1234.5f));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_noise_floor_gaussian);
+  RUN_TEST(test_noise_floor_spikes);
+  RUN_TEST(test_group_delay);
+  RUN_TEST(test_trace_error);
+  RUN_TEST(test_linear_fit_running_sums);
+  RUN_TEST(test_reset_is_settled);
+  return UNITY_END();
+}
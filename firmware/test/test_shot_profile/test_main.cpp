@@ -0,0 +1,194 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "ShotProfile.hpp"
+
+// pre-infusion, pause, ramp up, pulses and a hold until the shot is stopped
+static const char PROFILE[] =
+  "name blooming\n"
+  "hold 40 3000 ff=0.25 temp=94.0\n"
+  "pause 2000   # bloom\r\n"
+  "ramp 40 100 4000 clock\n"
+  "pulse 80 10000 500 250\n"
+  "hold 100 0\n";
+
+static ShotProfile_t parse(const char *text)
+{
+  ShotProfile_t profile;
+  const char *error = "";
+
+  TEST_ASSERT_TRUE_MESSAGE(shot_profile_parse(text, profile, &error), error);
+  return profile;
+}
+
+static void expect_invalid(const char *text, const char *reason)
+{
+  ShotProfile_t profile;
+  const char *error = "";
+  char message[160];
+
+  snprintf(message, sizeof(message), "\"%s\" parsed", text);
+  TEST_ASSERT_FALSE_MESSAGE(shot_profile_parse(text, profile, &error), message);
+  TEST_ASSERT_EQUAL_STRING(reason, error);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_parse()
+{
+  ShotProfile_t profile = parse(PROFILE);
+
+  TEST_ASSERT_EQUAL_STRING("blooming", profile.name);
+  TEST_ASSERT_EQUAL(5, profile.count);
+
+  const ShotSegment_t &hold = profile.segments[0];
+  TEST_ASSERT_EQUAL(SEGMENT_HOLD, hold.type);
+  TEST_ASSERT_EQUAL(40, hold.pump);
+  TEST_ASSERT_EQUAL(3000, hold.duration_ms);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, hold.ff_gain);
+  TEST_ASSERT_EQUAL_FLOAT(94.0f, hold.temp);
+
+  TEST_ASSERT_EQUAL(SEGMENT_PAUSE, profile.segments[1].type);
+  TEST_ASSERT_EQUAL_FLOAT(-1.0f, profile.segments[1].ff_gain);
+  TEST_ASSERT_EQUAL(SEGMENT_FLAG_CLOCK, profile.segments[2].flags);
+  TEST_ASSERT_EQUAL(100, profile.segments[2].pump_end);
+  TEST_ASSERT_EQUAL(250, profile.segments[3].pulse_off_ms);
+  TEST_ASSERT_EQUAL(0, profile.segments[4].duration_ms);
+}
+
+void test_round_trip()
+{
+  ShotProfile_t profile = parse(PROFILE);
+  char text[512], again[512];
+
+  size_t length = shot_profile_format(profile, text, sizeof(text));
+  TEST_ASSERT_EQUAL(strlen(text), length);
+  TEST_ASSERT_EQUAL_STRING("name blooming\nhold 40 3000 ff=0.25 temp=94.0\npause 2000\nramp 40 100 4000 clock\n"
+                           "pulse 80 10000 500 250\nhold 100 0\n", text);
+
+  ShotProfile_t copy = parse(text);
+  TEST_ASSERT_EQUAL(0, memcmp(&profile, &copy, sizeof(profile)));
+  shot_profile_format(copy, again, sizeof(again));
+  TEST_ASSERT_EQUAL_STRING(text, again);
+
+  // too small: counts on like snprintf
+  char small[8];
+  TEST_ASSERT_EQUAL(length, shot_profile_format(profile, small, sizeof(small)));
+  TEST_ASSERT_EQUAL_STRING("name bl", small);
+}
+
+void test_malformed()
+{
+  expect_invalid("hold 40 3000 ff=abc", "invalid ff");
+  expect_invalid("hold 40 3000 ff=", "invalid ff");
+  expect_invalid("hold 40 3000 ff=0.5x", "invalid ff");
+  expect_invalid("hold 40 3000 ff=nan", "invalid ff");
+  expect_invalid("hold 40 3000 temp=", "invalid temp");
+  expect_invalid("hold 40 3000 temp=93,5", "invalid temp");
+  expect_invalid("hold 40 3000 temp=inf", "invalid temp");
+  expect_invalid("hold 40 3000 fast", "unknown option");
+  expect_invalid("hold 40", "missing or invalid value");
+  expect_invalid("hold 40 3s", "missing or invalid value");
+  expect_invalid("hold -1 3000", "missing or invalid value");
+  expect_invalid("squirt 40 3000", "unknown segment type");
+  expect_invalid("name", "invalid name");
+  expect_invalid("name a_name_much_too_long", "invalid name");
+  expect_invalid("# only a comment", "invalid profile");
+
+  char line[128];
+  memset(line, ' ', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  memcpy(line, "hold 40 3000", 12);
+  expect_invalid(line, "line too long");
+
+  char many[256] = "";
+  for (uint32_t n = 0; n <= SHOT_SEGMENTS_MAX; n++)
+    strcat(many, "hold 40 100\n");
+  expect_invalid(many, "too many segments");
+}
+
+void test_out_of_range()
+{
+  expect_invalid("hold 101 3000", "missing or invalid value");
+  expect_invalid("ramp 40 120 3000", "missing or invalid value");
+  expect_invalid("hold 40 120001", "missing or invalid value");
+  expect_invalid("pulse 80 10000 60001 100", "missing or invalid value");
+  expect_invalid("pause 120001", "missing or invalid value");
+
+  // checked on the whole profile
+  expect_invalid("hold 40 0\nhold 100 3000", "invalid profile");
+  expect_invalid("pulse 80 10000 0 0", "invalid profile");
+  expect_invalid("hold 40 3000 temp=10", "invalid profile");
+  expect_invalid("hold 40 3000 temp=140", "invalid profile");
+  expect_invalid("hold 40 3000 ff=5.1", "invalid profile");
+
+  ShotProfile_t profile = parse("hold 40 3000 ff=5 temp=20");
+  profile.segments[0].ff_gain = 0.0f / 0.0f;
+  TEST_ASSERT_FALSE(shot_profile_validate(profile));
+}
+
+void test_replay()
+{
+  ShotProfile_t profile = parse(PROFILE);
+  ShotSetpoint_t setpoint;
+
+  // time, segment, pump, forecast
+  static const uint32_t expected[][4] = {
+    {0, 0, 40, 40},
+    {2999, 0, 40, 40},
+    {3000, 1, 0, 0},
+    {5000, 2, 40, 100},
+    {6000, 2, 55, 100},
+    {8999, 2, 99, 100},
+    {9000, 3, 80, 53},
+    {9499, 3, 80, 53},
+    {9500, 3, 0, 53},
+    {9750, 3, 80, 53},
+    {19000, 4, 100, 100},
+    {600000, 4, 100, 100},
+  };
+  for (uint32_t n = 0; n < sizeof(expected) / sizeof(expected[0]); n++)
+  {
+    char message[32];
+    snprintf(message, sizeof(message), "at %u ms", expected[n][0]);
+    shot_profile_evaluate(profile, expected[n][0], setpoint);
+    TEST_ASSERT_EQUAL_MESSAGE(expected[n][1], setpoint.segment, message);
+    TEST_ASSERT_EQUAL_MESSAGE(expected[n][2], setpoint.pump, message);
+    TEST_ASSERT_EQUAL_MESSAGE(expected[n][3], setpoint.pump_forecast, message);
+  }
+
+  shot_profile_evaluate(profile, 1000, setpoint);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, setpoint.ff_gain);
+  TEST_ASSERT_EQUAL_FLOAT(94.0f, setpoint.temp);
+  shot_profile_evaluate(profile, 9000, setpoint);
+  TEST_ASSERT_EQUAL(9000, setpoint.segment_start_ms);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, setpoint.temp);
+
+  TEST_ASSERT_EQUAL(5000, shot_profile_clock_start(profile));
+}
+
+void test_replay_done()
+{
+  ShotProfile_t profile = parse("hold 50 1000\npause 500");
+  ShotSetpoint_t setpoint;
+
+  shot_profile_evaluate(profile, 1500, setpoint);
+  TEST_ASSERT_EQUAL(profile.count, setpoint.segment);
+  TEST_ASSERT_EQUAL(1500, setpoint.segment_start_ms);
+  TEST_ASSERT_EQUAL(0, setpoint.pump);
+  TEST_ASSERT_EQUAL_FLOAT(-1.0f, setpoint.ff_gain);
+  TEST_ASSERT_EQUAL(0, shot_profile_clock_start(profile));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_parse);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_malformed);
+  RUN_TEST(test_out_of_range);
+  RUN_TEST(test_replay);
+  RUN_TEST(test_replay_done);
+  return UNITY_END();
+}
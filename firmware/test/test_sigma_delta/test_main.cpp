@@ -0,0 +1,177 @@
+#include <unity.h>
+#include <stdio.h>
+#include "SigmaDelta.hpp"
+#include "../bench.hpp"
+
+// delivered minus commanded half-cycles, tracked over a run. the largest
+// difference over any window is the spread of the running error.
+typedef struct Energy {
+  double error;       // half-cycles
+  double error_min;
+  double error_max;
+  int32_t dc;         // sum of the polarities switched on
+  int32_t dc_min;
+  int32_t dc_max;
+  uint32_t n;         // half-cycles, even = positive as after reset()
+} Energy_t;
+
+static void energy_reset(Energy_t &energy)
+{
+  energy = {0.0, 0.0, 0.0, 0, 0, 0, 0};
+}
+
+static void energy_step(Energy_t &energy, SigmaDelta &modulator)
+{
+  double commanded = (double)modulator.getDuty() / SigmaDelta::SCALE;
+  bool on = modulator.step();
+
+  energy.error += (on ? 1.0 : 0.0) - commanded;
+  if (energy.error < energy.error_min)
+    energy.error_min = energy.error;
+  if (energy.error > energy.error_max)
+    energy.error_max = energy.error;
+
+  if (on)
+    energy.dc += (energy.n % 2 == 0) ? 1 : -1;
+  if (energy.dc < energy.dc_min)
+    energy.dc_min = energy.dc;
+  if (energy.dc > energy.dc_max)
+    energy.dc_max = energy.dc;
+  energy.n++;
+}
+
+static double energy_window(const Energy_t &energy)
+{
+  return energy.error_max - energy.error_min;
+}
+
+static uint32_t rng = 12345;
+static uint32_t random_next()
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_constant_duty()
+{
+  SigmaDelta modulator;
+  Energy_t energy;
+  double worst = 0.0;
+  uint32_t worst_duty = 0;
+
+  for (uint32_t duty = 0; duty <= SigmaDelta::SCALE; duty++)
+  {
+    modulator.reset();
+    modulator.setDuty(duty);
+    energy_reset(energy);
+    for (uint32_t n = 0; n < 4 * SigmaDelta::SCALE; n++)
+      energy_step(energy, modulator);
+
+    if (energy_window(energy) > worst)
+    {
+      worst = energy_window(energy);
+      worst_duty = duty;
+    }
+    TEST_ASSERT_TRUE(energy.dc_min >= -1 && energy.dc_max <= 1);
+  }
+
+  char text[96];
+  snprintf(text, sizeof(text), "constant duty: worst window %.3f half-cycles at %u", worst, worst_duty);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_LESS_THAN(2.0, worst);
+}
+
+void test_changing_duty()
+{
+  SigmaDelta modulator;
+  Energy_t energy;
+
+  modulator.reset();
+  energy_reset(energy);
+  for (uint32_t block = 0; block < 20000; block++)
+  {
+    // a new duty every few half-cycles, 0 is tested separately
+    modulator.setDuty(1 + random_next() % SigmaDelta::SCALE);
+    for (uint32_t n = random_next() % 16; n > 0; n--)
+      energy_step(energy, modulator);
+  }
+
+  char text[96];
+  snprintf(text, sizeof(text), "random duty: worst window %.3f half-cycles over %u", energy_window(energy), energy.n);
+  TEST_MESSAGE(text);
+  TEST_ASSERT_LESS_THAN(2.0, energy_window(energy));
+  TEST_ASSERT_TRUE(energy.dc_min >= -1 && energy.dc_max <= 1);
+}
+
+void test_no_dc()
+{
+  SigmaDelta modulator;
+  uint32_t on_positive = 0, on_negative = 0;
+
+  // 50% must not be every positive half-cycle
+  modulator.reset();
+  modulator.setDuty(SigmaDelta::SCALE / 2);
+  for (uint32_t n = 0; n < 1000; n++)
+  {
+    if (modulator.step())
+      (n % 2 == 0) ? on_positive++ : on_negative++;
+  }
+  TEST_ASSERT_UINT_WITHIN(1, on_positive, on_negative);
+  TEST_ASSERT_UINT_WITHIN(2, 500, on_positive + on_negative);
+}
+
+void test_off_at_once()
+{
+  SigmaDelta modulator;
+
+  modulator.reset();
+  modulator.setDuty(999);
+  for (uint32_t n = 0; n < 11; n++)
+    modulator.step();
+  modulator.setDuty(0);
+  for (uint32_t n = 0; n < 100; n++)
+    TEST_ASSERT_FALSE(modulator.step());
+
+  // nothing owed is delivered after switching back on
+  modulator.setDuty(1);
+  for (uint32_t n = 0; n < SigmaDelta::SCALE - 1; n++)
+    TEST_ASSERT_FALSE(modulator.step());
+  TEST_ASSERT_TRUE(modulator.step());
+
+  modulator.setDuty(SigmaDelta::SCALE + 1);
+  TEST_ASSERT_EQUAL(SigmaDelta::SCALE, modulator.getDuty());
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 1000000;
+  SigmaDelta modulator;
+  uint32_t on = 0;
+
+  modulator.setDuty(333);
+  uint64_t start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+    on += modulator.step();
+  uint64_t time = bench_now() - start;
+  bench_keep(on);
+
+  char text[64];
+  snprintf(text, sizeof(text), "per half-cycle: %.1f " BENCH_UNIT, (double)time / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_constant_duty);
+  RUN_TEST(test_changing_duty);
+  RUN_TEST(test_no_dc);
+  RUN_TEST(test_off_at_once);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,238 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Telemetry.hpp"
+#include "../bench.hpp"
+
+static TelemetryPoint_t make_point(uint32_t time_ms)
+{
+  TelemetryPoint_t point = {time_ms, {9327, 9150, 8500, 9239, 9301}, {-12, 350, 7, 2500}, 2845, 29, 0, 1, 2};
+  return point;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_ring()
+{
+  TelemetryPoint_t points[4];
+  TelemetryRing ring(points, 4);
+  TelemetryPoint_t point;
+
+  for (uint32_t n = 0; n < 3; n++)
+    ring.push(make_point(n));
+  TEST_ASSERT_EQUAL(0, ring.getFirst());
+  TEST_ASSERT_EQUAL(3, ring.getCount());
+  TEST_ASSERT_TRUE(ring.get(2, point));
+  TEST_ASSERT_EQUAL(2, point.time_ms);
+  TEST_ASSERT_FALSE(ring.get(3, point));
+
+  // full: the oldest are dropped, a batch read before stays valid up to them
+  for (uint32_t n = 3; n < 7; n++)
+    ring.push(make_point(n));
+  TEST_ASSERT_EQUAL(3, ring.getFirst());
+  TEST_ASSERT_EQUAL(4, ring.getCount());
+  TEST_ASSERT_EQUAL(3, ring.getDropped());
+  TEST_ASSERT_FALSE(ring.get(2, point));
+  TEST_ASSERT_TRUE(ring.get(3, point));
+  TEST_ASSERT_EQUAL(3, point.time_ms);
+
+  // releasing points already dropped does nothing
+  ring.release(2);
+  TEST_ASSERT_EQUAL(3, ring.getFirst());
+  ring.release(5);
+  TEST_ASSERT_EQUAL(5, ring.getFirst());
+  TEST_ASSERT_EQUAL(2, ring.getCount());
+  ring.release(7);
+  TEST_ASSERT_EQUAL(0, ring.getCount());
+  ring.release(8);
+  TEST_ASSERT_EQUAL(7, ring.getFirst());
+}
+
+void test_temperatures()
+{
+  TEST_ASSERT_EQUAL(9327, telemetry_temp(93.27f));
+  TEST_ASSERT_EQUAL(-1, telemetry_temp(-0.005f));
+  TEST_ASSERT_EQUAL(32767, telemetry_temp(327.67f));
+
+  // failed probes and anything out of range have no reading
+  TEST_ASSERT_EQUAL(TELEMETRY_INVALID, telemetry_temp(999.0f));
+  TEST_ASSERT_EQUAL(TELEMETRY_INVALID, telemetry_temp(327.68f));
+  TEST_ASSERT_EQUAL(TELEMETRY_INVALID, telemetry_temp(-327.68f));
+  TEST_ASSERT_EQUAL(TELEMETRY_INVALID, telemetry_temp(NAN));
+  TEST_ASSERT_EQUAL(TELEMETRY_INVALID, telemetry_temp(INFINITY));
+}
+
+void test_shares()
+{
+  // a large derivative kick is kept, not clamped at +-327
+  TEST_ASSERT_EQUAL(-123456, telemetry_fixed32(-1234.56f));
+  TEST_ASSERT_EQUAL(2147483520, telemetry_fixed32(1e30f));
+  TEST_ASSERT_EQUAL(-2147483520, telemetry_fixed32(-1e30f));
+  TEST_ASSERT_EQUAL(0, telemetry_fixed32(NAN));
+}
+
+void test_format_series()
+{
+  char buffer[TELEMETRY_TEXT_MAX];
+  ResponseWriter writer(buffer, sizeof(buffer));
+  TelemetryPoint_t point = make_point(1000);
+
+  point.temp[2] = TELEMETRY_INVALID;
+  point.share[0] = -123456;
+  // sampled 2.5 s before the conversion
+  telemetry_format(point, 3500, 1700000000000ull, TELEMETRY_LAYOUT_SERIES, writer);
+  TEST_ASSERT_EQUAL_STRING(
+    "temperature,pos=top value=93.27 1699999997500\n"
+    "temperature,pos=side value=91.50 1699999997500\n"
+    "temperature,pos=avg value=92.39 1699999997500\n"
+    "temperature,pos=water value=93.01 1699999997500\n"
+    "power,device=heater value=29 1699999997500\n"
+    "power,device=pump value=0 1699999997500\n"
+    "pid,part=p value=-1234.56 1699999997500\n"
+    "pid,part=i value=3.50 1699999997500\n"
+    "pid,part=d value=0.07 1699999997500\n"
+    "pid,part=ff value=25.00 1699999997500\n"
+    "pid,part=regime value=1 1699999997500\n"
+    "pid,part=u value=28.45 1699999997500\n"
+    "water,part=state value=2 1699999997500\n", writer.c_str());
+}
+
+void test_format_fields()
+{
+  char buffer[TELEMETRY_TEXT_MAX];
+  ResponseWriter writer(buffer, sizeof(buffer));
+  TelemetryPoint_t point = make_point(1000);
+
+  point.temp[2] = TELEMETRY_INVALID;
+  point.share[0] = -123456;
+  telemetry_format(point, 3500, 1700000000000ull, TELEMETRY_LAYOUT_FIELDS, writer);
+  TEST_ASSERT_EQUAL_STRING(
+    "temperature top=93.27,side=91.50,avg=92.39,water=93.01 1699999997500\n"
+    "power heater=29i,pump=0i 1699999997500\n"
+    "pid p=-1234.56,i=3.50,d=0.07,ff=25.00,u=28.45,regime=1i,water_state=2i 1699999997500\n", writer.c_str());
+
+  // no temperature row without any reading
+  for (uint32_t n = 0; n < TELEMETRY_TEMPS; n++)
+    point.temp[n] = TELEMETRY_INVALID;
+  writer.clear();
+  telemetry_format(point, 3500, 1700000000000ull, TELEMETRY_LAYOUT_FIELDS, writer);
+  TEST_ASSERT_EQUAL(0, strncmp(writer.c_str(), "power ", 6));
+}
+
+void test_systime_wrap()
+{
+  char buffer[TELEMETRY_TEXT_MAX];
+  ResponseWriter writer(buffer, sizeof(buffer));
+  TelemetryPoint_t point = make_point(0xFFFFFC18u);
+
+  // sampled 1 s before the systime wrapped, converted 1 s after
+  telemetry_format(point, 1000, 1700000000000ull, TELEMETRY_LAYOUT_SERIES, writer);
+  TEST_ASSERT_NOT_NULL(strstr(writer.c_str(), "value=93.27 1699999998000\n"));
+}
+
+void test_text_max()
+{
+  static const TELEMETRY_Layout_t layouts[] = {TELEMETRY_LAYOUT_SERIES, TELEMETRY_LAYOUT_FIELDS};
+  char buffer[TELEMETRY_TEXT_MAX];
+  TelemetryPoint_t point;
+
+  // longest values everywhere, the largest timestamp
+  point.time_ms = 0;
+  for (uint32_t n = 0; n < TELEMETRY_TEMPS; n++)
+    point.temp[n] = -32767;
+  for (uint32_t n = 0; n < TELEMETRY_SHARES; n++)
+    point.share[n] = telemetry_fixed32(-1e30f);
+  point.u = telemetry_fixed32(-1e30f);
+  point.heater = 255;
+  point.pump = 255;
+  point.regime = 255;
+  point.water_state = 255;
+
+  for (uint32_t n = 0; n < 2; n++)
+  {
+    ResponseWriter writer(buffer, sizeof(buffer));
+    telemetry_format(point, 0, UINT64_MAX, layouts[n], writer);
+
+    char text[64];
+    snprintf(text, sizeof(text), "longest point: %u of %u bytes", (unsigned)writer.length(), TELEMETRY_TEXT_MAX);
+    TEST_MESSAGE(text);
+    TEST_ASSERT_FALSE(writer.overflow());
+  }
+}
+
+void test_batch()
+{
+  static char buffer[2048];
+  TelemetryBatch batch(buffer, sizeof(buffer), TELEMETRY_LAYOUT_SERIES, 10000, 100, 60000);
+  TelemetryPoint_t point = make_point(0);
+
+  // as many points as fit, the one that does not is left for the next request
+  batch.begin(7);
+  while (batch.add(point, 0, 1700000000000ull))
+    ;
+  TEST_ASSERT_TRUE(batch.isFull());
+  TEST_ASSERT_EQUAL(7, batch.getFirst());
+  TEST_ASSERT_EQUAL(3, batch.getCount());
+  TEST_ASSERT_EQUAL(10, batch.getEnd());
+  TEST_ASSERT_LESS_THAN(sizeof(buffer), batch.length());
+
+  // full: drain, at least as slow as the server
+  TEST_ASSERT_EQUAL(100, batch.sent(true, 20));
+  TEST_ASSERT_EQUAL(350, batch.sent(true, 350));
+
+  // errors back off up to the limit, the first success resets it
+  static const uint32_t backoff[] = {10000, 20000, 40000, 60000, 60000};
+  for (uint32_t n = 0; n < 5; n++)
+    TEST_ASSERT_EQUAL(backoff[n], batch.sent(false, 2000));
+  batch.begin(10);
+  batch.add(point, 0, 1700000000000ull);
+  TEST_ASSERT_FALSE(batch.isFull());
+  TEST_ASSERT_EQUAL(10000, batch.sent(true, 20));
+  TEST_ASSERT_EQUAL(10000, batch.sent(false, 2000));
+}
+
+void test_size()
+{
+  TEST_ASSERT_EQUAL(40, sizeof(TelemetryPoint_t));
+}
+
+void test_benchmark()
+{
+  static constexpr uint32_t COUNT = 100000;
+  char buffer[TELEMETRY_TEXT_MAX];
+  TelemetryPoint_t point = make_point(0);
+  uint64_t bytes = 0;
+
+  uint64_t start = bench_now();
+  for (uint32_t n = 0; n < COUNT; n++)
+  {
+    ResponseWriter writer(buffer, sizeof(buffer));
+    point.temp[0] = 9000 + (n & 255);
+    telemetry_format(point, n, 1700000000000ull + n, TELEMETRY_LAYOUT_SERIES, writer);
+    bytes += writer.length();
+  }
+  uint64_t time = bench_now() - start;
+  bench_keep(bytes);
+
+  char text[96];
+  snprintf(text, sizeof(text), "per point: %.0f " BENCH_UNIT " (%.0f bytes)", (double)time / COUNT, (double)bytes / COUNT);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_ring);
+  RUN_TEST(test_temperatures);
+  RUN_TEST(test_shares);
+  RUN_TEST(test_format_series);
+  RUN_TEST(test_format_fields);
+  RUN_TEST(test_systime_wrap);
+  RUN_TEST(test_text_max);
+  RUN_TEST(test_batch);
+  RUN_TEST(test_size);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
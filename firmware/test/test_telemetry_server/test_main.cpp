@@ -0,0 +1,367 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <vector>
+#include "coffee_config.hpp"
+#include "Telemetry.hpp"
+
+// the sender of task_influx against a stand-in InfluxDB on 127.0.0.1:
+// HTTP/1.1 with keep-alive over real sockets, simulated time.
+// the control task samples a point every TELEMETRY_SAMPLE_MS, the sender
+// posts batches as task_influx does - the same TelemetryRing and
+// TelemetryBatch, only esp_http_client is replaced by a plain socket.
+// POSIX only, single threaded: the server is polled after each request,
+// SIGPIPE is ignored - a closed connection is an error of the request.
+
+static constexpr uint64_t UNIX_START_MS = 1700000000000ull;
+static constexpr uint32_t SYSTIME_START_MS = 0xFFFFFFFFu - 300000u;  // wraps during the run
+static constexpr uint32_t REQUEST_MS = 20;  // simulated duration of a request
+static constexpr uint32_t STEP_MS = 10;
+
+typedef struct Server {
+  int listen_fd;
+  int fd;               // the connection, -1 if none
+  uint16_t port;
+  bool down;            // outage: connections are closed without a response
+  char in[TELEMETRY_BATCH_SIZE + 512];
+  size_t in_length;
+  uint32_t requests;
+  uint32_t connections;
+  std::vector<uint32_t> received;  // per sample index
+  uint32_t foreign;     // rows with a timestamp that is no sample
+} Server_t;
+
+typedef struct Client {
+  int fd;
+} Client_t;
+
+static void server_start(Server_t &server)
+{
+  struct sockaddr_in address;
+  socklen_t length = sizeof(address);
+  int one = 1;
+
+  server.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  TEST_ASSERT_TRUE(server.listen_fd >= 0);
+  setsockopt(server.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  TEST_ASSERT_EQUAL(0, bind(server.listen_fd, (struct sockaddr *)&address, sizeof(address)));
+  TEST_ASSERT_EQUAL(0, listen(server.listen_fd, 4));
+  getsockname(server.listen_fd, (struct sockaddr *)&address, &length);
+  server.port = ntohs(address.sin_port);
+  server.fd = -1;
+  server.down = false;
+  server.in_length = 0;
+  server.requests = 0;
+  server.connections = 0;
+  server.foreign = 0;
+  server.received.clear();
+}
+
+static void server_stop(Server_t &server)
+{
+  if (server.fd >= 0)
+    close(server.fd);
+  close(server.listen_fd);
+}
+
+static void server_close(Server_t &server)
+{
+  close(server.fd);
+  server.fd = -1;
+  server.in_length = 0;
+}
+
+static bool readable(int fd, int timeout_ms)
+{
+  struct pollfd p = {fd, POLLIN, 0};
+  return poll(&p, 1, timeout_ms) > 0;
+}
+
+// the sample index of each point, from the row every layout writes once per point
+static void server_store(Server_t &server, char *body)
+{
+  for (char *line = strtok(body, "\n"); line != NULL; line = strtok(NULL, "\n"))
+  {
+    if (strncmp(line, "power,device=heater ", 20) != 0 && strncmp(line, "power heater=", 13) != 0)
+      continue;
+    uint64_t ms = strtoull(strrchr(line, ' ') + 1, NULL, 10);
+    uint64_t index = (ms - UNIX_START_MS) / TELEMETRY_SAMPLE_MS;
+    if (ms < UNIX_START_MS || (ms - UNIX_START_MS) % TELEMETRY_SAMPLE_MS != 0 || index >= server.received.size())
+      server.foreign++;
+    else
+      server.received[index]++;
+  }
+}
+
+// accepts, reads one request if there is one and answers it
+static void server_poll(Server_t &server)
+{
+  if (readable(server.listen_fd, 0))
+  {
+    int fd = accept(server.listen_fd, NULL, NULL);
+    if (server.fd >= 0)
+      server_close(server);
+    server.fd = fd;
+    server.connections++;
+  }
+  if (server.fd < 0)
+    return;
+  if (server.down)
+  {
+    server_close(server);
+    return;
+  }
+
+  while (readable(server.fd, 100))
+  {
+    ssize_t n = recv(server.fd, server.in + server.in_length, sizeof(server.in) - 1 - server.in_length, 0);
+    if (n <= 0)
+    {
+      server_close(server);
+      return;
+    }
+    server.in_length += n;
+    server.in[server.in_length] = '\0';
+
+    char *body = strstr(server.in, "\r\n\r\n");
+    const char *field = strstr(server.in, "Content-Length: ");
+    if (body == NULL || field == NULL)
+      continue;
+    body += 4;
+    size_t length = strtoul(field + 16, NULL, 10);
+    if ((size_t)(server.in + server.in_length - body) < length)
+      continue;
+
+    // keep-alive: the connection stays open for the next request
+    TEST_ASSERT_EQUAL(0, strncmp(server.in, "POST /write?db=silvia&precision=ms HTTP/1.1\r\n", 45));
+    body[length] = '\0';
+    server_store(server, body);
+    server.requests++;
+    server.in_length = 0;
+    static const char response[] = "HTTP/1.1 204 No Content\r\n\r\n";
+    send(server.fd, response, sizeof(response) - 1, 0);
+    return;
+  }
+}
+
+static void client_close(Client_t &client)
+{
+  if (client.fd >= 0)
+    close(client.fd);
+  client.fd = -1;
+}
+
+// what esp_http_client_perform does for task_influx: true for a 204
+static bool client_post(Client_t &client, Server_t &server, const char *body, size_t length)
+{
+  char header[160];
+  char response[64];
+
+  if (client.fd < 0)
+  {
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(server.port);
+    client.fd = socket(AF_INET, SOCK_STREAM, 0);
+    // header and body go out as two writes, no delayed ACK wait in between
+    int one = 1;
+    setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(client.fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+      client_close(client);
+      return false;
+    }
+  }
+
+  int n = snprintf(header, sizeof(header), "POST /write?db=silvia&precision=ms HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                   "Content-Type: text/plain\r\nContent-Length: %u\r\n\r\n", (unsigned)length);
+  if (send(client.fd, header, n, 0) != n || send(client.fd, body, length, 0) != (ssize_t)length)
+  {
+    client_close(client);
+    return false;
+  }
+
+  server_poll(server);
+  if (!readable(client.fd, 100) || recv(client.fd, response, sizeof(response) - 1, 0) <= 0)
+  {
+    client_close(client);
+    return false;
+  }
+  return strncmp(response, "HTTP/1.1 204", 12) == 0;
+}
+
+typedef struct Run {
+  uint32_t samples;
+  uint32_t requests;    // all attempts
+  uint32_t failed;
+  uint32_t dropped;
+  uint32_t drained_s;   // after the outage until the ring was caught up
+} Run_t;
+
+// samples for minutes, the server is down for a while, then the ring is emptied
+static Run_t run(Server_t &server, TELEMETRY_Layout_t layout, uint32_t minutes, uint32_t outage_start_s, uint32_t outage_s)
+{
+  static TelemetryPoint_t points[TELEMETRY_RING_POINTS];
+  static char buffer[TELEMETRY_BATCH_SIZE];
+  TelemetryRing ring(points, TELEMETRY_RING_POINTS);
+  TelemetryBatch batch(buffer, sizeof(buffer), layout, TELEMETRY_FLUSH_MS, TELEMETRY_DRAIN_MS, TELEMETRY_BACKOFF_MAX_MS);
+  Client_t client = {-1};
+  Run_t result = {0, 0, 0, 0, 0};
+  uint32_t end_ms = minutes * 60000;
+  uint32_t outage_end_ms = (outage_start_s + outage_s) * 1000;
+  uint32_t next_send_ms = TELEMETRY_FLUSH_MS;
+  TelemetryPoint_t point;
+
+  server_start(server);
+  server.received.resize(end_ms / TELEMETRY_SAMPLE_MS);
+
+  for (uint32_t t = 0; t < end_ms || ring.getCount() > 0; t += STEP_MS)
+  {
+    TEST_ASSERT_LESS_THAN(end_ms + 10 * TELEMETRY_BACKOFF_MAX_MS, t);
+    uint32_t systime = SYSTIME_START_MS + t;
+    server.down = (t >= outage_start_s * 1000 && t < outage_end_ms);
+
+    if (t < end_ms && t % TELEMETRY_SAMPLE_MS == 0)
+    {
+      point.time_ms = systime;
+      for (uint32_t n = 0; n < TELEMETRY_TEMPS; n++)
+        point.temp[n] = 9000 + result.samples % 100;
+      for (uint32_t n = 0; n < TELEMETRY_SHARES; n++)
+        point.share[n] = result.samples;
+      point.u = result.samples;
+      point.heater = result.samples % 100;
+      point.pump = 0;
+      point.regime = 1;
+      point.water_state = 2;
+      ring.push(point);
+      result.samples++;
+    }
+
+    if (t < next_send_ms)
+      continue;
+
+    batch.begin(ring.getFirst());
+    while (ring.get(batch.getEnd(), point) && batch.add(point, systime, UNIX_START_MS + t))
+      ;
+    if (batch.getCount() == 0)
+    {
+      next_send_ms = t + TELEMETRY_FLUSH_MS;
+      continue;
+    }
+
+    bool accepted = client_post(client, server, batch.c_str(), batch.length());
+    result.requests++;
+    if (accepted)
+      ring.release(batch.getEnd());
+    else
+      result.failed++;
+    next_send_ms = t + REQUEST_MS + batch.sent(accepted, REQUEST_MS);
+
+    if (outage_s > 0 && result.drained_s == 0 && t >= outage_end_ms && accepted && !batch.isFull())
+      result.drained_s = (t - outage_end_ms) / 1000;
+  }
+
+  client_close(client);
+  server_stop(server);
+  result.dropped = ring.getDropped();
+  return result;
+}
+
+// every sample arrived exactly once, except the ones a full ring dropped:
+// a single gap from the outage
+static void check_exactly_once(Server_t &server, const Run_t &result)
+{
+  uint32_t missing = 0, twice = 0, gap_first = 0, gap_last = 0;
+
+  for (uint32_t n = 0; n < result.samples; n++)
+  {
+    if (server.received[n] == 0)
+    {
+      if (missing++ == 0)
+        gap_first = n;
+      gap_last = n;
+    }
+    else if (server.received[n] > 1)
+      twice++;
+  }
+  TEST_ASSERT_EQUAL(0, server.foreign);
+  TEST_ASSERT_EQUAL(0, twice);
+  TEST_ASSERT_EQUAL(result.dropped, missing);
+  if (missing > 0)
+    TEST_ASSERT_EQUAL(missing, gap_last - gap_first + 1);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void outage(TELEMETRY_Layout_t layout, const char *name)
+{
+  Server_t server;
+  // 20 min, 4 min outage - fits into the ring
+  Run_t result = run(server, layout, 20, 300, 240);
+
+  check_exactly_once(server, result);
+  TEST_ASSERT_EQUAL(1200000 / TELEMETRY_SAMPLE_MS, result.samples);
+  TEST_ASSERT_EQUAL(0, result.dropped);
+  TEST_ASSERT_EQUAL(result.requests - result.failed, server.requests);
+  // kept alive: a new connection only after an error
+  TEST_ASSERT_LESS_OR_EQUAL(1 + result.failed, server.connections);
+  // back within the longest backoff, then a few batches
+  TEST_ASSERT_LESS_THAN(TELEMETRY_BACKOFF_MAX_MS / 1000 + 30, result.drained_s);
+
+  char text[160];
+  snprintf(text, sizeof(text), "%s: 20 min, 4 min outage: %u points exactly once in %u requests (%u failed), "
+           "%u connections, caught up %u s after the outage", name, result.samples, server.requests, result.failed,
+           server.connections, result.drained_s);
+  TEST_MESSAGE(text);
+}
+
+void test_outage_series()
+{
+  outage(TELEMETRY_LAYOUT_SERIES, "series");
+}
+
+void test_outage_fields()
+{
+  outage(TELEMETRY_LAYOUT_FIELDS, "fields");
+}
+
+void test_outage_longer_than_ring()
+{
+  Server_t server;
+  // 15 min outage, the ring holds 10 min
+  Run_t result = run(server, TELEMETRY_LAYOUT_SERIES, 30, 300, 900);
+
+  check_exactly_once(server, result);
+  TEST_ASSERT_GREATER_THAN(0, result.dropped);
+  TEST_ASSERT_LESS_THAN(900000 / TELEMETRY_SAMPLE_MS, result.dropped);
+
+  char text[128];
+  snprintf(text, sizeof(text), "30 min, 15 min outage: %u of %u points dropped, the rest exactly once",
+           result.dropped, result.samples);
+  TEST_MESSAGE(text);
+}
+
+int main(int argc, char **argv)
+{
+  signal(SIGPIPE, SIG_IGN);
+  UNITY_BEGIN();
+  RUN_TEST(test_outage_series);
+  RUN_TEST(test_outage_fields);
+  RUN_TEST(test_outage_longer_than_ring);
+  return UNITY_END();
+}
@@ -0,0 +1,242 @@
+import math
+import random
+import sys
+
+# closed loop comparison of the firmware heater controllers on the boiler model of silvi_sim.py
+#   PID: PIDHeater type C incl. overrides, minimum output and the 5% limit with pump off
+#   MPC: MPCController with the table generated like MPCTable in MPCController.hpp
+# both with and without the pump feed-forward (PID_FF_PUMP)
+# run: python3 mpc_sim.py [plot]
+
+STEP = 0.1  # s - simulation step
+TS = 1.0  # s - controller period (PID_TS)
+
+HEATER_POWER = 750  # W
+HEATER_DEAD = 50  # s - silvi_sim.py element: ramps up over the dead time, cools down 2.3x faster
+BOILER_C = 4182 * 0.3  # J/K
+LOSS_R = 0.000000000004
+TEMP_ENV = 27
+
+
+def loss(temp):
+    # K/s - loss term of silvi_sim.py
+    return LOSS_R * (temp**4 - TEMP_ENV**4) * temp
+
+
+class PIDTypeC:
+    def __init__(self, p_pos=32, p_neg=90, i=1.2, d=-20):
+        self.kp_pos = p_pos
+        self.kp_neg = p_neg
+        self.ki = i
+        self.kd = d
+        self.u_override = -1
+        self.u_override_cnt = 0
+        self.pv1 = 0
+        self.pv2 = 0
+        self.u1 = 0
+
+    def start(self, pv):
+        self.pv1 = pv
+        self.pv2 = pv
+        self.u1 = 0
+
+    def override_output(self, u, count):
+        self.u_override = u
+        self.u_override_cnt = count
+
+    def update(self, target, pv, pump_on, ff=0.0):
+        e = target - pv
+        if self.pv1 - pv > 0:
+            part_p = self.kp_pos * (self.pv1 - pv)
+        else:
+            part_p = self.kp_neg * (self.pv1 - pv)
+        part_i = self.ki * TS * e
+        part_d = self.kd * (2 * self.pv1 - pv - self.pv2) / TS
+        u = self.u1 + part_p + part_i + part_d
+
+        if e > 10:  # PID_OVERRIDE_TEMP_ERR
+            u = 100
+        if not pump_on and u > 5 and pv >= target + 0.5:
+            u = 5
+        u += ff
+        if self.u_override >= 0 and self.u_override_cnt > 0:
+            u = self.u_override
+            self.u_override_cnt -= 1
+        u = min(max(u, 0), 100)
+
+        self.pv2 = self.pv1
+        self.pv1 = pv
+        self.u1 = u - ff
+
+        u = round(u)
+        if 0 < u <= 10:  # PID_MIN_OUTPUT
+            u = 10
+        return u
+
+
+# model of the firmware controller, coffee_config.hpp MPC_*
+MPC_HEATER_LAG = HEATER_DEAD / 2.3  # s - element cool-down
+MPC_DRAW_FADE = 5  # s
+MPC_DEAD_STEPS = 1
+MPC_HORIZON = 10
+MPC_CLTR = 60  # s
+
+
+class MPCTable:
+    TEMP_MIN = 20
+    TEMP_STEP = 10
+    SIZE = 13
+
+    def __init__(self, heater_lag=MPC_HEATER_LAG, draw_fade=MPC_DRAW_FADE, dead_steps=MPC_DEAD_STEPS, horizon=MPC_HORIZON, cltr=MPC_CLTR):
+        self.dead_steps = dead_steps
+        self.ae = math.exp(-TS / heater_lag)
+        self.ak = math.exp(-TS / draw_fade)
+        self.points = []
+        ae_h = self.ae**horizon
+        ak_h = self.ak**horizon
+        lambda_h = math.exp(-3 * TS * horizon / cltr)
+        for i in range(self.SIZE):
+            temp = self.TEMP_MIN + i * self.TEMP_STEP
+            slope = max(LOSS_R * (5 * temp**4 - TEMP_ENV**4), 1e-5)
+            k = HEATER_POWER / 100 / BOILER_C / slope
+            a = math.exp(-TS * slope)
+            a_h = a**horizon
+            b = k * (1 - a)
+            from_d = k * (1 - a_h)
+            from_h = b * (a_h - ae_h) / (a - self.ae)
+            from_u = from_d - from_h
+            from_k = b * (a_h - ak_h) / (a - self.ak)
+            self.points.append((a, b, (lambda_h - a_h) / from_u, -from_h / from_u, -from_d / from_u, -from_k / from_u,
+                                max(loss(temp), 0) * BOILER_C / HEATER_POWER * 100))
+
+    def lookup(self, temp):
+        pos = (temp - self.TEMP_MIN) / self.TEMP_STEP
+        if pos <= 0:
+            return self.points[0]
+        idx = int(pos)
+        if idx >= self.SIZE - 1:
+            return self.points[-1]
+        frac = pos - idx
+        return tuple(lo + frac * (hi - lo) for lo, hi in zip(self.points[idx], self.points[idx + 1]))
+
+
+class MPC:
+    def __init__(self, table, disturbance_gain=0.3):
+        self.table = table
+        self.gain_dist = disturbance_gain
+        self.u_override = -1
+        self.u_override_cnt = 0
+        self.start(0)
+
+    def start(self, pv):
+        self.outputs = [0.0] * self.table.dead_steps
+        self.idx = 0
+        self.disturbance = 0.0
+        self.element = 0.0
+        self.u_hold = 0.0
+        self.prediction = None
+        self.target = None
+
+    def override_output(self, u, count):
+        self.u_override = u
+        self.u_override_cnt = count
+
+    def update(self, target, pv, pump_on, ff=0.0):
+        if target != self.target:
+            # deviations are relative to the hold output
+            shift = self.u_hold
+            self.target = target
+            self.a, self.b, self.gain_y, self.gain_h, self.gain_d, self.gain_k, self.u_hold = self.table.lookup(target)
+            shift -= self.u_hold
+            self.element += shift
+            self.outputs = [o + shift for o in self.outputs]
+            self.prediction = None
+
+        # the feed-forward is the known disturbance
+        y = pv - target
+        if self.prediction is not None:
+            self.disturbance += self.gain_dist * (y - self.prediction) / self.b
+        self.prediction = self.a * y + self.b * (self.element + self.disturbance - ff)
+
+        y_dead = y
+        h_dead = self.element
+        k_dead = -ff
+        for i in range(self.table.dead_steps):
+            y_dead = self.a * y_dead + self.b * (h_dead + self.disturbance + k_dead)
+            h_dead = self.table.ae * h_dead + (1 - self.table.ae) * self.outputs[(self.idx + i) % self.table.dead_steps]
+            k_dead *= self.table.ak
+        u = self.u_hold + self.gain_y * y_dead + self.gain_h * h_dead + self.gain_d * self.disturbance + self.gain_k * k_dead
+
+        if self.u_override >= 0 and self.u_override_cnt > 0:
+            u = self.u_override
+            self.u_override_cnt -= 1
+        u = min(max(u, 0), 100)
+
+        self.element = self.table.ae * self.element + (1 - self.table.ae) * self.outputs[self.idx]
+        self.outputs[self.idx] = u - self.u_hold
+        self.idx = (self.idx + 1) % self.table.dead_steps
+        return round(u)
+
+
+def simulate(controller, target, ff_gain=0.0, init_temp=25, run_time=900, shot_start=700, shot_end=730, seed=1):
+    random.seed(seed)
+    temp = init_temp
+    heater = 0.0
+    u = 0
+    result = []
+    controller.start(temp)
+
+    for n in range(int(run_time / STEP)):
+        t = n * STEP
+        shot = shot_start < t <= shot_end
+
+        if n % round(TS / STEP) == 0:
+            u = controller.update(target, random.uniform(temp - 0.1, temp + 0.1), shot, ff_gain * 100 if shot else 0.0)
+
+        # PWM and heater element as in silvi_sim.py
+        if (n % 10) < math.floor(10 * u / 100):
+            heater = min(1.0, heater + STEP / HEATER_DEAD)
+        else:
+            heater = max(0.0, heater - heater * STEP / HEATER_DEAD * 2.3)
+
+        temp += HEATER_POWER * STEP * heater / BOILER_C
+        temp -= loss(temp) * STEP
+        if shot:
+            temp -= 0.03
+        result.append((t, temp, u))
+
+    # settled: stays within +-0.5 deg-C of the target until the shot starts
+    settle = None
+    for t, v, _ in result:
+        if t >= shot_start:
+            break
+        if abs(v - target) > 0.5:
+            settle = None
+        elif settle is None:
+            settle = t
+    overshoot = max(v for t, v, _ in result if t < shot_start) - target
+    droop = target - min(v for t, v, _ in result if shot_start <= t <= shot_end + 60)
+    recovery = max(v for t, v, _ in result if t > shot_end) - target
+    return settle, overshoot, droop, recovery, result
+
+
+if __name__ == '__main__':
+    table = MPCTable()
+    results = {}
+    for target in (92, 112):
+        for ff_gain in (0.0, 0.5):
+            for name, ctrl in (('PID', PIDTypeC()), ('MPC', MPC(table))):
+                settle, overshoot, droop, recovery, result = simulate(ctrl, target, ff_gain)
+                results[(name, target, ff_gain)] = result
+                print("{} target {} ff {}: settled {} overshoot {:.2f} droop {:.2f} overshoot after shot {:.2f}".format(
+                    name, target, ff_gain, "after {:.0f} s".format(settle) if settle is not None else "never", overshoot, droop, recovery))
+
+    if len(sys.argv) > 1 and sys.argv[1] == 'plot':
+        import matplotlib.pyplot as plt
+        for (name, target, ff_gain), result in results.items():
+            plt.plot([r[0] for r in result], [r[1] for r in result], label="{} {} ff {}".format(name, target, ff_gain))
+        plt.xlabel('time [s]')
+        plt.ylabel('temp [C]')
+        plt.grid(True)
+        plt.legend()
+        plt.show()